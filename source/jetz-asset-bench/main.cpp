@@ -0,0 +1,385 @@
+/*=============================================================================
+main.cpp
+
+Asset import benchmark. Loads each model under a directory a number of times
+and writes per-stage timings and peak memory use to stdout as JSON. Nothing
+here needs a window or a GPU, so it runs on headless build machines.
+
+Stages:
+	file_read		Reading the model and its external files. A .glb is
+					memory mapped, so its page faults land in the later stages.
+	json_parse		glTF parsing, excluding reads and image decoding.
+	image_decode	Decoding PNG/JPEG images to RGBA.
+	buffer_build	Repacking, optimizing, LODs, meshlets, and quantizing the
+					primitives into the model's vertex and index data, the
+					same way models do on load (gpu_mesh_packer).
+
+The upload and pipeline creation need a device, so they aren't measured.
+
+Builds on Windows with the Visual Studio project and on Linux with the
+Makefile in this directory.
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if _WIN64
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment (lib, "psapi.lib")
+	#include "thirdparty/dirent/dirent.h"
+	#undef ERROR // Conflicts with log_level::ERROR (windows.h)
+#else
+	#include <dirent.h>
+	#include <sys/resource.h>
+#endif
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/gpu_gltf.h"
+#include "jetz/gpu/gpu_mesh_packer.h"
+#include "jetz/main/filesystem.h"
+#include "jetz/main/log.h"
+#include "jetz/main/utl.h"
+
+/*=============================================================================
+MACROS / CONSTANTS
+=============================================================================*/
+
+static const int DEFAULT_ITERATIONS = 5;
+static const char* DEFAULT_MODELS_DIR = "models";
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+typedef std::chrono::steady_clock clock_type;
+
+enum stage
+{
+	STAGE_FILE_READ,
+	STAGE_JSON_PARSE,
+	STAGE_IMAGE_DECODE,
+	STAGE_BUFFER_BUILD,
+	STAGE_TOTAL,
+
+	STAGE_COUNT
+};
+
+static const char* STAGE_NAMES[STAGE_COUNT] =
+{
+	"file_read",
+	"json_parse",
+	"image_decode",
+	"buffer_build",
+	"total"
+};
+
+/**
+Results for one model across all iterations. Times are in milliseconds.
+*/
+struct model_result
+{
+	std::string				filename;
+	bool					loaded = true;
+	std::vector<double>		times[STAGE_COUNT];
+	size_t					vertex_bytes = 0;
+	size_t					index_bytes = 0;
+	size_t					image_bytes = 0;
+};
+
+/*=============================================================================
+VARIABLES
+=============================================================================*/
+
+static int						s_iterations = DEFAULT_ITERATIONS;
+static std::string				s_models_dir = DEFAULT_MODELS_DIR;
+static std::vector<std::string>	s_packs;			/* packs to mount, from the command line */
+
+/*=============================================================================
+METHODS
+=============================================================================*/
+
+/**
+Parses command line arguments.
+
+	-iterations <n>			Number of times to load each model.
+	-models <dir>			Directory to search for .gltf and .glb files.
+	-pack <file>			Mounts a pack file.
+
+args: list of arguments, excluding the name of the executable.
+*/
+static void parse_cmd_line(const std::vector<std::string>& args)
+{
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		if (args[i] == "-iterations" && i + 1 < args.size())
+		{
+			s_iterations = std::stoi(args[++i]);
+		}
+		else if (args[i] == "-models" && i + 1 < args.size())
+		{
+			s_models_dir = args[++i];
+		}
+		else if (args[i] == "-pack" && i + 1 < args.size())
+		{
+			s_packs.push_back(args[++i]);
+		}
+		else
+		{
+			LOG_WARN_FMT("Unknown command line argument {0}.", args[i]);
+		}
+	}
+}
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+/**
+Gets the peak resident set size of the process in bytes.
+*/
+static uint64_t get_peak_rss()
+{
+#if _WIN64
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+
+	/* Kilobytes on Linux */
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+/**
+Finds the .gltf and .glb files in a directory and its subdirectories.
+*/
+static void list_models(const std::string& dir_path, std::vector<std::string>& models)
+{
+	DIR* dir = opendir(dir_path.c_str());
+	if (!dir)
+	{
+		LOG_ERROR_FMT("Failed to open directory {0}.", dir_path);
+		return;
+	}
+
+	struct dirent* ent;
+	while ((ent = readdir(dir)) != NULL)
+	{
+		std::string name(ent->d_name);
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		std::string path = dir_path + "/" + name;
+		if (ent->d_type == DT_DIR)
+		{
+			list_models(path, models);
+		}
+		else if (jetz::utl::ends_with(name, ".gltf") || jetz::utl::ends_with(name, ".glb"))
+		{
+			models.push_back(path);
+		}
+	}
+
+	closedir(dir);
+}
+
+/**
+Builds the vertex and index data for a model the same way vlk_model does, with
+the engine's LOD and quantization settings.
+*/
+static void build_buffers(const jetz::gpu_gltf& gltf, jetz::gpu_mesh_packer& packer)
+{
+	for (const auto& mesh_def : gltf.model.meshes)
+	{
+		for (const auto& prim : mesh_def.primitives)
+		{
+			jetz::gpu_packed_primitive packed;
+			packer.add(gltf, prim, packed);
+		}
+	}
+}
+
+/**
+Loads a model once, adding the stage timings to the result.
+*/
+static bool run_iteration(model_result& result)
+{
+	auto start = clock_type::now();
+
+	jetz::gpu_gltf_timings timings;
+	auto gltf = jetz::gpu_gltf::load(result.filename, &timings);
+	if (!gltf)
+	{
+		return false;
+	}
+
+	auto build_start = clock_type::now();
+	jetz::gpu_mesh_packer packer(jetz::gpu::max_lods, jetz::gpu::quantize_vertices);
+	build_buffers(*gltf, packer);
+	double build_time = elapsed_ms(build_start);
+
+	size_t image_bytes = 0;
+	for (const auto& img : gltf->model.images)
+	{
+		image_bytes += img.image.size();
+	}
+
+	result.times[STAGE_FILE_READ].push_back(timings.file_read);
+	result.times[STAGE_JSON_PARSE].push_back(timings.parse);
+	result.times[STAGE_IMAGE_DECODE].push_back(timings.image_decode);
+	result.times[STAGE_BUFFER_BUILD].push_back(build_time);
+	result.times[STAGE_TOTAL].push_back(elapsed_ms(start));
+
+	result.vertex_bytes = packer.vertex_data.size();
+	result.index_bytes = packer.index_data.size();
+	result.image_bytes = image_bytes;
+	return true;
+}
+
+/**
+Escapes a string for a JSON string literal.
+*/
+static std::string json_escape(const std::string& str)
+{
+	std::string out;
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+			out += buf;
+		}
+		else
+		{
+			out += c;
+		}
+	}
+
+	return out;
+}
+
+static void write_json(const std::vector<model_result>& results)
+{
+	printf("{\n");
+	printf("\t\"iterations\": %d,\n", s_iterations);
+	printf("\t\"models\": [\n");
+
+	for (size_t m = 0; m < results.size(); ++m)
+	{
+		const model_result& result = results[m];
+		printf("\t\t{\n");
+		printf("\t\t\t\"file\": \"%s\",\n", json_escape(result.filename).c_str());
+
+		if (!result.loaded)
+		{
+			printf("\t\t\t\"error\": \"load failed\"\n");
+		}
+		else
+		{
+			printf("\t\t\t\"vertex_bytes\": %zu,\n", result.vertex_bytes);
+			printf("\t\t\t\"index_bytes\": %zu,\n", result.index_bytes);
+			printf("\t\t\t\"image_bytes\": %zu,\n", result.image_bytes);
+			printf("\t\t\t\"stages\": {\n");
+
+			for (int s = 0; s < STAGE_COUNT; ++s)
+			{
+				const auto& times = result.times[s];
+				double min_time = times[0];
+				double max_time = times[0];
+				double sum = 0;
+				for (double t : times)
+				{
+					min_time = t < min_time ? t : min_time;
+					max_time = t > max_time ? t : max_time;
+					sum += t;
+				}
+
+				printf("\t\t\t\t\"%s\": { \"min_ms\": %.3f, \"mean_ms\": %.3f, \"max_ms\": %.3f }%s\n",
+					STAGE_NAMES[s], min_time, sum / times.size(), max_time, s + 1 < STAGE_COUNT ? "," : "");
+			}
+
+			printf("\t\t\t}\n");
+		}
+
+		printf("\t\t}%s\n", m + 1 < results.size() ? "," : "");
+	}
+
+	printf("\t],\n");
+	printf("\t\"peak_rss_bytes\": %llu\n", (unsigned long long)get_peak_rss());
+	printf("}\n");
+}
+
+/**
+Main entry point.
+
+argc: number of arguments, including name of executable
+argv: array of the arguments
+*/
+int main(int argc, char* argv[])
+{
+	/* Log to stderr so stdout is only the report */
+	jetz::log::logger.register_target([](const std::string& msg) {
+		std::cerr << msg;
+	});
+
+	std::vector<std::string> args(argv + 1, argv + argc);
+	parse_cmd_line(args);
+
+	if (s_iterations < 1)
+	{
+		LOG_ERROR("Iteration count must be at least 1.");
+		return EXIT_FAILURE;
+	}
+
+	for (const auto& pack : s_packs)
+	{
+		jetz::filesystem::mount(pack);
+	}
+
+	std::vector<std::string> models;
+	list_models(s_models_dir, models);
+	std::sort(models.begin(), models.end());
+
+	std::vector<model_result> results(models.size());
+	for (size_t m = 0; m < models.size(); ++m)
+	{
+		results[m].filename = models[m];
+		for (int i = 0; i < s_iterations && results[m].loaded; ++i)
+		{
+			results[m].loaded = run_iteration(results[m]);
+		}
+	}
+
+	write_json(results);
+
+	jetz::filesystem::shutdown();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*=============================================================================
+gpu_cache_tests.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+/* Before jetz headers - common.h defines min/max macros that break gtest */
+#include "thirdparty/google_test/google_test.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "jetz/gpu/gpu_cache.h"
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+struct test_resource
+{
+	int value;
+
+	uint64_t get_memory_size() const
+	{
+		return 1;
+	}
+};
+
+typedef jetz::gpu_cache<test_resource> test_cache;
+
+/*=============================================================================
+TESTS
+=============================================================================*/
+
+TEST(GpuCacheTests, Intern_SamePath_SameId)
+{
+	jetz::asset_id a = jetz::asset_ids::intern("models/a.glb");
+	jetz::asset_id b = jetz::asset_ids::intern("models/b.glb");
+
+	EXPECT_NE(jetz::asset_ids::invalid, a);
+	EXPECT_NE(a, b);
+	EXPECT_EQ(a, jetz::asset_ids::intern("models/a.glb"));
+	EXPECT_EQ("models/b.glb", jetz::asset_ids::get_path(b));
+}
+
+TEST(GpuCacheTests, Handle_Resolved)
+{
+	test_cache cache;
+	jetz::asset_id id = jetz::asset_ids::intern("cache_a");
+
+	EXPECT_EQ(UINT32_MAX, cache.find(id).index);
+
+	cache.load(id, 0, []() { return std::make_shared<test_resource>(test_resource{ 5 }); });
+	auto handle = cache.find(id);
+	ASSERT_NE(nullptr, cache.get(handle, 0));
+	EXPECT_EQ(5, cache.get(handle, 0)->value);
+	EXPECT_EQ(5, cache.get(id, 0)->value);
+}
+
+TEST(GpuCacheTests, Handle_RemovedAndReloaded_Stale)
+{
+	test_cache cache;
+	jetz::asset_id id = jetz::asset_ids::intern("cache_a");
+
+	cache.load(id, 0, []() { return std::make_shared<test_resource>(test_resource{ 1 }); });
+	auto old_handle = cache.find(id);
+	EXPECT_TRUE(cache.remove(old_handle));
+
+	EXPECT_EQ(nullptr, cache.get(old_handle, 0));
+	EXPECT_EQ(UINT32_MAX, cache.find(id).index);
+
+	/* The slot is reused, but the old handle stays stale */
+	cache.load(id, 0, []() { return std::make_shared<test_resource>(test_resource{ 2 }); });
+	auto new_handle = cache.find(id);
+
+	EXPECT_EQ(old_handle.index, new_handle.index);
+	EXPECT_EQ(nullptr, cache.get(old_handle, 0));
+	ASSERT_NE(nullptr, cache.get(new_handle, 0));
+	EXPECT_EQ(2, cache.get(new_handle, 0)->value);
+}
+
+TEST(GpuCacheTests, Load_Concurrent_LoadsOnce)
+{
+	test_cache cache;
+	jetz::asset_id id = jetz::asset_ids::intern("cache_a");
+	std::atomic<int> load_count(0);
+
+	auto load = [&load_count]() {
+		load_count++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		return std::make_shared<test_resource>(test_resource{ 3 });
+	};
+
+	std::vector<std::shared_ptr<test_resource>> results(8);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		threads.emplace_back([&, i]() { results[i] = cache.load(id, 0, load); });
+	}
+
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	EXPECT_EQ(1, load_count);
+	for (const auto& r : results)
+	{
+		ASSERT_NE(nullptr, r);
+		EXPECT_EQ(results[0], r);
+	}
+}
+
+TEST(GpuCacheTests, Load_Failed_RetryDelayed)
+{
+	test_cache cache;
+	jetz::asset_id id = jetz::asset_ids::intern("cache_missing");
+	int load_count = 0;
+
+	auto load = [&load_count]() {
+		load_count++;
+		return std::shared_ptr<test_resource>();
+	};
+
+	EXPECT_EQ(nullptr, cache.load(id, 0, load));
+	EXPECT_EQ(nullptr, cache.load(id, 1, load));
+	EXPECT_EQ(1, load_count);
+
+	/* Retried once the delay has passed, then the delay doubles */
+	EXPECT_EQ(nullptr, cache.load(id, test_cache::retry_delay_min, load));
+	EXPECT_EQ(2, load_count);
+
+	EXPECT_EQ(nullptr, cache.load(id, test_cache::retry_delay_min * 2, load));
+	EXPECT_EQ(2, load_count);
+
+	EXPECT_EQ(nullptr, cache.load(id, test_cache::retry_delay_min * 3, load));
+	EXPECT_EQ(3, load_count);
+}
+
+TEST(GpuCacheTests, Load_Throws_FailedAndRethrown)
+{
+	test_cache cache;
+	jetz::asset_id id = jetz::asset_ids::intern("cache_throws");
+	int load_count = 0;
+
+	auto load = [&load_count]() -> std::shared_ptr<test_resource> {
+		load_count++;
+		throw std::runtime_error("load failed");
+	};
+
+	EXPECT_THROW(cache.load(id, 0, load), std::runtime_error);
+
+	/* Not left pending - treated as a failed load and retried after the delay */
+	EXPECT_EQ(nullptr, cache.load(id, 1, load));
+	EXPECT_EQ(1, load_count);
+
+	auto ok = []() { return std::make_shared<test_resource>(test_resource{ 3 }); };
+	auto res = cache.load(id, test_cache::retry_delay_min, ok);
+	ASSERT_NE(nullptr, res);
+	EXPECT_EQ(3, res->value);
+}
@@ -0,0 +1,64 @@
+/*=============================================================================
+gpu_free_list_tests.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+/* Before jetz headers - common.h defines min/max macros that break gtest */
+#include "thirdparty/google_test/google_test.h"
+
+#include "jetz/gpu/gpu_free_list.h"
+
+/*=============================================================================
+TESTS
+=============================================================================*/
+
+TEST(GpuFreeListTests, Allocate_Aligned_OffsetIsMultiple)
+{
+	jetz::gpu_free_list list(1000);
+
+	uint64_t a, b;
+	ASSERT_TRUE(list.allocate(10, 1, a));
+	ASSERT_TRUE(list.allocate(48, 24, b));
+
+	EXPECT_EQ(0u, a);
+	EXPECT_EQ(24u, b);
+	EXPECT_EQ(58u, list.get_used());
+
+	/* The padding between the two ranges is still usable */
+	uint64_t c;
+	ASSERT_TRUE(list.allocate(14, 1, c));
+	EXPECT_EQ(10u, c);
+}
+
+TEST(GpuFreeListTests, Allocate_TooLarge_Fails)
+{
+	jetz::gpu_free_list list(100);
+
+	uint64_t a;
+	ASSERT_TRUE(list.allocate(60, 4, a));
+	EXPECT_FALSE(list.allocate(60, 4, a));
+	EXPECT_FALSE(list.allocate(0, 4, a));
+}
+
+TEST(GpuFreeListTests, Free_Neighbors_Coalesce)
+{
+	jetz::gpu_free_list list(300);
+
+	uint64_t a, b, c;
+	ASSERT_TRUE(list.allocate(100, 1, a));
+	ASSERT_TRUE(list.allocate(100, 1, b));
+	ASSERT_TRUE(list.allocate(100, 1, c));
+
+	/* Free the outer ranges first, then the middle one joins them */
+	list.free(a, 100);
+	list.free(c, 100);
+	list.free(b, 100);
+	EXPECT_EQ(0u, list.get_used());
+
+	uint64_t all;
+	ASSERT_TRUE(list.allocate(300, 1, all));
+	EXPECT_EQ(0u, all);
+}
@@ -0,0 +1,166 @@
+/*=============================================================================
+gpu_mesh_optimizer_tests.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <array>
+
+#include "jetz/gpu/gpu_mesh_optimizer.h"
+#include "thirdparty/google_test/google_test.h"
+
+/*=============================================================================
+HELPERS
+=============================================================================*/
+
+/**
+Builds a flat grid of (size x size) quads with triangles in a scattered order.
+*/
+static jetz::gpu_mesh make_grid(uint32_t size)
+{
+	jetz::gpu_mesh mesh;
+
+	for (uint32_t y = 0; y <= size; ++y)
+	{
+		for (uint32_t x = 0; x <= size; ++x)
+		{
+			jetz::gpu_mesh_vertex v = {};
+			v.pos = glm::vec3((float)x, (float)y, 0.0f);
+			v.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+			mesh.vertices.push_back(v);
+		}
+	}
+
+	/* Visit quads with a large stride so the source order is cache unfriendly */
+	uint32_t quad_count = size * size;
+	for (uint32_t i = 0; i < quad_count; ++i)
+	{
+		uint32_t q = (i * 37) % quad_count;
+		uint32_t x = q % size;
+		uint32_t y = q / size;
+		uint32_t v0 = y * (size + 1) + x;
+		uint32_t v1 = v0 + 1;
+		uint32_t v2 = v0 + size + 1;
+		uint32_t v3 = v2 + 1;
+
+		mesh.indices.insert(mesh.indices.end(), { v0, v1, v2, v2, v1, v3 });
+	}
+
+	return mesh;
+}
+
+/**
+Gets the triangles of a mesh as sorted position triples so meshes can be
+compared independent of triangle and vertex order.
+*/
+static std::vector<std::array<float, 9>> get_sorted_tris(const jetz::gpu_mesh& mesh)
+{
+	std::vector<std::array<float, 9>> tris;
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		std::array<float, 9> t;
+		for (int k = 0; k < 3; ++k)
+		{
+			const auto& p = mesh.vertices[mesh.indices[i + k]].pos;
+			t[k * 3 + 0] = p.x;
+			t[k * 3 + 1] = p.y;
+			t[k * 3 + 2] = p.z;
+		}
+
+		tris.push_back(t);
+	}
+
+	std::sort(tris.begin(), tris.end());
+	return tris;
+}
+
+/*=============================================================================
+TESTS
+=============================================================================*/
+
+/*-----------------------------------------------------
+analyze_vertex_cache()
+-----------------------------------------------------*/
+
+TEST(GpuMeshOptimizerTests, AnalyzeVertexCache_SharedVertices_HitsCounted)
+{
+	/* Two triangles sharing an edge - 4 misses */
+	std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+	auto stats = jetz::gpu_mesh_optimizer::analyze_vertex_cache(indices, 4, 16);
+
+	EXPECT_FLOAT_EQ(2.0f, stats.acmr);
+	EXPECT_FLOAT_EQ(1.0f, stats.atvr);
+}
+
+/*-----------------------------------------------------
+optimize()
+-----------------------------------------------------*/
+
+TEST(GpuMeshOptimizerTests, Optimize_ScatteredGrid_AcmrImproved)
+{
+	auto mesh = make_grid(32);
+	auto before = jetz::gpu_mesh_optimizer::analyze_vertex_cache(mesh.indices, mesh.vertices.size(), 16);
+	auto tris_before = get_sorted_tris(mesh);
+
+	jetz::gpu_mesh_optimizer::optimize(mesh);
+
+	auto after = jetz::gpu_mesh_optimizer::analyze_vertex_cache(mesh.indices, mesh.vertices.size(), 16);
+	EXPECT_LT(after.acmr, before.acmr);
+	EXPECT_EQ(tris_before, get_sorted_tris(mesh));
+}
+
+TEST(GpuMeshOptimizerTests, Optimize_PartialTriangle_Unchanged)
+{
+	auto mesh = make_grid(4);
+	mesh.indices.push_back(0);
+	auto indices_before = mesh.indices;
+
+	jetz::gpu_mesh_optimizer::optimize(mesh);
+
+	EXPECT_EQ(indices_before, mesh.indices);
+}
+
+/*-----------------------------------------------------
+optimize_vertex_cache()
+-----------------------------------------------------*/
+
+TEST(GpuMeshOptimizerTests, OptimizeVertexCache_PartialTriangle_TrailingIndicesKept)
+{
+	auto mesh = make_grid(4);
+	mesh.indices.insert(mesh.indices.end(), { 7, 8 });
+	size_t count = mesh.indices.size();
+
+	jetz::gpu_mesh_optimizer::optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+
+	ASSERT_EQ(count, mesh.indices.size());
+	EXPECT_EQ(7u, mesh.indices[count - 2]);
+	EXPECT_EQ(8u, mesh.indices[count - 1]);
+}
+
+/*-----------------------------------------------------
+optimize_vertex_fetch()
+-----------------------------------------------------*/
+
+TEST(GpuMeshOptimizerTests, OptimizeVertexFetch_UnusedVertices_Dropped)
+{
+	jetz::gpu_mesh mesh;
+	mesh.vertices.resize(5);
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+	{
+		mesh.vertices[i].pos = glm::vec3((float)i, 0.0f, 0.0f);
+	}
+
+	mesh.indices = { 4, 2, 0 };
+
+	jetz::gpu_mesh_optimizer::optimize_vertex_fetch(mesh);
+
+	ASSERT_EQ(3u, mesh.vertices.size());
+	EXPECT_EQ(std::vector<uint32_t>({ 0, 1, 2 }), mesh.indices);
+	EXPECT_EQ(4.0f, mesh.vertices[0].pos.x);
+	EXPECT_EQ(2.0f, mesh.vertices[1].pos.x);
+	EXPECT_EQ(0.0f, mesh.vertices[2].pos.x);
+}
@@ -0,0 +1,229 @@
+/*=============================================================================
+filesystem_tests.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Before jetz headers - common.h defines min/max macros that break gtest */
+#include "thirdparty/google_test/google_test.h"
+
+#include "jetz/main/filesystem.h"
+#include "jetz/main/lz4.h"
+#include "jetz/main/pack_file.h"
+
+/*=============================================================================
+HELPERS
+=============================================================================*/
+
+static void write_file(const std::string& filename, const std::string& contents)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(contents.data(), contents.size());
+}
+
+static std::string view_to_string(const jetz::file_view& view)
+{
+	return std::string((const char*)view.get_data(), view.get_size());
+}
+
+/*=============================================================================
+TESTS
+=============================================================================*/
+
+/*-----------------------------------------------------
+lz4
+-----------------------------------------------------*/
+
+TEST(FilesystemTests, Lz4_RoundTrip_DataRestored)
+{
+	std::vector<char> src;
+	for (int i = 0; i < 10000; ++i)
+	{
+		src.push_back((char)(i % 13 == 0 ? i * 7 : i % 5));
+	}
+
+	std::vector<char> compressed(jetz::lz4::compress_bound(src.size()));
+	size_t size = jetz::lz4::compress(src.data(), src.size(), compressed.data(), compressed.size());
+	ASSERT_GT(size, 0u);
+	EXPECT_LT(size, src.size());
+
+	std::vector<char> dst(src.size());
+	EXPECT_TRUE(jetz::lz4::decompress(compressed.data(), size, dst.data(), dst.size()));
+	EXPECT_EQ(src, dst);
+}
+
+TEST(FilesystemTests, Lz4_TruncatedInput_Fails)
+{
+	std::string src(1000, 'a');
+	std::vector<char> compressed(jetz::lz4::compress_bound(src.size()));
+	size_t size = jetz::lz4::compress(src.data(), src.size(), compressed.data(), compressed.size());
+
+	std::vector<char> dst(src.size());
+	EXPECT_FALSE(jetz::lz4::decompress(compressed.data(), size - 1, dst.data(), dst.size()));
+}
+
+/*-----------------------------------------------------
+normalize()
+-----------------------------------------------------*/
+
+TEST(FilesystemTests, Normalize_MixedPath_Normalized)
+{
+	EXPECT_EQ("models/cube/Cube.gltf", jetz::filesystem::normalize("./models\\cube//x/../Cube.gltf"));
+	EXPECT_EQ("../a", jetz::filesystem::normalize("../a"));
+}
+
+/*-----------------------------------------------------
+Packs
+-----------------------------------------------------*/
+
+TEST(FilesystemTests, Pack_MountedPack_EntriesResolved)
+{
+	std::string text(5000, 'x');
+	write_file("pack_test_a.txt", text);
+	write_file("pack_test_b.txt", "loose b");
+
+	std::vector<jetz::pack_build_item> items =
+	{
+		{ "dir/a.txt", "pack_test_a.txt" },
+		{ "dir/b.txt", "pack_test_b.txt" },
+	};
+
+	ASSERT_TRUE(jetz::pack_file::build("pack_test.pak", items, true));
+
+	/* Compressible entry is compressed, tiny one isn't */
+	jetz::pack_file pack("pack_test.pak");
+	ASSERT_TRUE(pack.is_open());
+	EXPECT_EQ(2u, pack.get_entry_count());
+
+	const jetz::pack_entry* a = pack.find("dir/a.txt");
+	ASSERT_NE(nullptr, a);
+	EXPECT_TRUE((a->flags & jetz::pack_file::flag_lz4) != 0);
+	EXPECT_EQ(0u, a->offset % jetz::pack_file::default_alignment);
+	EXPECT_EQ(nullptr, pack.find("dir/c.txt"));
+
+	/* Resolve through the filesystem */
+	ASSERT_TRUE(jetz::filesystem::mount("pack_test.pak"));
+
+	auto view = jetz::filesystem::open("dir/./a.txt");
+	ASSERT_NE(nullptr, view);
+	EXPECT_EQ(text, view_to_string(*view));
+
+	std::vector<char> b;
+	EXPECT_TRUE(jetz::filesystem::read("dir\\b.txt", b));
+	EXPECT_EQ("loose b", std::string(b.begin(), b.end()));
+
+	/* Loose files still resolve */
+	EXPECT_TRUE(jetz::filesystem::exists("pack_test_b.txt"));
+	EXPECT_FALSE(jetz::filesystem::exists("dir/missing.txt"));
+
+	view.reset();
+	jetz::filesystem::unmount_all();
+	std::remove("pack_test.pak");
+	std::remove("pack_test_a.txt");
+	std::remove("pack_test_b.txt");
+}
+
+/*-----------------------------------------------------
+Async reads
+-----------------------------------------------------*/
+
+TEST(FilesystemTests, ReadAsync_Batch_RangesRead)
+{
+	std::string text;
+	for (int i = 0; i < 3000; ++i)
+	{
+		text += (char)('a' + i % 26);
+	}
+
+	write_file("async_test.txt", text);
+
+	char buffer[100];
+	std::atomic<int> callbacks(0);
+	auto callback = [&callbacks](jetz::io_request&) { callbacks++; };
+
+	std::vector<jetz::io_read> reads(3);
+	reads[0].filename = "async_test.txt";
+	reads[0].offset = 2000;
+	reads[1].filename = "async_test.txt";
+	reads[1].offset = 100;
+	reads[1].size = sizeof(buffer);
+	reads[1].buffer = buffer;
+	reads[2].filename = "async_missing.txt";
+
+	auto requests = jetz::filesystem::read_batch(reads, callback);
+	ASSERT_EQ(3u, requests.size());
+
+	/* Whole tail into the request's own data */
+	EXPECT_EQ(jetz::io_status::DONE, requests[0]->wait());
+	EXPECT_EQ(text.substr(2000), std::string(requests[0]->get_data().begin(), requests[0]->get_data().end()));
+
+	/* Range into a caller buffer */
+	EXPECT_EQ(jetz::io_status::DONE, requests[1]->wait());
+	EXPECT_EQ(sizeof(buffer), requests[1]->get_bytes_read());
+	EXPECT_EQ(text.substr(100, sizeof(buffer)), std::string(buffer, sizeof(buffer)));
+
+	EXPECT_EQ(jetz::io_status::FAILED, requests[2]->wait());
+	EXPECT_EQ(3, callbacks);
+
+	std::remove("async_test.txt");
+}
+
+TEST(FilesystemTests, ReadAsync_LargeFile_ReadInChunks)
+{
+	/* Spans several chunks, so reads continue past the first one */
+	std::string text;
+	for (size_t i = 0; i < jetz::async_io::chunk_size * 2 + 1000; ++i)
+	{
+		text += (char)('a' + i % 26);
+	}
+
+	write_file("async_large_test.txt", text);
+
+	jetz::io_read read;
+	read.filename = "async_large_test.txt";
+	read.offset = 10;
+
+	auto request = jetz::filesystem::read_async(read);
+	EXPECT_EQ(jetz::io_status::DONE, request->wait());
+	EXPECT_EQ(text.size() - 10, request->get_bytes_read());
+	EXPECT_TRUE(text.substr(10) == std::string(request->get_data().begin(), request->get_data().end()));
+
+	std::remove("async_large_test.txt");
+}
+
+TEST(FilesystemTests, ReadAsync_CancelledRequests_Complete)
+{
+	write_file("async_cancel_test.txt", std::string(1000, 'x'));
+
+	jetz::io_read read;
+	read.filename = "async_cancel_test.txt";
+
+	/* Each request either finished before the cancel or is cancelled */
+	std::vector<sptr<jetz::io_request>> requests;
+	for (int i = 0; i < 32; ++i)
+	{
+		requests.push_back(jetz::filesystem::read_async(read));
+	}
+
+	for (auto& request : requests)
+	{
+		request->cancel();
+	}
+
+	for (auto& request : requests)
+	{
+		jetz::io_status status = request->wait();
+		EXPECT_TRUE(status == jetz::io_status::DONE || status == jetz::io_status::CANCELLED);
+	}
+
+	jetz::filesystem::shutdown();
+	std::remove("async_cancel_test.txt");
+}
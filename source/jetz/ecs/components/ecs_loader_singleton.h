@@ -8,9 +8,10 @@ ecs_loader_singleton.h
 INCLUDES
 =============================================================================*/
 
-#include <string>
 #include <unordered_set>
 
+#include "jetz/main/asset_id.h"
+
 /*=============================================================================
 NAMESPACE
 =============================================================================*/
@@ -23,7 +24,7 @@ models, etc).
 */
 class ecs_loader_singleton {
 public:
-	std::unordered_set<std::string> models;
+	std::unordered_set<asset_id> models;
 };
 
 }   /* namespace jetz */
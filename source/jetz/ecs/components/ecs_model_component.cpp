@@ -62,7 +62,8 @@ void ecs_model_component::load_lua(ecs& ecs, lua& script)
 			}
 
 			model_filename = val.value;
-			ecs.loader_singleton.models.insert(val.value);
+			model_id = asset_ids::intern(val.value);
+			ecs.loader_singleton.models.insert(model_id);
 		}
 	}
 }
@@ -11,6 +11,8 @@ INCLUDES
 #include <string>
 
 #include "jetz/ecs/ecs_component.h"
+#include "jetz/gpu/gpu_model.h"
+#include "jetz/main/asset_id.h"
 
 /*=============================================================================
 NAMESPACE
@@ -34,6 +36,13 @@ public:
 	std::string			model_filename;
 	std::string			material_filename;
 
+	/*
+	Render state
+	*/
+	asset_id			model_id = asset_ids::invalid;
+	model_handle		model;				/* resolved from model_id when stale */
+	gpu_model_instance	instance;
+
 	/*-----------------------------------------------------
 	ecs_component
 	-----------------------------------------------------*/
@@ -34,10 +34,12 @@ void ecs_loader_system::run(ecs& ecs, gpu& gpu)
 {
 	auto& loader = ecs.loader_singleton;
 
-	for (const auto& model_file : loader.models)
+	for (auto model_id : loader.models)
 	{
-		gpu.load_model(model_file);
+		gpu.load_model(asset_ids::get_path(model_id));
 	}
+
+	loader.models.clear();
 }
 
 /*=============================================================================
@@ -46,9 +46,23 @@ void ecs_render_system::run(ecs& ecs, gpu& gpu, gpu_frame& frame)
 		}
 
 		auto model = ecs.models.get(ent);
-		auto gpu_model = gpu.get_model(model->model_filename).lock();
+		auto gpu_model = gpu.get_model(model->model);
+		if (!gpu_model)
+		{
+			/* Handle is unresolved or stale - look the model up again */
+			model->model = gpu.find_model(model->model_id);
+			gpu_model = gpu.get_model(model->model);
+		}
+
+		if (!gpu_model)
+		{
+			/* Not loaded yet or evicted - request a (re)load */
+			ecs.loader_singleton.models.insert(model->model_id);
+			continue;
+		}
+
 		auto transform = ecs.transforms.get(ent);
-		gpu_model->render(frame, *transform);
+		gpu_model->render(frame, *transform, model->instance);
 	}
 }
 
@@ -6,8 +6,14 @@ gpu.cpp
 INCLUDES
 =============================================================================*/
 
+#include <algorithm>
+#include <vector>
+
 #include "jetz/gpu/gpu.h"
+#include "jetz/main/filesystem.h"
 #include "jetz/main/log.h"
+#include "jetz/main/utl.h"
+#include "thirdparty/tinygltf/src/stb_image.h"
 
 /*=============================================================================
 NAMESPACE
@@ -15,16 +21,41 @@ NAMESPACE
 
 namespace jetz {
 
-int gpu::max_num_materials = 100;
-
 /* Default to double buffering. */
 uint8_t gpu::num_frame_buf = 2;
 
+bool gpu::quantize_vertices = true;
+
+uint32_t gpu::max_lods = 4;
+
+float gpu::material_budget_fraction = 0.05f;
+float gpu::model_budget_fraction = 0.6f;
+float gpu::texture_budget_fraction = 0.35f;
+
+uint32_t gpu::cache_trim_interval = 60;
+
+bool gpu::stream_textures = true;
+
+uint64_t gpu::texture_stream_budget = 256ull * 1024 * 1024;
+
+uint32_t gpu::texture_stream_min_size = 64;
+
+bool gpu::bindless_textures = true;
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Seed of the second hash that confirms a shared texture match */
+static const uint64_t shared_texture_check_seed = 0x9e3779b97f4a7c15ull;
+
 /*=============================================================================
 CONSTRUCTORS
 =============================================================================*/
 
 gpu::gpu()
+	:
+	_frame_num(0)
 {
 }
 
@@ -38,35 +69,27 @@ PUBLIC METHODS
 
 wptr<gpu_material> gpu::get_material(const std::string& filename)
 {
-	/* Check if already loaded */
-	if (_materials.find(filename) != _materials.end())
-	{
-		return _materials[filename];
-	}
-
-	return wptr<gpu_material>();
+	return _materials.get(asset_ids::intern(filename), _frame_num);
 }
 
 wptr<gpu_model> gpu::get_model(const std::string& filename)
 {
-	/* Check if already loaded */
-	if (_models.find(filename) != _models.end())
-	{
-		return _models[filename];
-	}
+	return _models.get(asset_ids::intern(filename), _frame_num);
+}
 
-	return wptr<gpu_model>();
+gpu_model* gpu::get_model(model_handle handle)
+{
+	return _models.get(handle, _frame_num);
 }
 
-wptr<gpu_texture> gpu::get_texture(const std::string& filename)
+model_handle gpu::find_model(asset_id id)
 {
-	/* Check if already loaded */
-	if (_textures.find(filename) != _textures.end())
-	{
-		return _textures[filename];
-	}
+	return _models.find(id);
+}
 
-	return wptr<gpu_texture>();
+wptr<gpu_texture> gpu::get_texture(const std::string& filename)
+{
+	return _textures.get(asset_ids::intern(filename), _frame_num);
 }
 
 wptr<gpu_material> gpu::load_material(const std::string& filename)
@@ -77,26 +100,124 @@ wptr<gpu_material> gpu::load_material(const std::string& filename)
 
 wptr<gpu_model> gpu::load_model(const std::string& filename)
 {
-	/* Check if already loaded */
-	auto model = get_model(filename);
-	if (!model.expired())
+	/* Loads at most once, even if several threads ask for the model at the same time */
+	return _models.load(asset_ids::intern(filename), _frame_num, [this, &filename]() {
+		return sptr<gpu_model>(get_factory()->load_gltf(filename));
+	});
+}
+
+wptr<gpu_texture> jetz::gpu::load_texture(const std::string& filename)
+{
+	/* Loads at most once, even if several threads ask for the texture at the same time */
+	return _textures.load(asset_ids::intern(filename), _frame_num, [this, &filename]() {
+		auto file = filesystem::open(filename);
+		if (!file)
+		{
+			LOG_ERROR_FMT("Failed to open texture {0}.", filename);
+			return sptr<gpu_texture>();
+		}
+
+		int width, height, comp;
+		stbi_uc* pixels = stbi_load_from_memory(file->get_data(), (int)file->get_size(), &width, &height, &comp, STBI_rgb_alpha);
+		if (!pixels)
+		{
+			LOG_ERROR_FMT("Failed to load texture {0}.", filename);
+			return sptr<gpu_texture>();
+		}
+
+		size_t size = (size_t)width * (size_t)height * 4;
+		auto texture = create_shared_texture(pixels, size, (uint32_t)width, (uint32_t)height);
+
+		stbi_image_free(pixels);
+		return texture;
+	});
+}
+
+sptr<gpu_texture> gpu::create_shared_texture
+	(
+	const void*				data,
+	size_t					size,
+	uint32_t				width,
+	uint32_t				height
+	)
+{
+	uint64_t hash = utl::hash_bytes(data, size);
+	uint32_t dims[] = { width, height };
+	hash = utl::hash_bytes(dims, sizeof(dims), hash);
+
+	shared_texture shared = {};
+	shared.size = size;
+	shared.width = width;
+	shared.height = height;
+	shared.check_hash = utl::hash_bytes(data, size, shared_texture_check_seed);
+
+	/* Share an existing texture with the same content */
+	bool collision = false;
 	{
-		return model;
+		std::lock_guard<std::mutex> lock(_shared_mutex);
+		auto existing = find_shared_texture(hash, shared, collision);
+		if (existing)
+		{
+			return existing;
+		}
 	}
 
-	/* Not loaded, load it now */
-	auto new_model_uptr = get_factory()->load_gltf(filename);
+	/* Created without the lock so loads of other textures don't wait on it */
+	auto texture = sptr<gpu_texture>(get_factory()->create_texture(data, size, width, height));
+	if (collision)
+	{
+		return texture;
+	}
 
-	/* Convert to shared pointer and store in the model cache */
-	auto new_model_sptr = _models[filename] = sptr<gpu_model>(std::move(new_model_uptr));
+	/* Another thread may have created the same texture meanwhile - keep the first one */
+	std::lock_guard<std::mutex> lock(_shared_mutex);
+	auto existing = find_shared_texture(hash, shared, collision);
+	if (existing)
+	{
+		return existing;
+	}
 
-	return wptr<gpu_model>(new_model_sptr);
+	if (!collision)
+	{
+		shared.texture = texture;
+		_shared_textures[hash] = shared;
+	}
+
+	return texture;
 }
 
-wptr<gpu_texture> jetz::gpu::load_texture(const std::string& filename)
+sptr<gpu_material> gpu::find_shared_material(uint64_t hash)
+{
+	std::lock_guard<std::mutex> lock(_shared_mutex);
+	auto it = _shared_materials.find(hash);
+	if (it == _shared_materials.end())
+	{
+		return sptr<gpu_material>();
+	}
+
+	return it->second.lock();
+}
+
+void gpu::share_material(uint64_t hash, const sptr<gpu_material>& material)
+{
+	std::lock_guard<std::mutex> lock(_shared_mutex);
+	_shared_materials[hash] = material;
+}
+
+void gpu::end_frame()
+{
+	_frame_num++;
+
+	if (cache_trim_interval > 0 && _frame_num % cache_trim_interval == 0)
+	{
+		trim_cache();
+	}
+}
+
+uint64_t gpu::get_memory_budget(uint64_t) const
 {
-	LOG_FATAL("jetz::gpu::load_texture");
-	return wptr<gpu_texture>();
+	/* Unknown - overriden by derived classes */
+	return 0;
 }
 
 void gpu::wait_idle() const
@@ -112,43 +233,79 @@ void gpu::unload_cache()
 {
 	wait_idle();
 
-	unload_materials();
-	unload_models();
-	unload_textures();
+	_materials.clear();
+	_models.clear();
+	_textures.clear();
+
+	std::lock_guard<std::mutex> lock(_shared_mutex);
+	_shared_materials.clear();
+	_shared_textures.clear();
 }
 
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
 
-void gpu::unload_materials()
+sptr<gpu_texture> gpu::find_shared_texture(uint64_t hash, const shared_texture& match, bool& collision)
 {
-	for (auto mat : _materials)
+	auto it = _shared_textures.find(hash);
+	if (it == _shared_textures.end())
 	{
-		mat.second.reset();
+		return sptr<gpu_texture>();
 	}
 
-	_materials.clear();
+	auto existing = it->second.texture.lock();
+	if (!existing)
+	{
+		return sptr<gpu_texture>();
+	}
+
+	const auto& other = it->second;
+	if (other.size == match.size && other.width == match.width && other.height == match.height && other.check_hash == match.check_hash)
+	{
+		return existing;
+	}
+
+	/* Different pixels with the same hash - don't share, and keep the existing entry */
+	LOG_WARN_FMT("Texture content hash collision ({0:016x}), texture not shared.", hash);
+	collision = true;
+	return sptr<gpu_texture>();
 }
 
-void gpu::unload_models()
+void gpu::prune_shared()
 {
-	for (auto model : _models)
+	std::lock_guard<std::mutex> lock(_shared_mutex);
+
+	for (auto it = _shared_materials.begin(); it != _shared_materials.end();)
 	{
-		model.second.reset();
+		it = it->second.expired() ? _shared_materials.erase(it) : ++it;
 	}
 
-	_models.clear();
+	for (auto it = _shared_textures.begin(); it != _shared_textures.end();)
+	{
+		it = it->second.texture.expired() ? _shared_textures.erase(it) : ++it;
+	}
 }
 
-void gpu::unload_textures()
+void gpu::trim_cache()
 {
-	for (auto tex : _textures)
+	prune_shared();
+
+	uint64_t cache_size = _materials.get_size() + _models.get_size() + _textures.get_size();
+
+	uint64_t budget = get_memory_budget(cache_size);
+	if (budget == 0)
 	{
-		tex.second.reset();
+		return;
 	}
 
-	_textures.clear();
+	/* Resources used by a frame that may still be in flight can't be freed yet */
+	uint64_t frame = _frame_num;
+	uint64_t min_frame = frame > num_frame_buf ? frame - num_frame_buf : 0;
+
+	_materials.trim((uint64_t)(budget * material_budget_fraction), min_frame, frame, "material");
+	_models.trim((uint64_t)(budget * model_budget_fraction), min_frame, frame, "model");
+	_textures.trim((uint64_t)(budget * texture_budget_fraction), min_frame, frame, "texture");
 }
 
 }   /* namespace jetz */
@@ -8,13 +8,18 @@ gpu.h
 INCLUDES
 =============================================================================*/
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 
+#include "jetz/gpu/gpu_cache.h"
 #include "jetz/gpu/gpu_factory.h"
 #include "jetz/gpu/gpu_material.h"
 #include "jetz/gpu/gpu_model.h"
 #include "jetz/gpu/gpu_texture.h"
+#include "jetz/main/asset_id.h"
 #include "jetz/main/common.h"
 
 /*=============================================================================
@@ -38,9 +43,6 @@ public:
 	Public static variables
 	-----------------------------------------------------*/
 
-	/* The maximum number of materials allowed. */
-	static int max_num_materials;
-
 	/**
 	The number of frame buffers to use for rendering.
 	Double buffered == 2
@@ -48,17 +50,76 @@ public:
 	*/
 	static uint8_t num_frame_buf;
 
+	/**
+	Quantize model vertices on import (16-bit positions, octahedral normals,
+	half-float UVs). Halves vertex memory at a small precision cost.
+	*/
+	static bool quantize_vertices;
+
+	/**
+	The max number of LODs generated per mesh primitive on import, including
+	the full detail mesh. 1 disables LOD generation.
+	*/
+	static uint32_t max_lods;
+
+	/**
+	Fraction of the GPU memory budget each resource cache may use before
+	least recently used resources are evicted.
+	*/
+	static float material_budget_fraction;
+	static float model_budget_fraction;
+	static float texture_budget_fraction;
+
+	/** How often (in frames) the resource caches are checked against their budgets. */
+	static uint32_t cache_trim_interval;
+
+	/**
+	Stream texture mip levels based on on-screen texel density. When disabled
+	textures are fully resident.
+	*/
+	static bool stream_textures;
+
+	/** GPU memory budget for streamed texture mips in bytes. */
+	static uint64_t texture_stream_budget;
+
+	/** Streamed textures start with the mips no larger than this (in pixels) resident. */
+	static uint32_t texture_stream_min_size;
+
+	/**
+	Sample material textures from one global descriptor array indexed in the
+	shader, when the device supports descriptor indexing. Otherwise each
+	material binds its own descriptor set.
+	*/
+	static bool bindless_textures;
+
 	/*-----------------------------------------------------
 	Public Methods
 	-----------------------------------------------------*/
 
+	/**
+	Advances the frame counter used to track when cached resources were last
+	used. Periodically evicts unused resources from caches that are over
+	budget. Call once at the end of each frame.
+	*/
+	void end_frame();
+
 	/**
 	Gets the GPU factory used to load models, etc.
 	*/
 	virtual sptr<gpu_factory> get_factory() const = 0;
 
 	/**
-	Returns the specified material. If the material has not been loaded, null will be returned.
+	Gets the GPU memory available to the resource caches in bytes. Memory used
+	by the caches themselves is included. Returns 0 if unknown, which disables
+	eviction.
+
+	@param cache_size The GPU memory currently used by the resource caches.
+	*/
+	virtual uint64_t get_memory_budget(uint64_t cache_size) const;
+
+	/**
+	Returns the specified material. If the material has not been loaded (or was evicted), null will be returned.
+	Marks the material as used this frame.
 
 	@param filename The material to get.
 	@returns The loaded material if found, NULL otherwise.
@@ -66,7 +127,8 @@ public:
 	wptr<gpu_material> get_material(const std::string& filename);
 
 	/**
-	Returns the specified model. If the model has not been loaded, null will be returned.
+	Returns the specified model. If the model has not been loaded (or was evicted), null will be returned.
+	Marks the model as used this frame.
 
 	@param filename The model to get.
 	@returns The loaded model if found, NULL otherwise.
@@ -74,13 +136,69 @@ public:
 	wptr<gpu_model> get_model(const std::string& filename);
 
 	/**
-	Returns the specified texture. If the texture has not been loaded, null will be returned.
+	Returns the model a handle refers to. Marks the model as used this frame.
+	This is the per-frame path - resolve the handle once with find_model.
+
+	@param handle The model handle.
+	@returns The model, or NULL if the handle is stale or the model isn't
+		loaded. The model stays valid until the next end_frame.
+	*/
+	gpu_model* get_model(model_handle handle);
+
+	/**
+	Gets a handle to a model in the cache.
+
+	@param id The model's asset ID.
+	@returns The handle, or an invalid handle if the model isn't in the cache.
+	*/
+	model_handle find_model(asset_id id);
+
+	/**
+	Returns the specified texture. If the texture has not been loaded (or was evicted), null will be returned.
+	Marks the texture as used this frame.
 
 	@param filename The texture to get.
 	@returns The loaded texture if found, NULL otherwise.
 	*/
 	wptr<gpu_texture> get_texture(const std::string& filename);
 
+	/**
+	Returns a texture with the given RGBA8 pixel data. Textures are shared by
+	content: if a live texture with identical pixels exists it is returned
+	instead of uploading a new one. The texture is freed once the last
+	reference to it is released.
+
+	@param data The pixel data.
+	@param size The size of the pixel data in bytes.
+	@param width The width in pixels.
+	@param height The height in pixels.
+	@returns The texture.
+	*/
+	sptr<gpu_texture> create_shared_texture
+		(
+		const void*				data,
+		size_t					size,
+		uint32_t				width,
+		uint32_t				height
+		);
+
+	/**
+	Finds a live shared material by content hash.
+
+	@param hash The material content hash.
+	@returns The material if found, NULL otherwise.
+	*/
+	sptr<gpu_material> find_shared_material(uint64_t hash);
+
+	/**
+	Registers a material to be shared by content hash. The registry doesn't
+	keep the material alive.
+
+	@param hash The material content hash.
+	@param material The material.
+	*/
+	void share_material(uint64_t hash, const sptr<gpu_material>& material);
+
 	/**
 	Returns the specified material, loading it if needed.
 
@@ -90,7 +208,8 @@ public:
 	wptr<gpu_material> load_material(const std::string& filename);
 
 	/**
-	Returns the specified model, loading it if needed.
+	Returns the specified model, loading it if needed. Safe to call from any
+	thread; concurrent loads of the same model wait for a single load.
 
 	@param filename The model file to load.
 	@returns The loaded model if found, NULL otherwise.
@@ -98,7 +217,9 @@ public:
 	wptr<gpu_model> load_model(const std::string& filename);
 
 	/**
-	Returns the specified texture, loading it if needed.
+	Returns the specified texture, loading it if needed. Texture files with
+	identical pixels share one texture. Safe to call from any thread;
+	concurrent loads of the same texture wait for a single load.
 
 	@param filename The texture file to load.
 	@returns The loaded texture if found, NULL otherwise.
@@ -106,7 +227,8 @@ public:
 	wptr<gpu_texture> load_texture(const std::string& filename);
 
 	/**
-	Waits until the GPU has finished executing the current command buffer.
+	Waits until the GPU has finished executing the current command buffer and
+	any pending uploads.
 	*/
 	virtual void wait_idle() const;
 
@@ -123,26 +245,68 @@ protected:
 
 private:
 
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	/**
+	A texture in the shared registry. A hash match alone could be a
+	collision, so the texture is only reused if the size and a second hash
+	of the pixels also match.
+	*/
+	struct shared_texture
+	{
+		wptr<gpu_texture>		texture;
+		size_t					size;
+		uint32_t				width;
+		uint32_t				height;
+		uint64_t				check_hash;		/* hash of the pixels with a different seed */
+	};
+
 	/*-----------------------------------------------------
 	Private variables
 	-----------------------------------------------------*/
 
 	/** Materials cache. */
-	std::unordered_map<std::string, sptr<gpu_material>> _materials;
+	gpu_cache<gpu_material> _materials;
 
 	/** Models cache. */
-	std::unordered_map<std::string, sptr<gpu_model>> _models;
+	gpu_cache<gpu_model> _models;
 
 	/** Textures cache. */
-	std::unordered_map<std::string, sptr<gpu_texture>> _textures;
+	gpu_cache<gpu_texture> _textures;
+
+	/** Number of frames rendered. Read by loader threads. */
+	std::atomic<uint64_t> _frame_num;
+
+	/** Guards the shared resource registries. */
+	std::mutex _shared_mutex;
+
+	/** Materials shared by content hash. */
+	std::unordered_map<uint64_t, wptr<gpu_material>> _shared_materials;
+
+	/** Textures shared by content hash. */
+	std::unordered_map<uint64_t, shared_texture> _shared_textures;
 
 	/*-----------------------------------------------------
 	Private Methods
 	-----------------------------------------------------*/
 
-	void unload_materials();
-	void unload_models();
-	void unload_textures();
+	/**
+	Evicts least recently used resources from each cache until it fits its
+	budget.
+	*/
+	void trim_cache();
+
+	/**
+	Finds a live shared texture with matching content. Sets collision if the
+	hash matches a texture with different content. Requires _shared_mutex.
+	*/
+	sptr<gpu_texture> find_shared_texture(uint64_t hash, const shared_texture& match, bool& collision);
+
+	/** Removes registry entries for shared resources that have been freed. */
+	void prune_shared();
+
 };
 
 }   /* namespace jetz */
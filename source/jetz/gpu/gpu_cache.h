@@ -0,0 +1,505 @@
+/*=============================================================================
+gpu_cache.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "jetz/main/asset_id.h"
+#include "jetz/main/common.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+A reference to a resource in a gpu_cache. Resolving a handle is an array
+index and a generation check; a handle goes stale once its resource is
+evicted or unloaded.
+*/
+template <typename T>
+struct gpu_handle
+{
+	uint32_t		index = UINT32_MAX;
+	uint32_t		generation = 0;
+};
+
+/**
+An entry in one of the GPU resource caches.
+*/
+template <typename T>
+struct gpu_cache_entry
+{
+	sptr<T>						resource;
+	std::shared_future<sptr<T>>	pending;				/* In-flight load, if any */
+	uint64_t					size = 0;				/* GPU memory used by the resource in bytes */
+	uint64_t					last_used_frame = 0;	/* Last frame the resource was referenced */
+	uint64_t					retry_frame = 0;		/* First frame a failed load may be retried */
+	uint32_t					failures = 0;			/* Failed loads in a row */
+	asset_id					id = asset_ids::invalid;
+	uint32_t					generation = 0;			/* Incremented each time the entry is removed */
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+A thread-safe cache of GPU resources keyed by asset ID.
+
+Entries are split across shards by asset ID, each with its own lock, so
+threads working on different assets rarely contend. A handle's index
+encodes its shard, so resolving a handle locks only that shard. Freed slots
+are reused, so handles carry a generation to detect stale references.
+
+Concurrent loads of the same asset share one in-flight load: the first
+caller loads the resource and the others wait on its result. A failed load
+is remembered, and the asset isn't loaded again until a retry delay has
+passed. The delay doubles with each failure in a row.
+*/
+template <typename T>
+class gpu_cache {
+
+public:
+
+	/** Number of lock shards. */
+	static const uint32_t shard_count = 16;
+
+	/** Frames to wait before retrying a failed load. Doubles with each failure, up to retry_delay_max. */
+	static const uint32_t retry_delay_min = 60;
+	static const uint32_t retry_delay_max = 60 * 60;
+
+	typedef std::function<sptr<T>()> load_func;
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Removes all entries. In-flight loads still complete for their callers
+	but aren't added back to the cache.
+	*/
+	void clear()
+	{
+		for (auto& shard : _shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (auto& entry : shard.entries)
+			{
+				if (entry.id != asset_ids::invalid)
+				{
+					remove(shard, entry);
+				}
+			}
+		}
+	}
+
+	/**
+	Gets a handle to an asset's entry.
+
+	@returns The handle, or an invalid handle if the asset isn't in the cache.
+	*/
+	gpu_handle<T> find(asset_id id)
+	{
+		uint32_t shard_idx = id % shard_count;
+		shard_type& shard = _shards[shard_idx];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		gpu_handle<T> handle;
+		auto it = shard.lookup.find(id);
+		if (it != shard.lookup.end())
+		{
+			handle.index = it->second * shard_count + shard_idx;
+			handle.generation = shard.entries[it->second].generation;
+		}
+
+		return handle;
+	}
+
+	/**
+	Gets a loaded resource by asset ID and marks it as used.
+
+	@returns The resource, or NULL if it isn't loaded.
+	*/
+	sptr<T> get(asset_id id, uint64_t frame)
+	{
+		shard_type& shard = _shards[id % shard_count];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto it = shard.lookup.find(id);
+		if (it == shard.lookup.end())
+		{
+			return sptr<T>();
+		}
+
+		auto& entry = shard.entries[it->second];
+		entry.last_used_frame = frame;
+		return entry.resource;
+	}
+
+	/**
+	Resolves a handle and marks the resource as used.
+
+	@returns The resource, or NULL if the handle is stale or the resource isn't
+		loaded. Resources are only removed by trim and clear, so the pointer
+		stays valid until one of those runs.
+	*/
+	T* get(gpu_handle<T> handle, uint64_t frame)
+	{
+		shard_type& shard = _shards[handle.index % shard_count];
+		uint32_t slot = handle.index / shard_count;
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		if (slot >= shard.entries.size())
+		{
+			return NULL;
+		}
+
+		auto& entry = shard.entries[slot];
+		if (entry.generation != handle.generation || !entry.resource)
+		{
+			return NULL;
+		}
+
+		entry.last_used_frame = frame;
+		return entry.resource.get();
+	}
+
+	/**
+	Gets the GPU memory used by the cached resources in bytes.
+	*/
+	uint64_t get_size()
+	{
+		uint64_t size = 0;
+		for (auto& shard : _shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (const auto& entry : shard.entries)
+			{
+				size += entry.size;
+			}
+		}
+
+		return size;
+	}
+
+	/**
+	Gets a resource, loading it if needed. If another thread is already
+	loading the resource, waits for that load instead of starting another.
+	After a failed load (NULL resource), calls return NULL without loading
+	until the retry delay has passed.
+
+	@param id The asset ID.
+	@param frame The current frame, to mark the resource as used.
+	@param load Loads the resource. Called without any cache locks held. If it
+		throws, the load counts as failed and the exception is rethrown.
+	@returns The resource, or NULL if the load failed.
+	*/
+	sptr<T> load(asset_id id, uint64_t frame, const load_func& load)
+	{
+		shard_type& shard = _shards[id % shard_count];
+		std::promise<sptr<T>> promise;
+		std::shared_future<sptr<T>> pending;
+		uint32_t generation = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto& entry = insert(shard, id);
+			entry.last_used_frame = frame;
+
+			if (entry.resource)
+			{
+				return entry.resource;
+			}
+
+			if (entry.pending.valid())
+			{
+				pending = entry.pending;
+			}
+			else if (frame < entry.retry_frame)
+			{
+				/* Failed recently - don't retry yet */
+				return sptr<T>();
+			}
+			else
+			{
+				/* This thread loads the resource */
+				entry.pending = promise.get_future().share();
+				generation = entry.generation;
+			}
+		}
+
+		if (pending.valid())
+		{
+			return pending.get();
+		}
+
+		sptr<T> resource;
+		try
+		{
+			resource = load();
+		}
+		catch (...)
+		{
+			/* LOG_FATAL throws - release waiters and back off as for a failed load before passing it on */
+			finish_load(shard, id, generation, frame, resource);
+			promise.set_value(resource);
+			throw;
+		}
+
+		finish_load(shard, id, generation, frame, resource);
+		promise.set_value(resource);
+		return resource;
+	}
+
+	/**
+	Removes an entry, releasing its resource. Handles to it go stale.
+
+	@returns True if the handle referred to an entry.
+	*/
+	bool remove(gpu_handle<T> handle)
+	{
+		shard_type& shard = _shards[handle.index % shard_count];
+		uint32_t slot = handle.index / shard_count;
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		if (slot >= shard.entries.size()
+			|| shard.entries[slot].generation != handle.generation
+			|| shard.entries[slot].id == asset_ids::invalid)
+		{
+			return false;
+		}
+
+		remove(shard, shard.entries[slot]);
+		return true;
+	}
+
+	/**
+	Evicts least recently used resources until the cache fits a budget.
+	Resources used since min_frame, still referenced outside the cache, or
+	still loading are kept. Failed entries hold no memory and are kept so
+	their retry delay isn't reset.
+
+	@param budget The budget in bytes.
+	@param min_frame Resources used on or after this frame are kept.
+	@param frame The current frame, for logging.
+	@param type_name Resource type name for logging.
+	*/
+	void trim(uint64_t budget, uint64_t min_frame, uint64_t frame, const char* type_name)
+	{
+		struct candidate
+		{
+			gpu_handle<T>		handle;
+			uint64_t			last_used_frame;
+			uint64_t			size;
+			asset_id			id;
+		};
+
+		uint64_t used = 0;
+		std::vector<candidate> candidates;
+
+		for (uint32_t shard_idx = 0; shard_idx < shard_count; ++shard_idx)
+		{
+			shard_type& shard = _shards[shard_idx];
+			std::lock_guard<std::mutex> lock(shard.mutex);
+
+			for (uint32_t slot = 0; slot < shard.entries.size(); ++slot)
+			{
+				const auto& entry = shard.entries[slot];
+				used += entry.size;
+
+				if (entry.id != asset_ids::invalid
+					&& entry.resource
+					&& entry.last_used_frame < min_frame
+					&& entry.resource.use_count() <= 1
+					&& !entry.pending.valid())
+				{
+					candidate c;
+					c.handle.index = slot * shard_count + shard_idx;
+					c.handle.generation = entry.generation;
+					c.last_used_frame = entry.last_used_frame;
+					c.size = entry.size;
+					c.id = entry.id;
+					candidates.push_back(c);
+				}
+			}
+		}
+
+		if (used <= budget)
+		{
+			return;
+		}
+
+		/* Least recently used first */
+		std::sort(candidates.begin(), candidates.end(), [](const candidate& a, const candidate& b) {
+			return a.last_used_frame < b.last_used_frame;
+		});
+
+		for (const auto& c : candidates)
+		{
+			if (used <= budget)
+			{
+				break;
+			}
+
+			/* The entry may have been used or removed since it was checked */
+			if (!remove_if_unused(c.handle, min_frame))
+			{
+				continue;
+			}
+
+			LOG_INFO_FMT("Evicting {0} {1} ({2:.2f} MB, unused for {3} frames).",
+				type_name, asset_ids::get_path(c.id), c.size / (1024.0 * 1024.0), frame - c.last_used_frame);
+
+			used -= c.size;
+		}
+
+		if (used > budget)
+		{
+			LOG_WARN_FMT("The {0} cache is over budget ({1:.2f} MB / {2:.2f} MB) but nothing else can be evicted.",
+				type_name, used / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+		}
+	}
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct shard_type
+	{
+		std::mutex								mutex;
+		std::vector<gpu_cache_entry<T>>			entries;
+		std::vector<uint32_t>					free;		/* indices of free entries */
+		std::unordered_map<asset_id, uint32_t>	lookup;		/* asset ID to entry index */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Gets the entry for an asset, adding an empty one if needed. Shard must be locked. */
+	gpu_cache_entry<T>& insert(shard_type& shard, asset_id id)
+	{
+		auto it = shard.lookup.find(id);
+		if (it != shard.lookup.end())
+		{
+			return shard.entries[it->second];
+		}
+
+		uint32_t slot;
+		if (!shard.free.empty())
+		{
+			slot = shard.free.back();
+			shard.free.pop_back();
+		}
+		else
+		{
+			slot = (uint32_t)shard.entries.size();
+			shard.entries.emplace_back();
+		}
+
+		shard.entries[slot].id = id;
+		shard.lookup[id] = slot;
+
+		return shard.entries[slot];
+	}
+
+	/**
+	Stores the result of a load and clears the entry's in-flight load. A NULL
+	resource starts the retry delay. Skipped if the entry was removed while
+	loading.
+	*/
+	void finish_load(shard_type& shard, asset_id id, uint32_t generation, uint64_t frame, const sptr<T>& resource)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto it = shard.lookup.find(id);
+		if (it == shard.lookup.end() || shard.entries[it->second].generation != generation)
+		{
+			return;
+		}
+
+		auto& entry = shard.entries[it->second];
+		entry.resource = resource;
+		entry.size = resource ? resource->get_memory_size() : 0;
+		entry.pending = std::shared_future<sptr<T>>();
+
+		if (resource)
+		{
+			entry.failures = 0;
+			entry.retry_frame = 0;
+		}
+		else
+		{
+			uint32_t shift = (std::min)(entry.failures, 16u);
+			uint64_t delay = (std::min)((uint64_t)retry_delay_min << shift, (uint64_t)retry_delay_max);
+			entry.failures++;
+			entry.retry_frame = frame + delay;
+
+			LOG_WARN_FMT("Failed to load {0}, retrying in {1} frames.", asset_ids::get_path(id), delay);
+		}
+	}
+
+	/** Removes an entry. Shard must be locked. */
+	void remove(shard_type& shard, gpu_cache_entry<T>& entry)
+	{
+		shard.lookup.erase(entry.id);
+		shard.free.push_back((uint32_t)(&entry - shard.entries.data()));
+
+		entry.resource.reset();
+		entry.pending = std::shared_future<sptr<T>>();
+		entry.size = 0;
+		entry.retry_frame = 0;
+		entry.failures = 0;
+		entry.id = asset_ids::invalid;
+		entry.generation++;
+	}
+
+	/** Removes an entry if it's still evictable. */
+	bool remove_if_unused(gpu_handle<T> handle, uint64_t min_frame)
+	{
+		shard_type& shard = _shards[handle.index % shard_count];
+		uint32_t slot = handle.index / shard_count;
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto& entry = shard.entries[slot];
+		if (entry.generation != handle.generation
+			|| entry.last_used_frame >= min_frame
+			|| entry.resource.use_count() > 1
+			|| entry.pending.valid())
+		{
+			return false;
+		}
+
+		remove(shard, entry);
+		return true;
+	}
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	shard_type								_shards[shard_count];
+};
+
+}   /* namespace jetz */
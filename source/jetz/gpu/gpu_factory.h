@@ -11,8 +11,9 @@ INCLUDES
 #include <string>
 
 #include "jetz/main/common.h"
+#include "jetz/gpu/gpu_gltf.h"
 #include "jetz/gpu/gpu_model.h"
-#include "thirdparty/tinygltf/tiny_gltf.h"
+#include "jetz/gpu/gpu_texture.h"
 
 /*=============================================================================
 NAMESPACE
@@ -37,7 +38,18 @@ public:
 
 	uptr<gpu_model> load_gltf(const std::string& filename);
 
-	virtual uptr<gpu_model> create_model(uptr<tinygltf::Model> gltf) = 0;
+	virtual uptr<gpu_model> create_model(uptr<gpu_gltf> gltf) = 0;
+
+	/**
+	Creates a texture from RGBA8 pixel data.
+	*/
+	virtual uptr<gpu_texture> create_texture
+		(
+		const void*					data,
+		size_t						size,
+		uint32_t					width,
+		uint32_t					height
+		) = 0;
 
 private:
 
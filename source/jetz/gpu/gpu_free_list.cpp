@@ -0,0 +1,124 @@
+/*=============================================================================
+gpu_free_list.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <iterator>
+
+#include "jetz/gpu/gpu_free_list.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+gpu_free_list::gpu_free_list(uint64_t size)
+	:
+	_size(size),
+	_used(0)
+{
+	if (size > 0)
+	{
+		_free[0] = size;
+	}
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+bool gpu_free_list::allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	if (size == 0)
+	{
+		return false;
+	}
+
+	if (alignment == 0)
+	{
+		alignment = 1;
+	}
+
+	for (auto it = _free.begin(); it != _free.end(); ++it)
+	{
+		uint64_t start = it->first;
+		uint64_t end = it->first + it->second;
+		uint64_t aligned = (start + alignment - 1) / alignment * alignment;
+
+		if (aligned + size > end)
+		{
+			continue;
+		}
+
+		/* Split the range - padding before the allocation and the tail after it stay free */
+		_free.erase(it);
+
+		if (aligned > start)
+		{
+			_free[start] = aligned - start;
+		}
+
+		if (aligned + size < end)
+		{
+			_free[aligned + size] = end - (aligned + size);
+		}
+
+		_used += size;
+		offset = aligned;
+		return true;
+	}
+
+	return false;
+}
+
+void gpu_free_list::free(uint64_t offset, uint64_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	_used -= size;
+
+	auto next = _free.lower_bound(offset);
+
+	/* Merge with the free range after this one */
+	if (next != _free.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = _free.erase(next);
+	}
+
+	/* Merge with the free range before this one */
+	if (next != _free.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += size;
+			return;
+		}
+	}
+
+	_free[offset] = size;
+}
+
+uint64_t gpu_free_list::get_size() const
+{
+	return _size;
+}
+
+uint64_t gpu_free_list::get_used() const
+{
+	return _used;
+}
+
+}   /* namespace jetz */
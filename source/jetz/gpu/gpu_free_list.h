@@ -0,0 +1,75 @@
+/*=============================================================================
+gpu_free_list.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <map>
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Sub-allocates ranges of a fixed size block, such as a large GPU buffer. Free
+ranges are kept sorted by offset and allocations take the first range that
+fits. Freed ranges are merged with their free neighbors so the block doesn't
+fragment into small pieces.
+
+Only offsets are tracked - the caller owns the memory and must remember the
+size of each allocation to free it.
+*/
+class gpu_free_list {
+
+public:
+
+	gpu_free_list(uint64_t size);
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Allocates a range.
+
+	@param size The size of the range.
+	@param alignment The offset is a multiple of this. Doesn't need to be a power of two.
+	@param offset Set to the offset of the range.
+	@returns False if no free range is large enough.
+	*/
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+
+	/**
+	Frees a range returned by allocate.
+	*/
+	void free(uint64_t offset, uint64_t size);
+
+	/** Gets the size of the block. */
+	uint64_t get_size() const;
+
+	/** Gets the number of allocated bytes. Padding before aligned ranges stays free. */
+	uint64_t get_used() const;
+
+private:
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	uint64_t						_size;
+	uint64_t						_used;
+	std::map<uint64_t, uint64_t>	_free;		/* offset -> size of each free range */
+};
+
+}   /* namespace jetz */
@@ -0,0 +1,246 @@
+/*=============================================================================
+gpu_gltf.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <chrono>
+#include <cstring>
+
+#include "jetz/gpu/gpu_gltf.h"
+#include "jetz/main/log.h"
+#include "jetz/main/utl.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* GLB layout - 12 byte header, then chunks with an 8 byte header (length, type) */
+static const size_t glb_header_size = 12;
+static const size_t glb_chunk_header_size = 8;
+static const uint32_t glb_chunk_bin = 0x004E4942;	/* "BIN\0" */
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+typedef std::chrono::steady_clock clock_type;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+static bool file_exists(const std::string& filename, void*)
+{
+	return filesystem::exists(filename);
+}
+
+static std::string expand_file_path(const std::string& filename, void*)
+{
+	/* Paths are used as is so they match pack entries */
+	return filename;
+}
+
+static bool read_whole_file
+	(
+	std::vector<unsigned char>*	out,
+	std::string*				err,
+	const std::string&			filename,
+	void*						user_data
+	)
+{
+	auto start = clock_type::now();
+	auto file = filesystem::open(filename);
+	if (!file)
+	{
+		if (err)
+		{
+			*err += "Failed to read file: " + filename + "\n";
+		}
+
+		return false;
+	}
+
+	out->assign(file->get_data(), file->get_data() + file->get_size());
+
+	((gpu_gltf_timings*)user_data)->file_read += elapsed_ms(start);
+	return true;
+}
+
+static bool load_image_data
+	(
+	tinygltf::Image*			image,
+	const int					image_idx,
+	std::string*				err,
+	std::string*				warn,
+	int							req_width,
+	int							req_height,
+	const unsigned char*		bytes,
+	int							size,
+	void*						user_data
+	)
+{
+	auto start = clock_type::now();
+	bool result = tinygltf::LoadImageData(image, image_idx, err, warn, req_width, req_height, bytes, size, NULL);
+
+	((gpu_gltf_timings*)user_data)->image_decode += elapsed_ms(start);
+	return result;
+}
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+gpu_gltf::gpu_gltf()
+	:
+	_bin_buffer(-1),
+	_bin_data(NULL),
+	_bin_size(0)
+{
+}
+
+gpu_gltf::~gpu_gltf()
+{
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+uptr<gpu_gltf> gpu_gltf::load(const std::string& filename, gpu_gltf_timings* timings)
+{
+	auto start = clock_type::now();
+	gpu_gltf_timings stage_timings;
+
+	auto gltf = uptr<gpu_gltf>(new gpu_gltf());
+	tinygltf::TinyGLTF loader;
+	std::string err;
+	std::string warn;
+	bool loadSuccess(false);
+
+	/* Resolve the model's files (and any external buffers and images) through the virtual filesystem */
+	tinygltf::FsCallbacks fs = {};
+	fs.FileExists = &file_exists;
+	fs.ExpandFilePath = &expand_file_path;
+	fs.ReadWholeFile = &read_whole_file;
+	fs.WriteWholeFile = &tinygltf::WriteWholeFile;
+	fs.user_data = &stage_timings;	/* stage timings for the callbacks */
+	loader.SetFsCallbacks(fs);
+	loader.SetImageLoader(&load_image_data, &stage_timings);
+
+	/*
+	Load and parse model file
+	*/
+	if (utl::ends_with(filename, ".glb"))
+	{
+		/* GLTF binary format - map the file and leave the BIN chunk in place */
+		auto read_start = clock_type::now();
+		gltf->_file = filesystem::open(filename);
+		stage_timings.file_read += elapsed_ms(read_start);
+
+		if (!gltf->_file)
+		{
+			LOG_ERROR_FMT("Failed to open GLTF model {0}.", filename);
+			return nullptr;
+		}
+
+		const uint8_t* data = gltf->_file->get_data();
+		size_t size = gltf->_file->get_size();
+
+		/* External buffers and images are relative to the file's directory */
+		size_t slash = filename.find_last_of("/\\");
+		std::string base_dir = slash == std::string::npos ? "" : filename.substr(0, slash);
+
+		loader.SetCopyBinaryChunk(false);
+		loadSuccess = loader.LoadBinaryFromMemory(&gltf->model, &err, &warn, data, (unsigned int)size, base_dir);
+
+		/* Find the BIN chunk - it follows the JSON chunk */
+		uint32_t json_length = 0;
+		if (size >= glb_header_size + glb_chunk_header_size)
+		{
+			memcpy(&json_length, data + glb_header_size, sizeof(json_length));
+		}
+
+		size_t bin_chunk = glb_header_size + glb_chunk_header_size + json_length;
+		if (bin_chunk + glb_chunk_header_size <= size)
+		{
+			uint32_t bin_length, bin_type;
+			memcpy(&bin_length, data + bin_chunk, sizeof(bin_length));
+			memcpy(&bin_type, data + bin_chunk + 4, sizeof(bin_type));
+
+			if (bin_type == glb_chunk_bin && bin_chunk + glb_chunk_header_size + bin_length <= size)
+			{
+				gltf->_bin_data = data + bin_chunk + glb_chunk_header_size;
+				gltf->_bin_size = bin_length;
+			}
+		}
+
+		/* The BIN chunk backs the first buffer if it has no URI */
+		if (gltf->_bin_data && !gltf->model.buffers.empty() && gltf->model.buffers[0].uri.empty())
+		{
+			gltf->_bin_buffer = 0;
+		}
+	}
+	else
+	{
+		/* Regular ASCII GLTF format */
+		loadSuccess = loader.LoadASCIIFromFile(&gltf->model, &err, &warn, filename);
+	}
+
+	if (!err.empty() || !loadSuccess)
+	{
+		LOG_ERROR_FMT("Failed to load GLTF model: {0}", err);
+		return nullptr;
+	}
+
+	if (!warn.empty())
+	{
+		LOG_WARN(warn);
+	}
+
+	if (timings)
+	{
+		stage_timings.parse = elapsed_ms(start) - stage_timings.file_read - stage_timings.image_decode;
+		*timings = stage_timings;
+	}
+
+	return gltf;
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+const unsigned char* gpu_gltf::get_buffer_data(int buffer, size_t& size) const
+{
+	if (buffer < 0 || buffer >= (int)model.buffers.size())
+	{
+		size = 0;
+		return NULL;
+	}
+
+	if (buffer == _bin_buffer)
+	{
+		size = _bin_size;
+		return _bin_data;
+	}
+
+	const auto& data = model.buffers[buffer].data;
+	size = data.size();
+	return data.data();
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,99 @@
+/*=============================================================================
+gpu_gltf.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstddef>
+#include <string>
+
+#include "jetz/main/common.h"
+#include "jetz/main/filesystem.h"
+#include "thirdparty/tinygltf/tiny_gltf.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+Time spent in each stage of loading a model, in milliseconds.
+*/
+struct gpu_gltf_timings
+{
+	double		file_read = 0;		/* the model file and any external buffers and images */
+	double		parse = 0;			/* JSON parsing and everything else not listed */
+	double		image_decode = 0;
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+A parsed glTF model and the memory backing its buffers.
+
+Files load through the virtual filesystem. A .glb is mapped (or read in place
+from a pack) and its BIN chunk is read in place rather than copied into the
+tinygltf model, so the buffer data exists once while the model is loaded.
+*/
+class gpu_gltf {
+
+public:
+
+	gpu_gltf();
+	~gpu_gltf();
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Loads a .gltf or .glb file.
+
+	@param timings Optional output - time spent in each stage of the load.
+	@returns The loaded model, or nullptr on error.
+	*/
+	static uptr<gpu_gltf> load(const std::string& filename, gpu_gltf_timings* timings = NULL);
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Gets the bytes of a buffer.
+
+	@param buffer The buffer index.
+	@param size Output - the size of the buffer in bytes.
+	@returns The buffer data, or NULL if the buffer doesn't exist.
+	*/
+	const unsigned char* get_buffer_data(int buffer, size_t& size) const;
+
+	/*-----------------------------------------------------
+	Public variables
+	-----------------------------------------------------*/
+
+	tinygltf::Model					model;
+
+private:
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	uptr<file_view>					_file;			/* .glb contents, if any */
+	int								_bin_buffer;	/* buffer backed by the BIN chunk, or -1 */
+	const unsigned char*			_bin_data;
+	size_t							_bin_size;
+};
+
+}   /* namespace jetz */
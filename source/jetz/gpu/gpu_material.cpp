@@ -32,6 +32,11 @@ gpu_material::~gpu_material()
 {
 }
 
+uint64_t gpu_material::get_memory_size() const
+{
+	return 0;
+}
+
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
@@ -8,6 +8,8 @@ gpu_material.h
 INCLUDES
 =============================================================================*/
 
+#include <cstdint>
+
 /*=============================================================================
 NAMESPACE
 =============================================================================*/
@@ -29,6 +31,12 @@ public:
 	Public Methods
 	-----------------------------------------------------*/
 
+	/**
+	Gets the GPU memory used by this resource in bytes. Used to enforce the
+	resource cache budgets.
+	*/
+	virtual uint64_t get_memory_size() const;
+
 private:
 
 	/*-----------------------------------------------------
@@ -0,0 +1,448 @@
+/*=============================================================================
+gpu_mesh.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "jetz/gpu/gpu_gltf.h"
+#include "jetz/gpu/gpu_mesh.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Gets a pointer to the start of an accessor element and the stride between
+elements. Returns NULL if the accessor can't be read.
+*/
+static const unsigned char* get_accessor_data
+	(
+	const gpu_gltf&				gltf,
+	const tinygltf::Accessor&	accessor,
+	size_t&						stride
+	)
+{
+	if (accessor.bufferView < 0 || accessor.bufferView >= (int)gltf.model.bufferViews.size())
+	{
+		LOG_ERROR_FMT("Accessor {0} has invalid buffer view {1}.", accessor.name, accessor.bufferView);
+		return NULL;
+	}
+
+	if (accessor.sparse.isSparse)
+	{
+		LOG_WARN_FMT("Sparse accessor {0} not supported; using base values only.", accessor.name);
+	}
+
+	const auto& bv = gltf.model.bufferViews[accessor.bufferView];
+	size_t buf_size = 0;
+	const unsigned char* buf = gltf.get_buffer_data(bv.buffer, buf_size);
+	if (!buf)
+	{
+		LOG_ERROR_FMT("Buffer view {0} has invalid buffer {1}.", bv.name, bv.buffer);
+		return NULL;
+	}
+
+	int byte_stride = accessor.ByteStride(bv);
+	if (byte_stride <= 0)
+	{
+		LOG_ERROR_FMT("Invalid byte stride {0} for accessor {1}.", byte_stride, accessor.name);
+		return NULL;
+	}
+
+	int component_size = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+	int num_components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	if (component_size <= 0 || num_components <= 0)
+	{
+		LOG_ERROR_FMT("Accessor {0} has an invalid component type or element type.", accessor.name);
+		return NULL;
+	}
+
+	/* The last element must end inside the buffer - compared as remaining sizes so nothing can wrap */
+	size_t elem_size = (size_t)component_size * num_components;
+	size_t start = bv.byteOffset + accessor.byteOffset;
+	if (accessor.count == 0
+		|| start < bv.byteOffset
+		|| start > buf_size
+		|| elem_size > buf_size - start
+		|| (accessor.count - 1) > (buf_size - start - elem_size) / (size_t)byte_stride)
+	{
+		LOG_ERROR_FMT("Accessor {0} reads outside of buffer {1}.", accessor.name, bv.buffer);
+		return NULL;
+	}
+
+	stride = static_cast<size_t>(byte_stride);
+	return buf + start;
+}
+
+/**
+Reads a single component and converts it to float, applying glTF
+normalization rules for integer types.
+*/
+static float read_component(const unsigned char* src, int component_type, bool normalized)
+{
+	switch (component_type)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+	{
+		float v;
+		memcpy(&v, src, sizeof(v));
+		return v;
+	}
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+	{
+		float v = (float)*(const int8_t*)src;
+		return normalized ? (std::max)(v / 127.0f, -1.0f) : v;
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+	{
+		float v = (float)*(const uint8_t*)src;
+		return normalized ? v / 255.0f : v;
+	}
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+	{
+		int16_t s;
+		memcpy(&s, src, sizeof(s));
+		return normalized ? (std::max)(s / 32767.0f, -1.0f) : (float)s;
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+	{
+		uint16_t s;
+		memcpy(&s, src, sizeof(s));
+		return normalized ? s / 65535.0f : (float)s;
+	}
+	default:
+		return 0.0f;
+	}
+}
+
+/**
+Reads a single unsigned index value.
+*/
+static uint32_t read_index(const unsigned char* src, int component_type)
+{
+	switch (component_type)
+	{
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		return *(const uint8_t*)src;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+	{
+		uint16_t s;
+		memcpy(&s, src, sizeof(s));
+		return s;
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+	{
+		uint32_t u;
+		memcpy(&u, src, sizeof(u));
+		return u;
+	}
+	default:
+		return 0;
+	}
+}
+
+/**
+Reads a float vector attribute from an accessor into the interleaved vertices.
+
+@param offset The byte offset of the destination attribute in gpu_mesh_vertex.
+@param num_comp The number of float components in the destination attribute.
+*/
+static bool read_attribute
+	(
+	const gpu_gltf&					gltf,
+	const tinygltf::Primitive&		prim,
+	const char*						name,
+	size_t							offset,
+	int								num_comp,
+	std::vector<gpu_mesh_vertex>&	vertices
+	)
+{
+	auto attr = prim.attributes.find(name);
+	if (attr == prim.attributes.end())
+	{
+		/* Not found - leave zeroed */
+		return false;
+	}
+
+	const auto& a = gltf.model.accessors[attr->second];
+	size_t stride = 0;
+	const unsigned char* src = get_accessor_data(gltf, a, stride);
+	if (!src)
+	{
+		return false;
+	}
+
+	if (a.count != vertices.size())
+	{
+		LOG_ERROR_FMT("Attribute {0} count {1} does not match vertex count {2}.", name, a.count, vertices.size());
+		return false;
+	}
+
+	int src_comp = tinygltf::GetNumComponentsInType(a.type);
+	int comp_size = tinygltf::GetComponentSizeInBytes(a.componentType);
+	int n = (std::min)(src_comp, num_comp);
+
+	for (size_t i = 0; i < a.count; ++i)
+	{
+		const unsigned char* elem = src + i * stride;
+		float* dst = (float*)((char*)&vertices[i] + offset);
+
+		for (int c = 0; c < n; ++c)
+		{
+			dst[c] = read_component(elem + c * comp_size, a.componentType, a.normalized);
+		}
+	}
+
+	return true;
+}
+
+/**
+Encodes a unit normal using octahedral mapping into two values in [-1, 1].
+*/
+static glm::vec2 oct_encode(glm::vec3 n)
+{
+	float len = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (len == 0.0f)
+	{
+		/* Missing normal - pick any direction */
+		return glm::vec2(0.0f, 0.0f);
+	}
+
+	n /= len;
+
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		/* Fold the lower hemisphere over the diagonals */
+		e.x = (1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return e;
+}
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+gpu_mesh::gpu_mesh()
+	: use_16bit_indices(false)
+{
+}
+
+gpu_mesh::~gpu_mesh()
+{
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+bool gpu_mesh::load_gltf_primitive
+	(
+	const gpu_gltf&				gltf,
+	const tinygltf::Primitive&	prim,
+	gpu_mesh&					mesh
+	)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.lods.clear();
+
+	if (prim.mode != TINYGLTF_MODE_TRIANGLES && prim.mode != -1)
+	{
+		LOG_WARN_FMT("Primitive mode {0} not supported; skipping primitive.", prim.mode);
+		return false;
+	}
+
+	/* Position determines the vertex count */
+	auto pos_attr = prim.attributes.find("POSITION");
+	if (pos_attr == prim.attributes.end())
+	{
+		LOG_ERROR("Primitive has no POSITION attribute.");
+		return false;
+	}
+
+	const auto& pos_accessor = gltf.model.accessors[pos_attr->second];
+	mesh.vertices.resize(pos_accessor.count, gpu_mesh_vertex{});
+
+	/* Repack attributes into the interleaved stream */
+	if (!read_attribute(gltf, prim, "POSITION", offsetof(gpu_mesh_vertex, pos), 3, mesh.vertices))
+	{
+		mesh.vertices.clear();
+		return false;
+	}
+
+	read_attribute(gltf, prim, "NORMAL", offsetof(gpu_mesh_vertex, normal), 3, mesh.vertices);
+	read_attribute(gltf, prim, "TEXCOORD_0", offsetof(gpu_mesh_vertex, uv), 2, mesh.vertices);
+
+	/* Non-indexed primitives get a sequential index list */
+	if (prim.indices < 0)
+	{
+		if (mesh.vertices.size() % 3 != 0)
+		{
+			LOG_ERROR_FMT("Vertex count {0} is not a multiple of 3.", mesh.vertices.size());
+			mesh.vertices.clear();
+			return false;
+		}
+
+		mesh.indices.resize(mesh.vertices.size());
+		for (uint32_t i = 0; i < mesh.indices.size(); ++i)
+		{
+			mesh.indices[i] = i;
+		}
+
+		mesh.use_16bit_indices = mesh.vertices.size() <= UINT16_MAX + 1;
+		return true;
+	}
+
+	/* Copy only the referenced index range */
+	const auto& a = gltf.model.accessors[prim.indices];
+	if (a.count % 3 != 0)
+	{
+		LOG_ERROR_FMT("Index count {0} is not a multiple of 3.", a.count);
+		mesh.vertices.clear();
+		return false;
+	}
+
+	size_t stride = 0;
+	const unsigned char* src = get_accessor_data(gltf, a, stride);
+	if (!src)
+	{
+		mesh.vertices.clear();
+		return false;
+	}
+
+	mesh.indices.resize(a.count);
+	for (size_t i = 0; i < a.count; ++i)
+	{
+		mesh.indices[i] = read_index(src + i * stride, a.componentType);
+
+		if (mesh.indices[i] >= mesh.vertices.size())
+		{
+			LOG_ERROR_FMT("Index {0} out of range for {1} vertices.", mesh.indices[i], mesh.vertices.size());
+			mesh.vertices.clear();
+			mesh.indices.clear();
+			return false;
+		}
+	}
+
+	/* Vulkan has no 8-bit index type so bytes are widened to 16-bit */
+	mesh.use_16bit_indices = a.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+
+	return true;
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+uint32_t gpu_mesh::get_index_size() const
+{
+	return use_16bit_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void gpu_mesh::get_bounds(glm::vec3& min, glm::vec3& max) const
+{
+	if (vertices.empty())
+	{
+		min = glm::vec3(0.0f);
+		max = glm::vec3(0.0f);
+		return;
+	}
+
+	min = vertices[0].pos;
+	max = vertices[0].pos;
+
+	for (const auto& v : vertices)
+	{
+		min = glm::min(min, v.pos);
+		max = glm::max(max, v.pos);
+	}
+}
+
+float gpu_mesh::get_uv_density() const
+{
+	size_t index_count = lods.empty() ? indices.size() : lods[0].index_count;
+
+	/* Ratio of total UV area to total surface area */
+	double uv_area = 0.0;
+	double pos_area = 0.0;
+	for (size_t i = 0; i + 2 < index_count; i += 3)
+	{
+		const auto& v0 = vertices[indices[i + 0]];
+		const auto& v1 = vertices[indices[i + 1]];
+		const auto& v2 = vertices[indices[i + 2]];
+
+		pos_area += glm::length(glm::cross(v1.pos - v0.pos, v2.pos - v0.pos));
+
+		glm::vec2 e1 = v1.uv - v0.uv;
+		glm::vec2 e2 = v2.uv - v0.uv;
+		uv_area += fabs(e1.x * e2.y - e1.y * e2.x);
+	}
+
+	if (pos_area <= 0.0)
+	{
+		return 0.0f;
+	}
+
+	return (float)sqrt(uv_area / pos_area);
+}
+
+glm::mat4 gpu_mesh::quantize(std::vector<gpu_mesh_quantized_vertex>& out) const
+{
+	glm::vec3 min, max;
+	get_bounds(min, max);
+
+	/* Avoid divide by zero for flat meshes */
+	glm::vec3 extent = max - min;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (extent[i] <= 0.0f)
+		{
+			extent[i] = 1.0f;
+		}
+	}
+
+	out.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const auto& v = vertices[i];
+		auto& q = out[i];
+
+		glm::vec3 p = (v.pos - min) / extent;
+		q.pos[0] = glm::packUnorm1x16(p.x);
+		q.pos[1] = glm::packUnorm1x16(p.y);
+		q.pos[2] = glm::packUnorm1x16(p.z);
+		q.pos[3] = 0;
+
+		glm::vec2 n = oct_encode(v.normal);
+		q.normal[0] = (int16_t)glm::packSnorm1x16(n.x);
+		q.normal[1] = (int16_t)glm::packSnorm1x16(n.y);
+
+		q.uv[0] = glm::packHalf1x16(v.uv.x);
+		q.uv[1] = glm::packHalf1x16(v.uv.y);
+	}
+
+	/* Dequantize: pos = min + q * extent */
+	glm::mat4 dequant = glm::translate(glm::mat4(1.0f), min);
+	return glm::scale(dequant, extent);
+}
+
+}   /* namespace jetz */
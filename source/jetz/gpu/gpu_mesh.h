@@ -0,0 +1,143 @@
+/*=============================================================================
+gpu_mesh.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "thirdparty/tinygltf/tiny_gltf.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class gpu_gltf;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+Interleaved vertex used for all model geometry. Attributes missing from the
+source primitive are left zeroed.
+*/
+struct gpu_mesh_vertex
+{
+	glm::vec3		pos;
+	glm::vec3		normal;
+	glm::vec2		uv;
+};
+
+/**
+Quantized vertex - 16 bytes instead of 32.
+
+pos		16-bit unorm position within the mesh bounds (w unused)
+normal	16-bit snorm octahedral encoded normal
+uv		half-float texture coordinates
+*/
+struct gpu_mesh_quantized_vertex
+{
+	uint16_t		pos[4];
+	int16_t			normal[2];
+	uint16_t		uv[2];
+};
+
+/**
+A range of the mesh index list that makes up one level of detail.
+*/
+struct gpu_mesh_lod
+{
+	uint32_t		first_index;
+	uint32_t		index_count;
+
+	/** Geometric error relative to LOD 0, in mesh units. */
+	float			error;
+};
+
+/**
+CPU-side copy of a single mesh primitive, repacked from the source glTF
+accessors into one interleaved vertex stream and a tight index list.
+*/
+class gpu_mesh {
+
+public:
+
+	gpu_mesh();
+	~gpu_mesh();
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Builds a mesh from a glTF primitive. Only the bytes referenced by the
+	primitive's accessors are read.
+
+	@param gltf The glTF model that owns the primitive.
+	@param prim The primitive to repack.
+	@param mesh Output - the repacked mesh.
+	@returns True if the mesh was built, false if the primitive is unusable.
+	*/
+	static bool load_gltf_primitive
+		(
+		const gpu_gltf&				gltf,
+		const tinygltf::Primitive&	prim,
+		gpu_mesh&					mesh
+		);
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Gets the size of an index in bytes (2 or 4).
+	*/
+	uint32_t get_index_size() const;
+
+	/**
+	Gets the axis aligned bounds of the vertex positions.
+	*/
+	void get_bounds(glm::vec3& min, glm::vec3& max) const;
+
+	/**
+	Gets the average texture coordinate density of the full detail mesh, in
+	UV units per mesh unit. Used to pick texture mips from screen size.
+	*/
+	float get_uv_density() const;
+
+	/**
+	Quantizes the vertices. Positions are normalized to the mesh bounds, so the
+	returned dequantization matrix must be applied before the model matrix.
+
+	@param out Output - the quantized vertices.
+	@returns The matrix that maps quantized positions back to mesh space.
+	*/
+	glm::mat4 quantize(std::vector<gpu_mesh_quantized_vertex>& out) const;
+
+	/*-----------------------------------------------------
+	Public variables
+	-----------------------------------------------------*/
+
+	std::vector<gpu_mesh_vertex>	vertices;
+	std::vector<uint32_t>			indices;
+
+	/**
+	Levels of detail, finest first. Empty if no LODs were generated, in which
+	case the whole index list is LOD 0.
+	*/
+	std::vector<gpu_mesh_lod>		lods;
+
+	/** Store indices as 16-bit when uploading? Set from the source index type. */
+	bool							use_16bit_indices;
+};
+
+}   /* namespace jetz */
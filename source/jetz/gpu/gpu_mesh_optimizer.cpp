@@ -0,0 +1,523 @@
+/*=============================================================================
+gpu_mesh_optimizer.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "jetz/gpu/gpu_mesh_optimizer.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Forsyth scoring parameters - see "Linear-Speed Vertex Cache Optimisation" */
+static const float forsyth_cache_decay_power = 1.5f;
+static const float forsyth_last_tri_score = 0.75f;
+static const float forsyth_valence_boost_scale = 2.0f;
+static const float forsyth_valence_boost_power = 0.5f;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Scores a vertex based on its position in the LRU cache and the number of
+triangles still using it.
+
+@param cache_pos The position in the cache, or -1 if not in the cache.
+@param remaining The number of triangles not yet emitted that use the vertex.
+*/
+static float forsyth_vertex_score(int cache_pos, uint32_t remaining)
+{
+	if (remaining == 0)
+	{
+		/* No triangles left - vertex doesn't matter */
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cache_pos >= 0)
+	{
+		if (cache_pos < 3)
+		{
+			/* Used by the last triangle - fixed score so it isn't favored too heavily */
+			score = forsyth_last_tri_score;
+		}
+		else
+		{
+			const float scaler = 1.0f / (gpu_mesh_optimizer::optimize_cache_size - 3);
+			score = 1.0f - (cache_pos - 3) * scaler;
+			score = powf(score, forsyth_cache_decay_power);
+		}
+	}
+
+	/* Boost vertices with few triangles left so they get finished off */
+	score += forsyth_valence_boost_scale * powf((float)remaining, -forsyth_valence_boost_power);
+
+	return score;
+}
+
+/**
+Simulates a FIFO cache access using timestamps. Returns true on a miss.
+*/
+static bool fifo_cache_miss
+	(
+	uint32_t				v,
+	std::vector<uint32_t>&	timestamps,
+	uint32_t&				time,
+	uint32_t				cache_size
+	)
+{
+	if (time - timestamps[v] > cache_size)
+	{
+		timestamps[v] = time++;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+Simulates a triangle going through a FIFO cache. Returns the number of misses.
+*/
+static uint32_t fifo_cache_tri
+	(
+	const uint32_t*			tri,
+	std::vector<uint32_t>&	timestamps,
+	uint32_t&				time,
+	uint32_t				cache_size
+	)
+{
+	uint32_t misses = 0;
+	misses += fifo_cache_miss(tri[0], timestamps, time, cache_size) ? 1 : 0;
+	misses += fifo_cache_miss(tri[1], timestamps, time, cache_size) ? 1 : 0;
+	misses += fifo_cache_miss(tri[2], timestamps, time, cache_size) ? 1 : 0;
+
+	return misses;
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+gpu_mesh_cache_stats gpu_mesh_optimizer::analyze_vertex_cache
+	(
+	const std::vector<uint32_t>&	indices,
+	size_t							vertex_count,
+	uint32_t						cache_size
+	)
+{
+	gpu_mesh_cache_stats stats = {};
+	size_t tri_count = indices.size() / 3;
+
+	if (tri_count == 0 || vertex_count == 0)
+	{
+		return stats;
+	}
+
+	/* Start time past the cache size so every vertex begins as a miss */
+	std::vector<uint32_t> timestamps(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < tri_count; ++i)
+	{
+		misses += fifo_cache_tri(&indices[i * 3], timestamps, time, cache_size);
+	}
+
+	stats.acmr = (float)misses / tri_count;
+	stats.atvr = (float)misses / vertex_count;
+
+	return stats;
+}
+
+void gpu_mesh_optimizer::optimize(gpu_mesh& mesh)
+{
+	if (mesh.indices.size() < 3)
+	{
+		return;
+	}
+
+	/* A partial triangle means the index list is malformed - leave it as is */
+	if (mesh.indices.size() % 3 != 0)
+	{
+		LOG_WARN_FMT("Mesh not optimized: {0} indices is not a whole number of triangles.", mesh.indices.size());
+		return;
+	}
+
+	auto before = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), analyze_cache_size);
+
+	optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+	optimize_overdraw(mesh.indices, mesh.vertices, overdraw_threshold);
+	optimize_vertex_fetch(mesh);
+
+	auto after = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), analyze_cache_size);
+
+	LOG_INFO_FMT("Mesh optimized: {0} triangles, ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}.",
+		mesh.indices.size() / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+void gpu_mesh_optimizer::optimize_vertex_cache
+	(
+	std::vector<uint32_t>&			indices,
+	size_t							vertex_count
+	)
+{
+	size_t tri_count = indices.size() / 3;
+	if (tri_count == 0 || vertex_count == 0)
+	{
+		return;
+	}
+
+	/*
+	Build vertex -> triangle adjacency. Each vertex owns a range in adj; the
+	first remaining[v] entries of the range are triangles not yet emitted.
+	*/
+	std::vector<uint32_t> remaining(vertex_count, 0);
+	for (size_t i = 0; i < tri_count * 3; ++i)
+	{
+		remaining[indices[i]]++;
+	}
+
+	std::vector<uint32_t> adj_offset(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		adj_offset[v + 1] = adj_offset[v] + remaining[v];
+	}
+
+	std::vector<uint32_t> adj(tri_count * 3);
+	{
+		std::vector<uint32_t> fill(adj_offset.begin(), adj_offset.end() - 1);
+		for (size_t i = 0; i < tri_count * 3; ++i)
+		{
+			adj[fill[indices[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	/* Initial scores */
+	std::vector<int> cache_pos(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		vertex_score[v] = forsyth_vertex_score(-1, remaining[v]);
+	}
+
+	std::vector<float> tri_score(tri_count);
+	std::vector<bool> emitted(tri_count, false);
+	int best_tri = -1;
+	float best_score = -1.0f;
+
+	for (size_t t = 0; t < tri_count; ++t)
+	{
+		const uint32_t* tri = &indices[t * 3];
+		tri_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+
+		if (tri_score[t] > best_score)
+		{
+			best_score = tri_score[t];
+			best_tri = (int)t;
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> new_cache;
+	cache.reserve(optimize_cache_size + 3);
+	new_cache.reserve(optimize_cache_size + 3);
+
+	size_t cursor = 0;
+
+	while (output.size() < tri_count * 3)
+	{
+		if (best_tri < 0)
+		{
+			/* Nothing in the cache is usable - continue from the next unemitted triangle */
+			while (emitted[cursor])
+			{
+				cursor++;
+			}
+
+			best_tri = (int)cursor;
+		}
+
+		/* Emit the triangle */
+		const uint32_t* tri = &indices[best_tri * 3];
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+		emitted[best_tri] = true;
+
+		/* Remove triangle from the adjacency of its vertices */
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = tri[k];
+			uint32_t* list = &adj[adj_offset[v]];
+
+			for (uint32_t j = 0; j < remaining[v]; ++j)
+			{
+				if (list[j] == (uint32_t)best_tri)
+				{
+					list[j] = list[remaining[v] - 1];
+					remaining[v]--;
+					break;
+				}
+			}
+		}
+
+		/* Move the triangle's vertices to the front of the LRU cache */
+		new_cache.clear();
+		for (int k = 0; k < 3; ++k)
+		{
+			if (std::find(new_cache.begin(), new_cache.end(), tri[k]) == new_cache.end())
+			{
+				new_cache.push_back(tri[k]);
+			}
+		}
+
+		for (uint32_t v : cache)
+		{
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+			{
+				new_cache.push_back(v);
+			}
+		}
+
+		/* Update scores of all vertices touched, including those evicted */
+		for (size_t i = 0; i < new_cache.size(); ++i)
+		{
+			uint32_t v = new_cache[i];
+			cache_pos[v] = i < optimize_cache_size ? (int)i : -1;
+			vertex_score[v] = forsyth_vertex_score(cache_pos[v], remaining[v]);
+		}
+
+		/* Rescore adjacent triangles and pick the next best */
+		best_tri = -1;
+		best_score = -1.0f;
+
+		for (uint32_t v : new_cache)
+		{
+			const uint32_t* list = &adj[adj_offset[v]];
+
+			for (uint32_t j = 0; j < remaining[v]; ++j)
+			{
+				uint32_t t = list[j];
+				const uint32_t* adj_tri = &indices[t * 3];
+				tri_score[t] = vertex_score[adj_tri[0]] + vertex_score[adj_tri[1]] + vertex_score[adj_tri[2]];
+
+				if (tri_score[t] > best_score)
+				{
+					best_score = tri_score[t];
+					best_tri = (int)t;
+				}
+			}
+		}
+
+		if (new_cache.size() > optimize_cache_size)
+		{
+			new_cache.resize(optimize_cache_size);
+		}
+
+		cache.swap(new_cache);
+	}
+
+	/* Keep any trailing indices that don't form a triangle */
+	output.insert(output.end(), indices.begin() + tri_count * 3, indices.end());
+
+	indices.swap(output);
+}
+
+void gpu_mesh_optimizer::optimize_overdraw
+	(
+	std::vector<uint32_t>&					indices,
+	const std::vector<gpu_mesh_vertex>&		vertices,
+	float									threshold
+	)
+{
+	size_t tri_count = indices.size() / 3;
+	if (tri_count < 2 || vertices.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> timestamps(vertices.size(), 0);
+	uint32_t time = analyze_cache_size + 1;
+
+	/*
+	Hard boundaries - triangles where the cache optimized order starts over
+	(all three vertices miss).
+	*/
+	std::vector<size_t> hard;
+	for (size_t i = 0; i < tri_count; ++i)
+	{
+		if (fifo_cache_tri(&indices[i * 3], timestamps, time, analyze_cache_size) == 3)
+		{
+			hard.push_back(i);
+		}
+	}
+
+	hard.push_back(tri_count);
+
+	/*
+	Soft boundaries - split hard clusters further wherever the running ACMR
+	is within threshold of the whole cluster's ACMR.
+	*/
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1 < hard.size(); ++c)
+	{
+		size_t start = hard[c];
+		size_t end = hard[c + 1];
+
+		time += analyze_cache_size + 1;
+		uint32_t cluster_misses = 0;
+		for (size_t i = start; i < end; ++i)
+		{
+			cluster_misses += fifo_cache_tri(&indices[i * 3], timestamps, time, analyze_cache_size);
+		}
+
+		float cluster_threshold = threshold * cluster_misses / (end - start);
+
+		clusters.push_back(start);
+
+		time += analyze_cache_size + 1;
+		uint32_t running_misses = 0;
+		uint32_t running_tris = 0;
+		for (size_t i = start; i < end; ++i)
+		{
+			running_misses += fifo_cache_tri(&indices[i * 3], timestamps, time, analyze_cache_size);
+			running_tris++;
+
+			if (i + 1 < end && (float)running_misses / running_tris <= cluster_threshold)
+			{
+				/* Start a new cluster with a cold cache */
+				clusters.push_back(i + 1);
+				time += analyze_cache_size + 1;
+				running_misses = 0;
+				running_tris = 0;
+			}
+		}
+	}
+
+	clusters.push_back(tri_count);
+
+	/* Mesh centroid */
+	glm::vec3 mesh_center(0.0f);
+	for (const auto& v : vertices)
+	{
+		mesh_center += v.pos;
+	}
+
+	mesh_center /= (float)vertices.size();
+
+	/*
+	Sort key - clusters facing away from the mesh center are likely to be
+	visible and occlude the rest, so draw them first.
+	*/
+	size_t cluster_count = clusters.size() - 1;
+	std::vector<float> sort_key(cluster_count);
+	std::vector<size_t> order(cluster_count);
+
+	for (size_t c = 0; c < cluster_count; ++c)
+	{
+		glm::vec3 center(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+
+		for (size_t i = clusters[c]; i < clusters[c + 1]; ++i)
+		{
+			const glm::vec3& p0 = vertices[indices[i * 3 + 0]].pos;
+			const glm::vec3& p1 = vertices[indices[i * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[i * 3 + 2]].pos;
+
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float a = glm::length(n);
+
+			center += (p0 + p1 + p2) * (a / 3.0f);
+			normal += n;
+			area += a;
+		}
+
+		if (area > 0.0f)
+		{
+			center /= area;
+		}
+
+		float len = glm::length(normal);
+		if (len > 0.0f)
+		{
+			normal /= len;
+		}
+
+		sort_key[c] = glm::dot(center - mesh_center, normal);
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&sort_key](size_t a, size_t b)
+	{
+		return sort_key[a] > sort_key[b];
+	});
+
+	/* Rebuild the index list in cluster order */
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	for (size_t c : order)
+	{
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+
+	/* Keep any trailing indices that don't form a triangle */
+	output.insert(output.end(), indices.begin() + tri_count * 3, indices.end());
+
+	indices.swap(output);
+}
+
+void gpu_mesh_optimizer::optimize_vertex_fetch(gpu_mesh& mesh)
+{
+	const uint32_t unused = UINT32_MAX;
+
+	std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+	uint32_t next = 0;
+
+	for (auto& idx : mesh.indices)
+	{
+		if (remap[idx] == unused)
+		{
+			remap[idx] = next++;
+		}
+
+		idx = remap[idx];
+	}
+
+	std::vector<gpu_mesh_vertex> vertices(next);
+	for (size_t i = 0; i < remap.size(); ++i)
+	{
+		if (remap[i] != unused)
+		{
+			vertices[remap[i]] = mesh.vertices[i];
+		}
+	}
+
+	mesh.vertices.swap(vertices);
+
+	/* Dropping unused vertices may allow smaller indices */
+	if (mesh.vertices.size() <= UINT16_MAX + 1)
+	{
+		mesh.use_16bit_indices = true;
+	}
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,115 @@
+/*=============================================================================
+gpu_mesh_optimizer.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <vector>
+
+#include "jetz/gpu/gpu_mesh.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+Post-transform vertex cache statistics for an index list.
+*/
+struct gpu_mesh_cache_stats
+{
+	/** Average cache miss ratio - vertex shader invocations per triangle. */
+	float			acmr;
+
+	/** Average transformed vertex ratio - invocations per unique vertex. */
+	float			atvr;
+};
+
+/**
+Reorders mesh geometry on import to reduce GPU vertex and pixel work:
+vertex cache ordering (Forsyth), overdraw-aware cluster ordering, and
+vertex fetch remapping.
+*/
+class gpu_mesh_optimizer {
+
+public:
+
+	/** Size of the FIFO cache used when analyzing an index list. */
+	static const uint32_t analyze_cache_size = 16;
+
+	/** Size of the LRU cache modeled when optimizing for the vertex cache. */
+	static const uint32_t optimize_cache_size = 32;
+
+	/** Allowed ACMR degradation when splitting clusters for overdraw ordering. */
+	static constexpr float overdraw_threshold = 1.05f;
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Simulates a FIFO post-transform cache over an index list.
+
+	@param indices The triangle list indices.
+	@param vertex_count The number of vertices referenced by the indices.
+	@param cache_size The number of entries in the simulated cache.
+	*/
+	static gpu_mesh_cache_stats analyze_vertex_cache
+		(
+		const std::vector<uint32_t>&	indices,
+		size_t							vertex_count,
+		uint32_t						cache_size
+		);
+
+	/**
+	Runs all optimization stages on a mesh and logs cache statistics before
+	and after. Meshes whose index count isn't a multiple of 3 are left
+	unchanged.
+	*/
+	static void optimize(gpu_mesh& mesh);
+
+	/**
+	Reorders triangles to improve post-transform vertex cache hits using
+	Tom Forsyth's linear-speed vertex cache optimization. Trailing indices
+	that don't form a triangle are kept at the end.
+	*/
+	static void optimize_vertex_cache
+		(
+		std::vector<uint32_t>&			indices,
+		size_t							vertex_count
+		);
+
+	/**
+	Reorders clusters of triangles so outward facing clusters are drawn
+	first, reducing overdraw. The input should already be optimized for the
+	vertex cache; clusters are split where doing so keeps the ACMR within
+	threshold of the cache optimized order. Trailing indices that don't form
+	a triangle are kept at the end.
+
+	@param threshold Allowed ACMR degradation (e.g. 1.05 allows 5% worse).
+	*/
+	static void optimize_overdraw
+		(
+		std::vector<uint32_t>&					indices,
+		const std::vector<gpu_mesh_vertex>&		vertices,
+		float									threshold
+		);
+
+	/**
+	Reorders vertices in order of first use by the index list and drops
+	unreferenced vertices. Indices are remapped to match.
+	*/
+	static void optimize_vertex_fetch(gpu_mesh& mesh);
+};
+
+}   /* namespace jetz */
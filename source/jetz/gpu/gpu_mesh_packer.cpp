@@ -0,0 +1,136 @@
+/*=============================================================================
+gpu_mesh_packer.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstring>
+
+#include "jetz/gpu/gpu_gltf.h"
+#include "jetz/gpu/gpu_mesh_optimizer.h"
+#include "jetz/gpu/gpu_mesh_packer.h"
+#include "jetz/gpu/gpu_mesh_simplifier.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+gpu_mesh_packer::gpu_mesh_packer(uint32_t max_lods, bool quantize)
+	:
+	_max_lods(max_lods),
+	_quantize(quantize)
+{
+}
+
+gpu_mesh_packer::~gpu_mesh_packer()
+{
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+bool gpu_mesh_packer::add
+	(
+	const gpu_gltf&				gltf,
+	const tinygltf::Primitive&	prim,
+	gpu_packed_primitive&		out
+	)
+{
+	/* Repack the primitive into an interleaved vertex stream and tight index list */
+	gpu_mesh mesh;
+	if (!gpu_mesh::load_gltf_primitive(gltf, prim, mesh))
+	{
+		return false;
+	}
+
+	/* Reorder for the vertex cache, overdraw, and vertex fetch */
+	gpu_mesh_optimizer::optimize(mesh);
+
+	/* Build the LOD chain - all LODs share the primitive's vertices */
+	gpu_mesh_simplifier::generate_lods(mesh, _max_lods);
+
+	/* Split large LOD 0 index lists into meshlets that can be culled individually */
+	gpu_index_range lod0 = { 0, mesh.lods.empty() ? (uint32_t)mesh.indices.size() : mesh.lods[0].index_count };
+	out.meshlets = gpu_meshlets();
+	if (lod0.index_count / 3 >= gpu_meshlets::min_triangles)
+	{
+		gpu_meshlets::build(mesh, lod0, out.meshlets);
+	}
+
+	/* Bounding sphere and UV density for LOD and texture mip selection */
+	out.uv_density = mesh.get_uv_density();
+
+	glm::vec3 min, max;
+	mesh.get_bounds(min, max);
+	out.center = (min + max) * 0.5f;
+	out.radius = glm::length(max - min) * 0.5f;
+
+	out.use_16bit_indices = mesh.use_16bit_indices;
+	out.vertex_offset = static_cast<int32_t>(vertex_data.size() / get_vertex_stride());
+
+	/* Append vertices */
+	if (_quantize)
+	{
+		std::vector<gpu_mesh_quantized_vertex> quantized;
+		out.dequant = mesh.quantize(quantized);
+
+		const uint8_t* src = (const uint8_t*)quantized.data();
+		vertex_data.insert(vertex_data.end(), src, src + quantized.size() * sizeof(gpu_mesh_quantized_vertex));
+	}
+	else
+	{
+		out.dequant = glm::mat4(1.0f);
+
+		const uint8_t* src = (const uint8_t*)mesh.vertices.data();
+		vertex_data.insert(vertex_data.end(), src, src + mesh.vertices.size() * sizeof(gpu_mesh_vertex));
+	}
+
+	/* Append indices - keep each primitive's start aligned for the largest index type */
+	size_t offset = (index_data.size() + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+	index_data.resize(offset + mesh.indices.size() * mesh.get_index_size());
+
+	/* The offset is 4 byte aligned, so it is a whole number of indices */
+	uint32_t first_index = static_cast<uint32_t>(offset / mesh.get_index_size());
+
+	out.lods.clear();
+	if (mesh.lods.empty())
+	{
+		out.lods.push_back({ first_index, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+	}
+
+	for (const auto& lod : mesh.lods)
+	{
+		out.lods.push_back({ first_index + lod.first_index, lod.index_count, lod.error });
+	}
+
+	if (mesh.use_16bit_indices)
+	{
+		uint16_t* dst = (uint16_t*)(index_data.data() + offset);
+		for (size_t i = 0; i < mesh.indices.size(); ++i)
+		{
+			dst[i] = static_cast<uint16_t>(mesh.indices[i]);
+		}
+	}
+	else
+	{
+		memcpy(index_data.data() + offset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+	}
+
+	return true;
+}
+
+uint32_t gpu_mesh_packer::get_vertex_stride() const
+{
+	return _quantize ? sizeof(gpu_mesh_quantized_vertex) : sizeof(gpu_mesh_vertex);
+}
+
+}   /* namespace jetz */
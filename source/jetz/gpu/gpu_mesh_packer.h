@@ -0,0 +1,111 @@
+/*=============================================================================
+gpu_mesh_packer.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "jetz/gpu/gpu_mesh.h"
+#include "jetz/gpu/gpu_meshlets.h"
+#include "thirdparty/tinygltf/tiny_gltf.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class gpu_gltf;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+A primitive added to a gpu_mesh_packer - where its data landed in the packed
+vertex and index data and what's needed to draw it.
+*/
+struct gpu_packed_primitive
+{
+	/** Finest first; always at least one. First indices are into the packed index data. */
+	std::vector<gpu_mesh_lod>	lods;
+
+	int32_t						vertex_offset;		/* first vertex of the primitive in the packed vertex data */
+	bool						use_16bit_indices;
+	glm::mat4					dequant;			/* maps quantized positions to mesh space (identity if not quantized) */
+	glm::vec3					center;				/* bounding sphere in mesh space */
+	float						radius;
+	float						uv_density;			/* UV units per mesh unit */
+	gpu_meshlets				meshlets;			/* LOD 0 clusters for culling; empty for small primitives */
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Imports glTF primitives into one vertex stream and one index list: repacks,
+optimizes, builds LODs and meshlets, and quantizes each primitive, then
+appends it. Used by models on load and by tools that measure the import.
+*/
+class gpu_mesh_packer {
+
+public:
+
+	/**
+	@param max_lods The max number of LODs per primitive, including LOD 0.
+	@param quantize Store quantized vertices?
+	*/
+	gpu_mesh_packer(uint32_t max_lods, bool quantize);
+	~gpu_mesh_packer();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Imports a primitive and appends its vertices and indices.
+
+	@param gltf The glTF model that owns the primitive.
+	@param prim The primitive to add.
+	@param out Output - the packed primitive.
+	@returns True if the primitive was added, false if it is unusable.
+	*/
+	bool add
+		(
+		const gpu_gltf&				gltf,
+		const tinygltf::Primitive&	prim,
+		gpu_packed_primitive&		out
+		);
+
+	/** Gets the size of a vertex in the packed vertex data. */
+	uint32_t get_vertex_stride() const;
+
+	/*-----------------------------------------------------
+	Public variables
+	-----------------------------------------------------*/
+
+	/** Vertices of all primitives added. */
+	std::vector<uint8_t>		vertex_data;
+
+	/** Indices of all primitives added. Each primitive starts 4 byte aligned. */
+	std::vector<uint8_t>		index_data;
+
+private:
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	uint32_t					_max_lods;
+	bool						_quantize;
+};
+
+}   /* namespace jetz */
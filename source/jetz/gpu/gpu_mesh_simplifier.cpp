@@ -0,0 +1,542 @@
+/*=============================================================================
+gpu_mesh_simplifier.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "jetz/gpu/gpu_mesh_optimizer.h"
+#include "jetz/gpu/gpu_mesh_simplifier.h"
+#include "jetz/main/log.h"
+#include "jetz/main/utl.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+Symmetric 4x4 error quadric plus the total weight (area) accumulated into it.
+*/
+struct simplifier_quadric
+{
+	double a00, a01, a02, a03;
+	double a11, a12, a13;
+	double a22, a23;
+	double a33;
+	double w;
+};
+
+/**
+A candidate collapse of position p0 onto position p1.
+*/
+struct simplifier_collapse
+{
+	uint32_t		p0;
+	uint32_t		p1;
+	float			error;
+};
+
+/**
+Hashes vertex positions so wedges (vertices split by attribute seams) can be
+welded back together.
+*/
+struct simplifier_pos_hash
+{
+	size_t operator()(const glm::vec3& p) const
+	{
+		size_t seed = 0;
+		utl::hash_combine(seed, p.x);
+		utl::hash_combine(seed, p.y);
+		utl::hash_combine(seed, p.z);
+		return seed;
+	}
+};
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+static const uint32_t invalid_vertex = UINT32_MAX;
+
+/* Border constraint planes are weighted more heavily so open edges stay put */
+static const double border_weight = 10.0;
+
+/* Max simplification passes - each pass collapses an independent set of edges */
+static const int max_passes = 100;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+static void quadric_add(simplifier_quadric& q, const simplifier_quadric& r)
+{
+	q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03;
+	q.a11 += r.a11; q.a12 += r.a12; q.a13 += r.a13;
+	q.a22 += r.a22; q.a23 += r.a23;
+	q.a33 += r.a33;
+	q.w += r.w;
+}
+
+/**
+Makes a quadric for the plane ax + by + cz + d = 0 with the given weight.
+*/
+static simplifier_quadric quadric_from_plane(double a, double b, double c, double d, double w)
+{
+	simplifier_quadric q;
+	q.a00 = w * a * a; q.a01 = w * a * b; q.a02 = w * a * c; q.a03 = w * a * d;
+	q.a11 = w * b * b; q.a12 = w * b * c; q.a13 = w * b * d;
+	q.a22 = w * c * c; q.a23 = w * c * d;
+	q.a33 = w * d * d;
+	q.w = w;
+	return q;
+}
+
+/**
+Evaluates a quadric at a point. Returns the RMS distance to the planes
+accumulated into the quadric.
+*/
+static float quadric_error(const simplifier_quadric& q, const glm::vec3& v)
+{
+	if (q.w <= 0.0)
+	{
+		return 0.0f;
+	}
+
+	double x = v.x, y = v.y, z = v.z;
+	double r = q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z + 2.0 * q.a03 * x
+		+ q.a11 * y * y + 2.0 * q.a12 * y * z + 2.0 * q.a13 * y
+		+ q.a22 * z * z + 2.0 * q.a23 * z
+		+ q.a33;
+
+	return (float)sqrt(fabs(r) / q.w);
+}
+
+static uint64_t edge_key(uint32_t a, uint32_t b)
+{
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+/**
+Picks the wedge of position p1 whose attributes best match wedge v.
+*/
+static uint32_t pick_wedge
+	(
+	const std::vector<gpu_mesh_vertex>&			vertices,
+	const std::vector<std::vector<uint32_t>>&	wedges,
+	uint32_t									v,
+	uint32_t									p1
+	)
+{
+	const auto& list = wedges[p1];
+	uint32_t best = list[0];
+	float best_dist = FLT_MAX;
+
+	for (uint32_t w : list)
+	{
+		glm::vec2 duv = vertices[w].uv - vertices[v].uv;
+		glm::vec3 dn = vertices[w].normal - vertices[v].normal;
+		float dist = glm::dot(duv, duv) + glm::dot(dn, dn);
+
+		if (dist < best_dist)
+		{
+			best_dist = dist;
+			best = w;
+		}
+	}
+
+	return best;
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+void gpu_mesh_simplifier::generate_lods(gpu_mesh& mesh, uint32_t max_lods)
+{
+	mesh.lods.clear();
+
+	size_t tri_count = mesh.indices.size() / 3;
+	if (max_lods <= 1 || tri_count < lod_min_triangles)
+	{
+		return;
+	}
+
+	glm::vec3 min, max;
+	mesh.get_bounds(min, max);
+	float radius = glm::length(max - min) * 0.5f;
+
+	/* LOD 0 is the original list; each LOD is simplified from it so error is relative to full detail */
+	const std::vector<uint32_t> base(mesh.indices.begin(), mesh.indices.begin() + tri_count * 3);
+
+	gpu_mesh_lod lod0 = {};
+	lod0.first_index = 0;
+	lod0.index_count = (uint32_t)base.size();
+	lod0.error = 0.0f;
+	mesh.lods.push_back(lod0);
+
+	size_t prev_count = base.size();
+	float prev_error = 0.0f;
+	float target_ratio = 1.0f;
+
+	for (uint32_t i = 1; i < max_lods; ++i)
+	{
+		target_ratio *= lod_ratio;
+		size_t target = (size_t)(tri_count * target_ratio) * 3;
+		if (target < 3)
+		{
+			break;
+		}
+
+		std::vector<uint32_t> lod_indices;
+		float error = simplify(mesh.vertices, base, target, radius * lod_max_error, lod_indices);
+
+		/* Stop once a LOD isn't meaningfully smaller than the last */
+		if (lod_indices.empty() || lod_indices.size() > prev_count * 9 / 10)
+		{
+			break;
+		}
+
+		gpu_mesh_optimizer::optimize_vertex_cache(lod_indices, mesh.vertices.size());
+
+		gpu_mesh_lod lod = {};
+		lod.first_index = (uint32_t)mesh.indices.size();
+		lod.index_count = (uint32_t)lod_indices.size();
+		lod.error = std::max(error, prev_error);
+		mesh.lods.push_back(lod);
+
+		mesh.indices.insert(mesh.indices.end(), lod_indices.begin(), lod_indices.end());
+
+		prev_count = lod_indices.size();
+		prev_error = lod.error;
+	}
+
+	if (mesh.lods.size() == 1)
+	{
+		/* Nothing generated */
+		mesh.lods.clear();
+		return;
+	}
+
+	LOG_INFO_FMT("Generated {0} LODs: {1} -> {2} triangles, max error {3:.4f}.",
+		mesh.lods.size() - 1, tri_count, mesh.lods.back().index_count / 3, mesh.lods.back().error);
+}
+
+float gpu_mesh_simplifier::simplify
+	(
+	const std::vector<gpu_mesh_vertex>&		vertices,
+	const std::vector<uint32_t>&			indices,
+	size_t									target_index_count,
+	float									target_error,
+	std::vector<uint32_t>&					out
+	)
+{
+	out.clear();
+
+	size_t vertex_count = vertices.size();
+	if (vertex_count == 0 || indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	/*
+	Weld wedges that share a position. Collapses are done on positions so
+	attribute seams can't crack open; wedges are then matched by attributes.
+	*/
+	std::vector<uint32_t> rep(vertex_count);
+	std::vector<std::vector<uint32_t>> wedges(vertex_count);
+	{
+		std::unordered_map<glm::vec3, uint32_t, simplifier_pos_hash> pos_map;
+		pos_map.reserve(vertex_count);
+
+		for (uint32_t v = 0; v < vertex_count; ++v)
+		{
+			auto it = pos_map.emplace(vertices[v].pos, v).first;
+			rep[v] = it->second;
+			wedges[rep[v]].push_back(v);
+		}
+	}
+
+	/* Working triangle list, minus triangles that are already degenerate */
+	std::vector<uint32_t> tris;
+	tris.reserve(indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t a = rep[indices[i + 0]];
+		uint32_t b = rep[indices[i + 1]];
+		uint32_t c = rep[indices[i + 2]];
+
+		if (a != b && b != c && a != c)
+		{
+			tris.insert(tris.end(), { indices[i + 0], indices[i + 1], indices[i + 2] });
+		}
+	}
+
+	/*
+	Find border edges - edges used by a single triangle
+	*/
+	std::unordered_map<uint64_t, uint32_t> edge_use;
+	for (size_t i = 0; i < tris.size(); i += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			edge_use[edge_key(rep[tris[i + e]], rep[tris[i + (e + 1) % 3]])]++;
+		}
+	}
+
+	/*
+	Build quadrics - triangle planes weighted by area, plus constraint planes
+	perpendicular to border edges.
+	*/
+	std::vector<simplifier_quadric> quadrics(vertex_count);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(simplifier_quadric));
+	std::vector<bool> border(vertex_count, false);
+
+	for (size_t i = 0; i < tris.size(); i += 3)
+	{
+		uint32_t r[3] = { rep[tris[i + 0]], rep[tris[i + 1]], rep[tris[i + 2]] };
+		const glm::vec3& p0 = vertices[r[0]].pos;
+		const glm::vec3& p1 = vertices[r[1]].pos;
+		const glm::vec3& p2 = vertices[r[2]].pos;
+
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float len = glm::length(n);
+		if (len <= 0.0f)
+		{
+			continue;
+		}
+
+		n /= len;
+		double area = len * 0.5;
+		auto q = quadric_from_plane(n.x, n.y, n.z, -glm::dot(n, p0), area);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			quadric_add(quadrics[r[k]], q);
+		}
+
+		for (int e = 0; e < 3; ++e)
+		{
+			uint32_t a = r[e];
+			uint32_t b = r[(e + 1) % 3];
+			if (edge_use[edge_key(a, b)] != 1)
+			{
+				continue;
+			}
+
+			glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+			glm::vec3 bn = glm::cross(edge, n);
+			float bn_len = glm::length(bn);
+			if (bn_len <= 0.0f)
+			{
+				continue;
+			}
+
+			bn /= bn_len;
+			double w = border_weight * glm::dot(edge, edge);
+			auto bq = quadric_from_plane(bn.x, bn.y, bn.z, -glm::dot(bn, vertices[a].pos), w);
+			quadric_add(quadrics[a], bq);
+			quadric_add(quadrics[b], bq);
+
+			border[a] = true;
+			border[b] = true;
+		}
+	}
+
+	/*
+	Collapse passes
+	*/
+	size_t target_tris = target_index_count / 3;
+	float result_error = 0.0f;
+
+	std::vector<uint32_t> collapse_to(vertex_count, invalid_vertex);
+	std::vector<bool> locked(vertex_count, false);
+	std::vector<uint32_t> adj_offset(vertex_count + 1);
+	std::vector<uint32_t> adj;
+	std::vector<simplifier_collapse> candidates;
+
+	for (int pass = 0; pass < max_passes && tris.size() / 3 > target_tris; ++pass)
+	{
+		size_t tri_count = tris.size() / 3;
+
+		/* Position -> triangle adjacency */
+		std::fill(adj_offset.begin(), adj_offset.end(), 0);
+		for (uint32_t v : tris)
+		{
+			adj_offset[rep[v] + 1]++;
+		}
+
+		for (size_t p = 0; p < vertex_count; ++p)
+		{
+			adj_offset[p + 1] += adj_offset[p];
+		}
+
+		adj.resize(tris.size());
+		{
+			std::vector<uint32_t> fill(adj_offset.begin(), adj_offset.end() - 1);
+			for (size_t i = 0; i < tris.size(); ++i)
+			{
+				adj[fill[rep[tris[i]]]++] = (uint32_t)(i / 3);
+			}
+		}
+
+		/* Gather and rank candidate collapses */
+		candidates.clear();
+		for (size_t i = 0; i < tris.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = rep[tris[i + e]];
+				uint32_t b = rep[tris[i + (e + 1) % 3]];
+				bool border_edge = edge_use[edge_key(a, b)] == 1;
+
+				/* Border vertices may only slide along the border */
+				if (!border[a] || border_edge)
+				{
+					candidates.push_back({ a, b, quadric_error(quadrics[a], vertices[b].pos) });
+				}
+
+				if (!border[b] || border_edge)
+				{
+					candidates.push_back({ b, a, quadric_error(quadrics[b], vertices[a].pos) });
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const simplifier_collapse& x, const simplifier_collapse& y)
+		{
+			return x.error < y.error;
+		});
+
+		/* Apply an independent set of collapses, cheapest first */
+		std::fill(locked.begin(), locked.end(), false);
+		size_t needed = tri_count - target_tris;
+		size_t removed = 0;
+		size_t collapses = 0;
+
+		for (const auto& c : candidates)
+		{
+			if (c.error > target_error || removed >= needed)
+			{
+				break;
+			}
+
+			if (locked[c.p0] || locked[c.p1])
+			{
+				continue;
+			}
+
+			/* Reject collapses that would flip a triangle around p0 */
+			bool flips = false;
+			size_t shared = 0;
+
+			for (uint32_t j = adj_offset[c.p0]; j < adj_offset[c.p0 + 1] && !flips; ++j)
+			{
+				const uint32_t* t = &tris[adj[j] * 3];
+				uint32_t r[3] = { rep[t[0]], rep[t[1]], rep[t[2]] };
+
+				if (r[0] == c.p1 || r[1] == c.p1 || r[2] == c.p1)
+				{
+					/* Triangle becomes degenerate */
+					shared++;
+					continue;
+				}
+
+				glm::vec3 p[3] = { vertices[r[0]].pos, vertices[r[1]].pos, vertices[r[2]].pos };
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+				for (int k = 0; k < 3; ++k)
+				{
+					if (r[k] == c.p0)
+					{
+						p[k] = vertices[c.p1].pos;
+					}
+				}
+
+				glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+
+			if (flips || shared == 0)
+			{
+				continue;
+			}
+
+			collapse_to[c.p0] = c.p1;
+			quadric_add(quadrics[c.p1], quadrics[c.p0]);
+			result_error = std::max(result_error, c.error);
+			removed += shared;
+			collapses++;
+
+			/* Lock the ring of p0 so later flip tests in this pass see final positions */
+			for (uint32_t j = adj_offset[c.p0]; j < adj_offset[c.p0 + 1]; ++j)
+			{
+				const uint32_t* t = &tris[adj[j] * 3];
+				locked[rep[t[0]]] = true;
+				locked[rep[t[1]]] = true;
+				locked[rep[t[2]]] = true;
+			}
+		}
+
+		if (collapses == 0)
+		{
+			break;
+		}
+
+		/* Remap collapsed wedges and drop degenerate triangles */
+		size_t write = 0;
+		for (size_t i = 0; i < tris.size(); i += 3)
+		{
+			uint32_t t[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = tris[i + k];
+				uint32_t target = collapse_to[rep[v]];
+				t[k] = target == invalid_vertex ? v : pick_wedge(vertices, wedges, v, target);
+			}
+
+			if (rep[t[0]] == rep[t[1]] || rep[t[1]] == rep[t[2]] || rep[t[0]] == rep[t[2]])
+			{
+				continue;
+			}
+
+			tris[write++] = t[0];
+			tris[write++] = t[1];
+			tris[write++] = t[2];
+		}
+
+		tris.resize(write);
+
+		/* Collapsed positions are gone; edge use must follow */
+		for (size_t p = 0; p < vertex_count; ++p)
+		{
+			collapse_to[p] = invalid_vertex;
+		}
+
+		edge_use.clear();
+		for (size_t i = 0; i < tris.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				edge_use[edge_key(rep[tris[i + e]], rep[tris[i + (e + 1) % 3]])]++;
+			}
+		}
+	}
+
+	out.swap(tris);
+	return result_error;
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,79 @@
+/*=============================================================================
+gpu_mesh_simplifier.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <vector>
+
+#include "jetz/gpu/gpu_mesh.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Quadric error mesh simplification (Garland and Heckbert) used to build LOD
+chains on import. Vertices collapse onto existing vertices so LODs share the
+vertex buffer of the full detail mesh.
+*/
+class gpu_mesh_simplifier {
+
+public:
+
+	/** Each LOD targets this fraction of the previous LOD's triangles. */
+	static constexpr float lod_ratio = 0.5f;
+
+	/** Max LOD error as a fraction of the mesh bounding radius. */
+	static constexpr float lod_max_error = 0.1f;
+
+	/** Meshes with fewer triangles than this don't get LODs. */
+	static const uint32_t lod_min_triangles = 256;
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Builds up to max_lods - 1 simplified LODs for a mesh. LOD index lists are
+	appended to mesh.indices and described in mesh.lods; LOD 0 is the
+	original index list. Stops early once simplification stops paying off.
+
+	@param mesh The mesh. Should already be optimized.
+	@param max_lods The max number of LODs including LOD 0.
+	*/
+	static void generate_lods(gpu_mesh& mesh, uint32_t max_lods);
+
+	/**
+	Simplifies a triangle list.
+
+	@param vertices The mesh vertices.
+	@param indices The triangle list to simplify.
+	@param target_index_count The desired number of indices.
+	@param target_error Max allowed error in mesh units - simplification stops
+		before exceeding this even if the target count isn't reached.
+	@param out Output - the simplified triangle list.
+	@returns The error of the simplified mesh in mesh units.
+	*/
+	static float simplify
+		(
+		const std::vector<gpu_mesh_vertex>&		vertices,
+		const std::vector<uint32_t>&			indices,
+		size_t									target_index_count,
+		float									target_error,
+		std::vector<uint32_t>&					out
+		);
+};
+
+}   /* namespace jetz */
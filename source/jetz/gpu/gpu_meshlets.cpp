@@ -0,0 +1,470 @@
+/*=============================================================================
+gpu_meshlets.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#define JETZ_MESHLETS_SSE
+	#include <emmintrin.h>
+#endif
+
+#include "jetz/gpu/gpu_meshlets.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Cones wider than this (min dot of normal and axis) aren't worth testing */
+static const float cone_min_dot = 0.1f;
+
+/* Number of unused triangles searched when a meshlet runs out of neighbors */
+static const uint32_t seed_search = 64;
+
+/* Min dot of a non-adjacent triangle's normal and the meshlet's average normal */
+static const float seed_min_dot = 0.9f;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Computes the culling bounds for a meshlet.
+*/
+static gpu_meshlet_bounds compute_bounds(const gpu_mesh& mesh, gpu_index_range range)
+{
+	gpu_meshlet_bounds b = {};
+	const uint32_t* indices = &mesh.indices[range.first_index];
+
+	/* Sphere - centered on the box, radius to the farthest vertex */
+	glm::vec3 min = mesh.vertices[indices[0]].pos;
+	glm::vec3 max = min;
+	for (uint32_t i = 0; i < range.index_count; ++i)
+	{
+		min = glm::min(min, mesh.vertices[indices[i]].pos);
+		max = glm::max(max, mesh.vertices[indices[i]].pos);
+	}
+
+	b.center = (min + max) * 0.5f;
+	for (uint32_t i = 0; i < range.index_count; ++i)
+	{
+		b.radius = glm::max(b.radius, glm::length(mesh.vertices[indices[i]].pos - b.center));
+	}
+
+	/* Normal cone from the face normals */
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis(0.0f);
+
+	for (uint32_t i = 0; i < range.index_count; i += 3)
+	{
+		const uint32_t* tri = &indices[i];
+		const glm::vec3& p0 = mesh.vertices[tri[0]].pos;
+		const glm::vec3& p1 = mesh.vertices[tri[1]].pos;
+		const glm::vec3& p2 = mesh.vertices[tri[2]].pos;
+
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float len = glm::length(n);
+		if (len > 0.0f)
+		{
+			normals.push_back(n / len);
+			axis += n / len;
+		}
+	}
+
+	b.cone_axis = glm::vec3(0.0f);
+	b.cone_cutoff = 1.0f;
+
+	float axis_len = glm::length(axis);
+	if (normals.empty() || axis_len <= 0.0f)
+	{
+		return b;
+	}
+
+	axis /= axis_len;
+
+	float min_dot = 1.0f;
+	for (const auto& n : normals)
+	{
+		min_dot = glm::min(min_dot, glm::dot(n, axis));
+	}
+
+	if (min_dot <= cone_min_dot)
+	{
+		/* Normals spread too wide */
+		return b;
+	}
+
+	b.cone_axis = axis;
+	b.cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+
+	return b;
+}
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+gpu_meshlets::gpu_meshlets()
+{
+}
+
+gpu_meshlets::~gpu_meshlets()
+{
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+void gpu_meshlets::build
+	(
+	gpu_mesh&				mesh,
+	gpu_index_range			range,
+	gpu_meshlets&			meshlets
+	)
+{
+	meshlets.ranges.clear();
+	meshlets.bounds.clear();
+
+	size_t vertex_count = mesh.vertices.size();
+	uint32_t tri_count = range.index_count / 3;
+	if (tri_count == 0 || vertex_count == 0)
+	{
+		meshlets.build_soa();
+		return;
+	}
+
+	const uint32_t* src = &mesh.indices[range.first_index];
+
+	/* Face normals */
+	std::vector<glm::vec3> normals(tri_count);
+	for (uint32_t t = 0; t < tri_count; ++t)
+	{
+		const glm::vec3& p0 = mesh.vertices[src[t * 3 + 0]].pos;
+		const glm::vec3& p1 = mesh.vertices[src[t * 3 + 1]].pos;
+		const glm::vec3& p2 = mesh.vertices[src[t * 3 + 2]].pos;
+
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float len = glm::length(n);
+		normals[t] = len > 0.0f ? n / len : glm::vec3(0.0f);
+	}
+
+	/* Vertex -> triangle adjacency */
+	std::vector<uint32_t> adj_offset(vertex_count + 1, 0);
+	for (uint32_t i = 0; i < tri_count * 3; ++i)
+	{
+		adj_offset[src[i] + 1]++;
+	}
+
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		adj_offset[v + 1] += adj_offset[v];
+	}
+
+	std::vector<uint32_t> adj(tri_count * 3);
+	{
+		std::vector<uint32_t> fill(adj_offset.begin(), adj_offset.end() - 1);
+		for (uint32_t i = 0; i < tri_count * 3; ++i)
+		{
+			adj[fill[src[i]]++] = i / 3;
+		}
+	}
+
+	/*
+	Grow meshlets greedily from a seed triangle. Each step adds the adjacent
+	triangle that adds the fewest new vertices and best matches the meshlet's
+	average normal, which keeps meshlets compact and their normal cones tight.
+	*/
+	std::vector<bool> emitted(tri_count, false);
+	std::vector<uint32_t> owner(vertex_count, UINT32_MAX);
+	std::vector<uint32_t> verts;
+	std::vector<uint32_t> output;
+	output.reserve(tri_count * 3);
+	verts.reserve(max_vertices);
+
+	uint32_t cursor = 0;
+	uint32_t id = 0;
+
+	while (output.size() < tri_count * 3)
+	{
+		/* Seed with the next triangle in the original (cache optimized) order */
+		while (emitted[cursor])
+		{
+			cursor++;
+		}
+
+		gpu_index_range current = { range.first_index + (uint32_t)output.size(), 0 };
+		glm::vec3 normal_sum(0.0f);
+		verts.clear();
+
+		uint32_t next = cursor;
+		while (next != UINT32_MAX)
+		{
+			/* Add the triangle */
+			const uint32_t* tri = &src[next * 3];
+			for (int k = 0; k < 3; ++k)
+			{
+				if (owner[tri[k]] != id)
+				{
+					owner[tri[k]] = id;
+					verts.push_back(tri[k]);
+				}
+
+				output.push_back(tri[k]);
+			}
+
+			emitted[next] = true;
+			normal_sum += normals[next];
+			current.index_count += 3;
+
+			if (current.index_count / 3 >= max_triangles)
+			{
+				break;
+			}
+
+			/* Find the best adjacent triangle that still fits */
+			glm::vec3 axis = glm::length(normal_sum) > 0.0f ? glm::normalize(normal_sum) : glm::vec3(0.0f);
+			float best_score = FLT_MAX;
+			next = UINT32_MAX;
+
+			for (uint32_t v : verts)
+			{
+				for (uint32_t j = adj_offset[v]; j < adj_offset[v + 1]; ++j)
+				{
+					uint32_t t = adj[j];
+					if (emitted[t])
+					{
+						continue;
+					}
+
+					const uint32_t* cand = &src[t * 3];
+					uint32_t new_verts = 0;
+					new_verts += owner[cand[0]] != id ? 1 : 0;
+					new_verts += owner[cand[1]] != id && cand[1] != cand[0] ? 1 : 0;
+					new_verts += owner[cand[2]] != id && cand[2] != cand[0] && cand[2] != cand[1] ? 1 : 0;
+
+					if (verts.size() + new_verts > max_vertices)
+					{
+						continue;
+					}
+
+					float score = new_verts + (1.0f - glm::dot(normals[t], axis));
+					if (score < best_score)
+					{
+						best_score = score;
+						next = t;
+					}
+				}
+			}
+
+			/*
+			No adjacent triangle fits (e.g. the meshlet covers a whole UV island).
+			Continue with the nearest of the next few unused triangles facing the
+			same way instead.
+			*/
+			if (next == UINT32_MAX)
+			{
+				glm::vec3 center = mesh.vertices[verts[0]].pos;
+				float best_dist = FLT_MAX;
+				uint32_t checked = 0;
+
+				for (uint32_t t = cursor; t < tri_count && checked < seed_search; ++t)
+				{
+					if (emitted[t])
+					{
+						continue;
+					}
+
+					checked++;
+					const uint32_t* cand = &src[t * 3];
+					uint32_t new_verts = (owner[cand[0]] != id) + (owner[cand[1]] != id) + (owner[cand[2]] != id);
+					if (verts.size() + new_verts > max_vertices
+						|| glm::dot(normals[t], axis) < seed_min_dot)
+					{
+						continue;
+					}
+
+					float dist = glm::length(mesh.vertices[cand[0]].pos - center);
+					if (dist < best_dist)
+					{
+						best_dist = dist;
+						next = t;
+					}
+				}
+			}
+		}
+
+		meshlets.ranges.push_back(current);
+		id++;
+	}
+
+	/* Write back the meshlet ordered triangles */
+	std::copy(output.begin(), output.end(), mesh.indices.begin() + range.first_index);
+
+	for (const auto& r : meshlets.ranges)
+	{
+		meshlets.bounds.push_back(compute_bounds(mesh, r));
+	}
+
+	meshlets.build_soa();
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+void gpu_meshlets::cull
+	(
+	const glm::vec4*				planes,
+	float							radius_scale,
+	const glm::vec3&				camera_pos,
+	bool							cone_cull,
+	std::vector<gpu_index_range>&	out
+	) const
+{
+	out.clear();
+
+	size_t count = ranges.size();
+
+	/*
+	Visibility of each group of four meshlets is a 4-bit mask
+	*/
+	for (size_t i = 0; i < count; i += 4)
+	{
+		int visible = 0;
+
+#ifdef JETZ_MESHLETS_SSE
+		__m128 cx = _mm_loadu_ps(&_center_x[i]);
+		__m128 cy = _mm_loadu_ps(&_center_y[i]);
+		__m128 cz = _mm_loadu_ps(&_center_z[i]);
+		__m128 r = _mm_loadu_ps(&_radius[i]);
+
+		/* Frustum - visible if in front of every plane */
+		__m128 neg_r = _mm_mul_ps(r, _mm_set1_ps(-radius_scale));
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)), _mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+				_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+
+			in = _mm_and_ps(in, _mm_cmpgt_ps(d, neg_r));
+		}
+
+		/* Cone - cull if every triangle faces away from the camera */
+		if (cone_cull)
+		{
+			__m128 dx = _mm_sub_ps(cx, _mm_set1_ps(camera_pos.x));
+			__m128 dy = _mm_sub_ps(cy, _mm_set1_ps(camera_pos.y));
+			__m128 dz = _mm_sub_ps(cz, _mm_set1_ps(camera_pos.z));
+
+			__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			__m128 dot = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&_axis_x[i])), _mm_mul_ps(dy, _mm_loadu_ps(&_axis_y[i]))),
+				_mm_mul_ps(dz, _mm_loadu_ps(&_axis_z[i])));
+
+			__m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&_cutoff[i]), len), r);
+			in = _mm_andnot_ps(_mm_cmpge_ps(dot, limit), in);
+		}
+
+		visible = _mm_movemask_ps(in);
+#else
+		for (size_t j = 0; j < 4; ++j)
+		{
+			glm::vec3 c(_center_x[i + j], _center_y[i + j], _center_z[i + j]);
+			float r = _radius[i + j];
+			bool in = true;
+
+			for (int p = 0; p < 6 && in; ++p)
+			{
+				in = glm::dot(glm::vec3(planes[p]), c) + planes[p].w > -r * radius_scale;
+			}
+
+			if (in && cone_cull)
+			{
+				glm::vec3 d = c - camera_pos;
+				glm::vec3 axis(_axis_x[i + j], _axis_y[i + j], _axis_z[i + j]);
+				in = glm::dot(d, axis) < _cutoff[i + j] * glm::length(d) + r;
+			}
+
+			visible |= in ? (1 << j) : 0;
+		}
+#endif
+
+		/* Emit ranges, merging with the previous range when contiguous */
+		for (size_t j = 0; j < 4 && i + j < count; ++j)
+		{
+			if ((visible & (1 << j)) == 0)
+			{
+				continue;
+			}
+
+			const auto& range = ranges[i + j];
+			if (!out.empty() && out.back().first_index + out.back().index_count == range.first_index)
+			{
+				out.back().index_count += range.index_count;
+			}
+			else
+			{
+				out.push_back(range);
+			}
+		}
+	}
+}
+
+bool gpu_meshlets::empty() const
+{
+	return ranges.empty();
+}
+
+size_t gpu_meshlets::size() const
+{
+	return ranges.size();
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void gpu_meshlets::build_soa()
+{
+	size_t padded = (bounds.size() + 3) & ~(size_t)3;
+
+	/* Padding lanes are never emitted, values don't matter */
+	_center_x.assign(padded, 0.0f);
+	_center_y.assign(padded, 0.0f);
+	_center_z.assign(padded, 0.0f);
+	_radius.assign(padded, 0.0f);
+	_axis_x.assign(padded, 0.0f);
+	_axis_y.assign(padded, 0.0f);
+	_axis_z.assign(padded, 0.0f);
+	_cutoff.assign(padded, 1.0f);
+
+	for (size_t i = 0; i < bounds.size(); ++i)
+	{
+		const auto& b = bounds[i];
+		_center_x[i] = b.center.x;
+		_center_y[i] = b.center.y;
+		_center_z[i] = b.center.z;
+		_radius[i] = b.radius;
+		_axis_x[i] = b.cone_axis.x;
+		_axis_y[i] = b.cone_axis.y;
+		_axis_z[i] = b.cone_axis.z;
+		_cutoff[i] = b.cone_cutoff;
+	}
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,160 @@
+/*=============================================================================
+gpu_meshlets.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "jetz/gpu/gpu_mesh.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+A contiguous range of a mesh index list.
+*/
+struct gpu_index_range
+{
+	uint32_t		first_index;
+	uint32_t		index_count;
+};
+
+/**
+Bounds of a meshlet used for culling.
+*/
+struct gpu_meshlet_bounds
+{
+	/** Bounding sphere. */
+	glm::vec3		center;
+	float			radius;
+
+	/**
+	Normal cone. The meshlet is back facing when
+	dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius.
+	A cutoff of 1 disables cone culling.
+	*/
+	glm::vec3		cone_axis;
+	float			cone_cutoff;
+};
+
+/**
+Splits a triangle list into small clusters (meshlets) of triangles that can
+be culled individually on the CPU. Triangles are reordered so each meshlet is
+a contiguous index range and visible meshlets can be drawn as index ranges.
+*/
+class gpu_meshlets {
+
+public:
+
+	/** Max unique vertices per meshlet. */
+	static const uint32_t max_vertices = 64;
+
+	/** Max triangles per meshlet. */
+	static const uint32_t max_triangles = 124;
+
+	/** Meshes with fewer triangles than this aren't split. */
+	static const uint32_t min_triangles = 512;
+
+	gpu_meshlets();
+	~gpu_meshlets();
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Builds meshlets for a range of a mesh's index list. Triangles within the
+	range are reordered into meshlet order.
+
+	@param mesh The mesh.
+	@param range The range of mesh.indices to split (e.g. LOD 0).
+	@param meshlets Output - the meshlets.
+	*/
+	static void build
+		(
+		gpu_mesh&				mesh,
+		gpu_index_range			range,
+		gpu_meshlets&			meshlets
+		);
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Culls meshlets against a frustum and by normal cone. Adjacent surviving
+	meshlets are merged so each output range is one draw.
+
+	@param planes Frustum planes in mesh space (xyz normal pointing inward, w
+		distance). Plane distances are expected in world units.
+	@param radius_scale Scale from mesh units to world units, applied to radii
+		for the frustum test.
+	@param camera_pos The camera position in mesh space.
+	@param cone_cull Whether to cone cull. Only valid if the mesh to world
+		transform has uniform scale.
+	@param ranges Output - the index ranges to draw.
+	*/
+	void cull
+		(
+		const glm::vec4*				planes,
+		float							radius_scale,
+		const glm::vec3&				camera_pos,
+		bool							cone_cull,
+		std::vector<gpu_index_range>&	ranges
+		) const;
+
+	bool empty() const;
+	size_t size() const;
+
+	/*-----------------------------------------------------
+	Public variables
+	-----------------------------------------------------*/
+
+	/** Index range of each meshlet. */
+	std::vector<gpu_index_range>	ranges;
+
+	/** Bounds of each meshlet. */
+	std::vector<gpu_meshlet_bounds>	bounds;
+
+private:
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Rebuilds the SIMD friendly copy of the bounds. */
+	void build_soa();
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	/*
+	Bounds in structure of arrays form, padded to a multiple of 4, so four
+	meshlets can be tested at a time.
+	*/
+	std::vector<float>				_center_x;
+	std::vector<float>				_center_y;
+	std::vector<float>				_center_z;
+	std::vector<float>				_radius;
+	std::vector<float>				_axis_x;
+	std::vector<float>				_axis_y;
+	std::vector<float>				_axis_z;
+	std::vector<float>				_cutoff;
+};
+
+}   /* namespace jetz */
@@ -33,6 +33,11 @@ gpu_model::~gpu_model()
 {
 }
 
+uint64_t gpu_model::get_memory_size() const
+{
+	return 0;
+}
+
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
@@ -8,6 +8,11 @@ gpu_model.h
 INCLUDES
 =============================================================================*/
 
+#include <cstdint>
+#include <vector>
+
+#include "jetz/gpu/gpu_cache.h"
+
 /*=============================================================================
 NAMESPACE
 =============================================================================*/
@@ -16,6 +21,26 @@ namespace jetz {
 
 class ecs_transform_component;
 class gpu_frame;
+class gpu_model;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/** A handle to a model in the GPU model cache. */
+typedef gpu_handle<gpu_model> model_handle;
+
+/**
+Per-instance render state for a model. Owned by whatever renders the model
+(e.g. a model component) since a model can be drawn many times per frame.
+*/
+class gpu_model_instance {
+
+public:
+
+	/** Current LOD of each primitive of each node, kept for LOD hysteresis. */
+	std::vector<uint8_t>	lods;
+};
 
 /*=============================================================================
 CLASS
@@ -32,7 +57,13 @@ public:
 	Public Methods
 	-----------------------------------------------------*/
 
-	virtual void render(const gpu_frame& frame, const ecs_transform_component& transform) = 0;
+	/**
+	Gets the GPU memory used by this resource in bytes. Used to enforce the
+	resource cache budgets.
+	*/
+	virtual uint64_t get_memory_size() const;
+
+	virtual void render(const gpu_frame& frame, const ecs_transform_component& transform, gpu_model_instance& instance) = 0;
 
 private:
 
@@ -32,6 +32,11 @@ gpu_texture::~gpu_texture()
 {
 }
 
+uint64_t gpu_texture::get_memory_size() const
+{
+	return 0;
+}
+
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
@@ -0,0 +1,256 @@
+/*=============================================================================
+vlk_bindless_textures.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/descriptors/vlk_bindless_textures.h"
+#include "jetz/main/common.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_bindless_textures::vlk_bindless_textures(vlk_device& device)
+	:
+	_device(device),
+	_layout(VK_NULL_HANDLE),
+	_pool(VK_NULL_HANDLE),
+	_set(VK_NULL_HANDLE),
+	_frame_num(0),
+	_next_index(0),
+	_used(0),
+	_peak_used(0),
+	_full(false)
+{
+	create_layout();
+	create_pool();
+	create_set();
+}
+
+vlk_bindless_textures::~vlk_bindless_textures()
+{
+	LOG_INFO_FMT("Bindless textures: peak {0} of {1} slots in use.", _peak_used, max_textures);
+
+	/* The set is freed with the pool */
+	destroy_pool();
+	destroy_layout();
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+uint32_t vlk_bindless_textures::add(VkImageView view)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	/* Reuse recycled slots first */
+	uint32_t index;
+	if (!_free.empty())
+	{
+		index = _free.back();
+		_free.pop_back();
+	}
+	else if (_next_index < max_textures)
+	{
+		index = _next_index++;
+	}
+	else
+	{
+		if (!_full)
+		{
+			LOG_WARN_FMT("Bindless texture array is full ({0} slots) - raise its size.", max_textures);
+			_full = true;
+		}
+
+		return invalid_index;
+	}
+
+	_used++;
+	_peak_used = (std::max)(_peak_used, _used);
+
+	/* Frames in flight never sample a free slot, so it can be written while they're pending */
+	VkDescriptorImageInfo image_info = {};
+	image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	image_info.imageView = view;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = _set;
+	write.dstBinding = 0;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.descriptorCount = 1;
+	write.pImageInfo = &image_info;
+
+	vkUpdateDescriptorSets(_device.get_handle(), 1, &write, 0, NULL);
+
+	return index;
+}
+
+void vlk_bindless_textures::bind(VkCommandBuffer cmd_buf, VkPipelineLayout pipeline_layout, uint32_t set_num) const
+{
+	vkCmdBindDescriptorSets(cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set_num, 1, &_set, 0, NULL);
+}
+
+VkDescriptorSetLayout vlk_bindless_textures::get_layout_handle() const
+{
+	return _layout;
+}
+
+uint32_t vlk_bindless_textures::get_used_count() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _used;
+}
+
+void vlk_bindless_textures::remove(uint32_t index)
+{
+	if (index == invalid_index)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_used--;
+
+	retired_slot r = {};
+	r.index = index;
+	r.frame = _frame_num;
+	_retired.push_back(r);
+}
+
+void vlk_bindless_textures::update()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_frame_num++;
+
+	/* Frames that could still sample a slot have finished after num_frame_buf frames */
+	size_t kept = 0;
+	for (size_t i = 0; i < _retired.size(); ++i)
+	{
+		auto& r = _retired[i];
+		if (r.frame + gpu::num_frame_buf > _frame_num)
+		{
+			_retired[kept++] = r;
+			continue;
+		}
+
+		_free.push_back(r.index);
+	}
+
+	_retired.resize(kept);
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void vlk_bindless_textures::create_layout()
+{
+	VkSampler sampler = _device.get_texture_sampler();
+
+	VkDescriptorSetLayoutBinding bindings[2];
+	memset(bindings, 0, sizeof(bindings));
+
+	/* Texture array */
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[0].descriptorCount = max_textures;
+	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	/* Sampler shared by all textures */
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[1].pImmutableSamplers = &sampler;
+
+	/* Unused slots may hold no (or destroyed) views, and slots are written while the set is bound */
+	VkDescriptorBindingFlagsEXT binding_flags[2] = {
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+			| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+			| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT,
+		0
+	};
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info = {};
+	flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	flags_info.bindingCount = cnt_of_array(binding_flags);
+	flags_info.pBindingFlags = binding_flags;
+
+	VkDescriptorSetLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.pNext = &flags_info;
+	layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layout_info.bindingCount = cnt_of_array(bindings);
+	layout_info.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(_device.get_handle(), &layout_info, NULL, &_layout) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create bindless texture descriptor set layout.");
+	}
+}
+
+void vlk_bindless_textures::create_pool()
+{
+	VkDescriptorPoolSize pool_sizes[2];
+	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	pool_sizes[0].descriptorCount = max_textures;
+	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+	pool_sizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	pool_info.poolSizeCount = cnt_of_array(pool_sizes);
+	pool_info.pPoolSizes = pool_sizes;
+	pool_info.maxSets = 1;
+
+	if (vkCreateDescriptorPool(_device.get_handle(), &pool_info, NULL, &_pool) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create bindless texture descriptor pool.");
+	}
+}
+
+void vlk_bindless_textures::create_set()
+{
+	VkDescriptorSetAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_info.descriptorPool = _pool;
+	alloc_info.descriptorSetCount = 1;
+	alloc_info.pSetLayouts = &_layout;
+
+	if (vkAllocateDescriptorSets(_device.get_handle(), &alloc_info, &_set) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to allocate bindless texture descriptor set.");
+	}
+}
+
+void vlk_bindless_textures::destroy_layout()
+{
+	vkDestroyDescriptorSetLayout(_device.get_handle(), _layout, NULL);
+}
+
+void vlk_bindless_textures::destroy_pool()
+{
+	vkDestroyDescriptorPool(_device.get_handle(), _pool, NULL);
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,126 @@
+/*=============================================================================
+vlk_bindless_textures.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_device;
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+One global descriptor set holding every texture's image view in an array
+(VK_EXT_descriptor_indexing). Shaders pick a texture by its index in the
+array, so materials don't need descriptor sets of their own and the set is
+bound once per frame.
+
+Binding 0 is the image array, binding 1 the device's texture sampler (an
+immutable sampler). Slots are written with update-after-bind, so textures
+can be added while frames using the set are in flight.
+
+Textures may be added and removed from any thread.
+*/
+class vlk_bindless_textures {
+
+public:
+
+	/** Returned when a texture has no slot. Shaders treat it as no texture. */
+	static const uint32_t invalid_index = UINT32_MAX;
+
+	/**
+	Number of slots in the array. Devices with descriptor indexing support at
+	least 500000 update-after-bind sampled images per set.
+	*/
+	static const uint32_t max_textures = 16384;
+
+	vlk_bindless_textures(vlk_device& device);
+	~vlk_bindless_textures();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Writes an image view to a free slot. Logs a warning and returns
+	invalid_index if the array is full.
+
+	@returns The index of the slot.
+	*/
+	uint32_t add(VkImageView view);
+
+	/** Binds the set. The set number is specified in the shader. */
+	void bind(VkCommandBuffer cmd_buf, VkPipelineLayout pipeline_layout, uint32_t set_num) const;
+
+	VkDescriptorSetLayout get_layout_handle() const;
+
+	/** Gets the number of slots in use. */
+	uint32_t get_used_count() const;
+
+	/** Frees a slot once frames that may sample it are done. */
+	void remove(uint32_t index);
+
+	/**
+	Recycles removed slots. Call at the start of a frame, after the frame's
+	fence has been waited on.
+	*/
+	void update();
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct retired_slot
+	{
+		uint32_t				index;
+		uint64_t				frame;			/* frame the slot was removed */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	void create_layout();
+	void create_pool();
+	void create_set();
+	void destroy_layout();
+	void destroy_pool();
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+	VkDescriptorSetLayout			_layout;
+	VkDescriptorPool				_pool;
+	VkDescriptorSet					_set;
+
+	mutable std::mutex				_mutex;
+	uint64_t						_frame_num;
+	uint32_t						_next_index;	/* slots at and above this have never been used */
+	std::vector<uint32_t>			_free;			/* recycled slots ready for reuse */
+	std::vector<retired_slot>		_retired;
+	uint32_t						_used;
+	uint32_t						_peak_used;
+	bool							_full;			/* the array filled up, warned once */
+};
+
+}   /* namespace jetz */
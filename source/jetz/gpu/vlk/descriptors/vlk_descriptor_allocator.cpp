@@ -0,0 +1,206 @@
+/*=============================================================================
+vlk_descriptor_allocator.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/descriptors/vlk_descriptor_allocator.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_descriptor_allocator::vlk_descriptor_allocator
+	(
+	vlk_device&									device,
+	VkDescriptorSetLayout						layout,
+	const std::vector<VkDescriptorPoolSize>&	set_sizes,
+	uint32_t									sets_per_pool,
+	const std::string&							name
+	)
+	:
+	_device(device),
+	_layout(layout),
+	_pool_sizes(set_sizes),
+	_sets_per_pool(sets_per_pool),
+	_name(name),
+	_frame_num(0),
+	_pool_used(0),
+	_in_use(0),
+	_peak_in_use(0)
+{
+	for (auto& size : _pool_sizes)
+	{
+		size.descriptorCount *= sets_per_pool;
+	}
+}
+
+vlk_descriptor_allocator::~vlk_descriptor_allocator()
+{
+	LOG_INFO_FMT("{0} descriptor sets: peak {1} in use, {2} pools.", _name, _peak_in_use, _pools.size());
+
+	/* Sets are freed with their pools */
+	for (auto pool : _pools)
+	{
+		vkDestroyDescriptorPool(_device.get_handle(), pool, NULL);
+	}
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+void vlk_descriptor_allocator::allocate(uint32_t count, VkDescriptorSet* sets)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_in_use += count;
+	_peak_in_use = (std::max)(_peak_in_use, _in_use);
+
+	/* Reuse recycled sets first */
+	while (count > 0 && !_free.empty())
+	{
+		*sets++ = _free.back();
+		_free.pop_back();
+		count--;
+	}
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	/*
+	Allocating past a pool's maxSets is invalid usage without
+	VK_KHR_maintenance1, so a new pool is chained before the current one
+	would overflow. All sets have the same layout, so the pool's descriptor
+	counts run out together with its sets.
+	*/
+	while (count > 0)
+	{
+		if (_pools.empty() || _pool_used == _sets_per_pool)
+		{
+			create_pool();
+		}
+
+		uint32_t batch = (std::min)(count, _sets_per_pool - _pool_used);
+		std::vector<VkDescriptorSetLayout> layouts(batch, _layout);
+
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = _pools.back();
+		alloc_info.descriptorSetCount = batch;
+		alloc_info.pSetLayouts = layouts.data();
+
+		VkResult result = vkAllocateDescriptorSets(_device.get_handle(), &alloc_info, sets);
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+		{
+			/* Shouldn't happen given the count above - chain a new pool and retry anyway */
+			create_pool();
+			alloc_info.descriptorPool = _pools.back();
+
+			result = vkAllocateDescriptorSets(_device.get_handle(), &alloc_info, sets);
+		}
+
+		if (result != VK_SUCCESS)
+		{
+			LOG_FATAL("Failed to allocate descriptor sets.");
+		}
+
+		_pool_used += batch;
+		sets += batch;
+		count -= batch;
+	}
+}
+
+void vlk_descriptor_allocator::free(uint32_t count, const VkDescriptorSet* sets)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_in_use -= count;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		retired_set r = {};
+		r.set = sets[i];
+		r.frame = _frame_num;
+		_retired.push_back(r);
+	}
+}
+
+uint32_t vlk_descriptor_allocator::get_in_use_count() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _in_use;
+}
+
+uint32_t vlk_descriptor_allocator::get_pool_count() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return static_cast<uint32_t>(_pools.size());
+}
+
+void vlk_descriptor_allocator::update()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_frame_num++;
+
+	/* Frames that could still bind a set have finished after num_frame_buf frames */
+	size_t kept = 0;
+	for (size_t i = 0; i < _retired.size(); ++i)
+	{
+		auto& r = _retired[i];
+		if (r.frame + gpu::num_frame_buf > _frame_num)
+		{
+			_retired[kept++] = r;
+			continue;
+		}
+
+		_free.push_back(r.set);
+	}
+
+	_retired.resize(kept);
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void vlk_descriptor_allocator::create_pool()
+{
+	VkDescriptorPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.poolSizeCount = (uint32_t)_pool_sizes.size();
+	pool_info.pPoolSizes = _pool_sizes.data();
+	pool_info.maxSets = _sets_per_pool;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(_device.get_handle(), &pool_info, NULL, &pool) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create descriptor pool.");
+	}
+
+	_pools.push_back(pool);
+	_pool_used = 0;
+
+	if (_pools.size() > 1)
+	{
+		LOG_INFO_FMT("{0} descriptor pool {1} created ({2} sets in use).", _name, _pools.size(), _in_use);
+	}
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,125 @@
+/*=============================================================================
+vlk_descriptor_allocator.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_device;
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Allocates descriptor sets of one layout from a chain of descriptor pools.
+When a pool's sets have all been handed out another one is created, so the
+number of sets isn't capped. Freed sets are kept and handed out again by later allocations
+(callers rewrite them anyway), once frames that may still bind them are
+done.
+
+Sets may be allocated and freed from any thread.
+*/
+class vlk_descriptor_allocator {
+
+public:
+
+	/**
+	@param device The logical device.
+	@param layout The layout of the allocated sets.
+	@param set_sizes The number of descriptors of each type in one set.
+	@param sets_per_pool The number of sets each pool holds.
+	@param name Name of the layout, for logging.
+	*/
+	vlk_descriptor_allocator
+		(
+		vlk_device&								device,
+		VkDescriptorSetLayout					layout,
+		const std::vector<VkDescriptorPoolSize>&	set_sizes,
+		uint32_t								sets_per_pool,
+		const std::string&						name
+		);
+
+	~vlk_descriptor_allocator();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Allocates descriptor sets. Recycled sets still hold their old
+	descriptors, so they must be written before use.
+	*/
+	void allocate(uint32_t count, VkDescriptorSet* sets);
+
+	/** Queues sets to be recycled once frames that may use them are done. */
+	void free(uint32_t count, const VkDescriptorSet* sets);
+
+	/** Gets the number of sets currently allocated to callers. */
+	uint32_t get_in_use_count() const;
+
+	/** Gets the number of pools created so far. */
+	uint32_t get_pool_count() const;
+
+	/**
+	Recycles freed sets. Call at the start of a frame, after the frame's
+	fence has been waited on.
+	*/
+	void update();
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct retired_set
+	{
+		VkDescriptorSet			set;
+		uint64_t				frame;			/* frame the set was freed */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Adds a pool to the chain. Requires the lock. */
+	void create_pool();
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+	VkDescriptorSetLayout			_layout;
+	std::vector<VkDescriptorPoolSize>
+									_pool_sizes;		/* descriptors in each pool */
+	uint32_t						_sets_per_pool;
+	std::string						_name;
+
+	mutable std::mutex				_mutex;
+	uint64_t						_frame_num;
+	std::vector<VkDescriptorPool>	_pools;				/* sets are allocated from the last pool */
+	uint32_t						_pool_used;			/* sets allocated from the last pool */
+	std::vector<VkDescriptorSet>	_free;				/* recycled sets ready for reuse */
+	std::vector<retired_set>		_retired;
+	uint32_t						_in_use;
+	uint32_t						_peak_in_use;
+};
+
+}   /* namespace jetz */
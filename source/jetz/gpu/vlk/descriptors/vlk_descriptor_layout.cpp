@@ -23,21 +23,25 @@ CONSTRUCTORS
 
 vlk_descriptor_layout::vlk_descriptor_layout(vlk_device& dev)
 	: dev(dev),
-	handle(VK_NULL_HANDLE),
-	pool_handle(VK_NULL_HANDLE)
+	handle(VK_NULL_HANDLE)
 {
 }
 
 vlk_descriptor_layout::~vlk_descriptor_layout() 
 {
+	destroy_allocator();
 	destroy_layout();
-	destroy_descriptor_pool();
 }
 
 /*=============================================================================
 PUBLIC METHODS
 =============================================================================*/
 
+vlk_descriptor_allocator& vlk_descriptor_layout::get_allocator() const
+{
+	return *allocator;
+}
+
 VkDescriptorSetLayout vlk_descriptor_layout::get_handle() const
 {
 	return handle;
@@ -48,18 +52,13 @@ vlk_device& vlk_descriptor_layout::get_device() const
 	return dev;
 }
 
-VkDescriptorPool vlk_descriptor_layout::get_pool_handle() const
-{
-	return pool_handle;
-}
-
 /*=============================================================================
 PROTECTED METHODS
 =============================================================================*/
 
-void vlk_descriptor_layout::destroy_descriptor_pool()
+void vlk_descriptor_layout::destroy_allocator()
 {
-	vkDestroyDescriptorPool(dev.get_handle(), pool_handle, NULL);
+	allocator.reset();
 }
 
 void vlk_descriptor_layout::destroy_layout()
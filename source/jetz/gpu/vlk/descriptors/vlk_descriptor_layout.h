@@ -10,6 +10,9 @@ INCLUDES
 
 #include <vulkan/vulkan.h>
 
+#include "jetz/main/common.h"
+#include "jetz/gpu/vlk/descriptors/vlk_descriptor_allocator.h"
+
 /*=============================================================================
 NAMESPACE
 =============================================================================*/
@@ -37,9 +40,11 @@ public:
 	Public Methods
 	-----------------------------------------------------*/
 
+	/** Gets the allocator for descriptor sets of this layout. */
+	vlk_descriptor_allocator&	get_allocator() const;
+
 	VkDescriptorSetLayout	get_handle() const;
 	vlk_device&				get_device() const;
-	VkDescriptorPool		get_pool_handle() const;
 
 protected:
 
@@ -47,14 +52,14 @@ protected:
 	Protected methods
 	-----------------------------------------------------*/
 
-	/** Creates a descriptor pool for this layout. Descriptor sets are allocated from the pool. */
-	virtual void create_descriptor_pool() = 0;
+	/** Creates the descriptor set allocator for this layout. Requires the layout. */
+	virtual void create_allocator() = 0;
 
 	/** Creates the descriptor set layout. */
 	virtual void create_layout() = 0;
 
-	/** Destroys the descriptor pool. */
-	void destroy_descriptor_pool();
+	/** Destroys the descriptor set allocator, and the sets allocated from it. */
+	void destroy_allocator();
 
 	/** Destroys the descriptor set layout. */
 	void destroy_layout();
@@ -71,8 +76,8 @@ protected:
 	/*
 	Create/destroy
 	*/
+	uptr<vlk_descriptor_allocator>	allocator;
 	VkDescriptorSetLayout		handle;
-	VkDescriptorPool			pool_handle;
 };
 
 }   /* namespace jetz */
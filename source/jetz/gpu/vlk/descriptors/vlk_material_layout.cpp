@@ -24,8 +24,8 @@ CONSTRUCTORS
 vlk_material_layout::vlk_material_layout(vlk_device& dev)
 	: vlk_descriptor_layout(dev)
 {
-	create_descriptor_pool();
 	create_layout();
+	create_allocator();
 }
 
 vlk_material_layout::~vlk_material_layout()
@@ -40,38 +40,20 @@ PUBLIC METHODS
 PROTECTED METHODS
 =============================================================================*/
 
-void vlk_material_layout::create_descriptor_pool()
+void vlk_material_layout::create_allocator()
 {
-	VkDescriptorPoolSize pool_sizes[2];
-	memset(pool_sizes, 0, sizeof(pool_sizes));
-	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	pool_sizes[0].descriptorCount = 1000; // gpu::max_num_materials;
-	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	pool_sizes[1].descriptorCount = 1000; // gpu::max_num_materials;
-
-	VkDescriptorPoolCreateInfo pool_info = {};
-	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	pool_info.poolSizeCount = cnt_of_array(pool_sizes);
-	pool_info.pPoolSizes = pool_sizes;
-
-	// TOOD : what should maxSets be??
-	pool_info.maxSets = gpu::max_num_materials;
-
-	if (vkCreateDescriptorPool(dev.get_handle(), &pool_info, NULL, &pool_handle) != VK_SUCCESS)
-	{
-		LOG_FATAL("Failed to create descriptor pool.");
-	}
+	/* Descriptors in one material set - 5 textures */
+	std::vector<VkDescriptorPoolSize> set_sizes(1);
+	set_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	set_sizes[0].descriptorCount = 5;
+
+	/* Pools are chained as needed, so this only sets the allocation granularity */
+	allocator = uptr<vlk_descriptor_allocator>(new vlk_descriptor_allocator(dev, handle, set_sizes, sets_per_pool, "Material"));
 }
 
 void vlk_material_layout::create_layout()
 {
-	/* Material UBO */
-	VkDescriptorSetLayoutBinding ubo_layout_binding = {};
-	ubo_layout_binding.binding = 0;
-	ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	ubo_layout_binding.descriptorCount = 1;
-	ubo_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	ubo_layout_binding.pImmutableSamplers = NULL;
+	/* Material parameters are in the material buffer (set 2), so binding 0 is unused */
 
 	/* Base color texture */
 	VkDescriptorSetLayoutBinding base_color_texture_binding = {};
@@ -115,7 +97,6 @@ void vlk_material_layout::create_layout()
 
 	std::vector< VkDescriptorSetLayoutBinding> bindings =
 	{
-		ubo_layout_binding,
 		base_color_texture_binding,
 		metallic_roughness_texture_binding,
 		normal_texture_binding,
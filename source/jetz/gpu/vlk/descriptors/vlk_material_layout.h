@@ -45,14 +45,21 @@ protected:
 	Protected methods
 	-----------------------------------------------------*/
 
-	/** Creates a descriptor pool for this layout. Descriptor sets are allocated from the pool. */
-	virtual void create_descriptor_pool() override;
+	/** Creates the descriptor set allocator for this layout. Requires the layout. */
+	virtual void create_allocator() override;
 
 	/** Creates the descriptor set layout. */
 	virtual void create_layout() override;
 
 private:
 
+	/*-----------------------------------------------------
+	Private constants
+	-----------------------------------------------------*/
+
+	/** Number of material sets in each descriptor pool. */
+	static const uint32_t sets_per_pool = 256;
+
 	/*-----------------------------------------------------
 	Private methods
 	-----------------------------------------------------*/
@@ -24,8 +24,8 @@ CONSTRUCTORS
 vlk_per_view_layout::vlk_per_view_layout(vlk_device& dev)
 	: vlk_descriptor_layout(dev)
 {
-	create_descriptor_pool();
 	create_layout();
+	create_allocator();
 }
 
 vlk_per_view_layout::~vlk_per_view_layout()
@@ -40,32 +40,22 @@ PUBLIC METHODS
 PRIVATE METHODS
 =============================================================================*/
 
-void vlk_per_view_layout::create_descriptor_pool()
+void vlk_per_view_layout::create_allocator()
 {
-	VkDescriptorPoolSize pool_sizes[1];
-	memset(pool_sizes, 0, sizeof(pool_sizes));
-	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	pool_sizes[0].descriptorCount = gpu::num_frame_buf;
+	/* Descriptors in one per-view set - the view UBO */
+	std::vector<VkDescriptorPoolSize> set_sizes(1);
+	set_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	set_sizes[0].descriptorCount = 1;
 
-	VkDescriptorPoolCreateInfo pool_info = {};
-	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	pool_info.poolSizeCount = cnt_of_array(pool_sizes);
-	pool_info.pPoolSizes = pool_sizes;
-
-	// TOOD : what should maxSets be??
-	pool_info.maxSets = gpu::num_frame_buf;
-
-	if (vkCreateDescriptorPool(dev.get_handle(), &pool_info, NULL, &pool_handle) != VK_SUCCESS)
-	{
-		LOG_FATAL("Failed to create descriptor pool.");
-	}
+	/* One set per frame in flight for each view */
+	allocator = uptr<vlk_descriptor_allocator>(new vlk_descriptor_allocator(dev, handle, set_sizes, gpu::num_frame_buf, "Per-view"));
 }
 
 void vlk_per_view_layout::create_layout()
 {
 	VkDescriptorSetLayoutBinding ubo_layout_binding = {};
 	ubo_layout_binding.binding = 0;
-	ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	ubo_layout_binding.descriptorCount = 1;
 	ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	ubo_layout_binding.pImmutableSamplers = NULL; // Optional
@@ -52,8 +52,8 @@ protected:
 	Protected methods
 	-----------------------------------------------------*/
 
-	/** Creates a descriptor pool for this layout. Descriptor sets are allocated from the pool. */
-	virtual void create_descriptor_pool() override;
+	/** Creates the descriptor set allocator for this layout. Requires the layout. */
+	virtual void create_allocator() override;
 
 	/** Creates the descriptor set layout. */
 	virtual void create_layout() override;
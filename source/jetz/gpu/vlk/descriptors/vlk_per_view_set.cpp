@@ -10,6 +10,7 @@ INCLUDES
 
 #include "jetz/gpu/vlk/vlk.h"
 #include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/vlk_scratch_allocator.h"
 #include "jetz/gpu/vlk/descriptors/vlk_per_view_layout.h"
 #include "jetz/gpu/vlk/descriptors/vlk_per_view_set.h"
 #include "jetz/main/common.h"
@@ -28,14 +29,12 @@ CONSTRUCTORS
 vlk_per_view_set::vlk_per_view_set(vlk_per_view_layout& layout)
 	: layout(layout)
 {
-	create_buffers();
 	create_sets();
 }
 
 vlk_per_view_set::~vlk_per_view_set()
 {
 	destroy_sets();
-	destroy_buffers();
 }
 
 /*=============================================================================
@@ -50,12 +49,13 @@ void vlk_per_view_set::bind
 	)
 {
 	uint32_t setNum = 0; // TODO : hardcoded for now
-	vkCmdBindDescriptorSets(cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setNum, 1, &sets[frame.image_idx], 0, NULL);
+	uint8_t frame_idx = frame.get_frame_idx();
+	vkCmdBindDescriptorSets(cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setNum, 1, &sets[frame_idx], 1, &offsets[frame_idx]);
 }
 
 void vlk_per_view_set::update
 	(
-	const vlk_frame&		frame,
+	vlk_frame&				frame,
 	const camera&			camera,
 	VkExtent2D				extent
 	)
@@ -72,48 +72,66 @@ void vlk_per_view_set::update
 	/* Camera position */
 	ubo.camera_pos = camera.get_pos();
 
-	/* Update the UBO */
-	buffers[frame.image_idx]->update((void*)&ubo, 0, sizeof(ubo));
-}
+	/* Keep a CPU copy in the frame */
+	frame.view = ubo.view;
+	frame.proj = ubo.proj;
+	frame.camera_pos = ubo.camera_pos;
+	frame.extent = extent;
 
-/*=============================================================================
-PRIVATE METHODS
-=============================================================================*/
+	/* Extract frustum planes from the view projection matrix rows */
+	glm::mat4 vp = ubo.proj * ubo.view;
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		row[i] = glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]);
+	}
 
-void vlk_per_view_set::create_buffers()
-{
-	VkDeviceSize buffer_size = sizeof(vlk_per_view_ubo);
-	buffers.resize(gpu::num_frame_buf);
+	frame.frustum[0] = row[3] + row[0];
+	frame.frustum[1] = row[3] - row[0];
+	frame.frustum[2] = row[3] + row[1];
+	frame.frustum[3] = row[3] - row[1];
+	frame.frustum[4] = row[3] + row[2];
+	frame.frustum[5] = row[3] - row[2];
 
-	for (uint32_t i = 0; i < buffers.size(); ++i)
+	for (auto& plane : frame.frustum)
 	{
-		buffers[i] = new jetz::vlk_buffer(layout.get_device(), buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+		plane /= glm::length(glm::vec3(plane));
 	}
+
+	/* Write the UBO to the frame's scratch buffer - bound with a dynamic offset */
+	uint8_t frame_idx = frame.get_frame_idx();
+	auto range = layout.get_device().get_scratch_allocator().allocate_uniform(frame_idx, sizeof(ubo));
+	if (range.buffer == VK_NULL_HANDLE)
+	{
+		/* Keep the offset from the last time this frame was drawn */
+		return;
+	}
+
+	memcpy(range.data, &ubo, sizeof(ubo));
+	offsets[frame_idx] = static_cast<uint32_t>(range.offset);
 }
 
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
 void vlk_per_view_set::create_sets()
 {
 	/*
 	Create a descriptor set for each possible concurrent frame
 	*/
 	sets.resize(gpu::num_frame_buf);
+	offsets.resize(gpu::num_frame_buf, 0);
 
-	std::vector<VkDescriptorSetLayout> layouts(gpu::num_frame_buf, layout.get_handle());
-	VkDescriptorSetAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	alloc_info.descriptorPool = layout.get_pool_handle();
-	alloc_info.descriptorSetCount = (uint32_t)layouts.size();
-	alloc_info.pSetLayouts = layouts.data();
-
-	VkResult result = vkAllocateDescriptorSets(layout.get_device().get_handle(), &alloc_info, &sets[0]);
-	if (result != VK_SUCCESS)
-	{
-		LOG_FATAL("Failed to allocate descriptor sets.");
-	}
+	layout.get_allocator().allocate((uint32_t)sets.size(), sets.data());
 
 	for (uint32_t i = 0; i < gpu::num_frame_buf; i++)
 	{
-		VkDescriptorBufferInfo buffer_info = buffers[i]->get_buffer_info();
+		/* The set covers one UBO - the dynamic offset picks which one */
+		VkDescriptorBufferInfo buffer_info = {};
+		buffer_info.buffer = layout.get_device().get_scratch_allocator().get_buffer(i);
+		buffer_info.offset = 0;
+		buffer_info.range = sizeof(vlk_per_view_ubo);
 
 		VkWriteDescriptorSet descriptor_writes[1];
 		memset(descriptor_writes, 0, sizeof(descriptor_writes));
@@ -122,7 +140,7 @@ void vlk_per_view_set::create_sets()
 		descriptor_writes[0].dstSet = sets[i];
 		descriptor_writes[0].dstBinding = 0;
 		descriptor_writes[0].dstArrayElement = 0;
-		descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		descriptor_writes[0].descriptorCount = 1;
 		descriptor_writes[0].pBufferInfo = &buffer_info;
 
@@ -130,22 +148,10 @@ void vlk_per_view_set::create_sets()
 	}
 }
 
-void vlk_per_view_set::destroy_buffers()
-{
-	for (uint32_t i = 0; i < buffers.size(); ++i)
-	{
-		delete buffers[i];
-	}
-
-	buffers.clear();
-}
-
 void vlk_per_view_set::destroy_sets()
 {
-	/* 
-	Descriptor sets are destroyed automatically when the parent descriptor pool 
-	is destroyed.
-	*/
+	layout.get_allocator().free((uint32_t)sets.size(), sets.data());
+	sets.clear();
 }
 
 }   /* namespace jetz */
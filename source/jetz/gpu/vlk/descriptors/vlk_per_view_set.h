@@ -12,7 +12,6 @@ INCLUDES
 #include <vulkan/vulkan.h>
 
 #include "jetz/gpu/vlk/vlk_frame.h"
-#include "jetz/gpu/vlk/vlk_buffer.h"
 #include "jetz/gpu/vlk/descriptors/vlk_per_view_layout.h"
 #include "jetz/main/camera.h"
 
@@ -52,11 +51,13 @@ public:
 		);
 
 	/**
-	Updates data in the per-view UBO for the specified frame.
+	Writes the per-view UBO for the specified frame to the frame's scratch
+	buffer. The view data is also stored in the frame for use on the CPU
+	(culling, LOD selection).
 	*/
 	void update
 		(
-		const vlk_frame&				frame,
+		vlk_frame&						frame,
 		const camera&					camera,
 		VkExtent2D						extent
 		);
@@ -67,15 +68,9 @@ private:
 	Private methods
 	-----------------------------------------------------*/
 
-	/** Creates buffers for the set. */
-	void create_buffers();
-
 	/** Creates the descriptor sets. */
 	void create_sets();
 
-	/** Destroys buffers for the set. */
-	void destroy_buffers();
-
 	/** Destroys the descriptor sets. */
 	void destroy_sets();
 
@@ -91,8 +86,8 @@ private:
 	/*
 	Create/destroy
 	*/
-	std::vector<vlk_buffer*>		buffers;
-	std::vector<VkDescriptorSet>	sets;
+	std::vector<VkDescriptorSet>	sets;			/* one per frame in flight, bound to the frame's scratch buffer */
+	std::vector<uint32_t>			offsets;		/* dynamic offset of each frame's UBO in its scratch buffer */
 };
 
 }   /* namespace jetz */
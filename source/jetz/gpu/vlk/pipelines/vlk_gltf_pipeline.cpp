@@ -61,7 +61,8 @@ PRIVATE METHODS
 void vlk_gltf_pipeline::create_pipeline()
 {
 	VkShaderModule vert_shader = _dev.create_shader("bin/shaders/gltf.vert.spv");
-	VkShaderModule frag_shader = _dev.create_shader("bin/shaders/gltf.frag.spv");
+	/* The bindless variant takes the material from push constants and the global texture array */
+	VkShaderModule frag_shader = _dev.create_shader(_dev.has_bindless_textures() ? "bin/shaders/gltf_bindless.frag.spv" : "bin/shaders/gltf.frag.spv");
 
 	/*
 	* Shader stage creation
@@ -72,6 +73,20 @@ void vlk_gltf_pipeline::create_pipeline()
 	vertShaderStageInfo.module = vert_shader;
 	vertShaderStageInfo.pName = "main";
 
+	/* Specialization constants - must match constant_id in gltf.vert */
+	VkSpecializationMapEntry specEntry = {};
+	specEntry.constantID = 0;
+	specEntry.offset = 0;
+	specEntry.size = sizeof(VkBool32);
+
+	VkSpecializationInfo specInfo = {};
+	specInfo.mapEntryCount = 1;
+	specInfo.pMapEntries = &specEntry;
+	specInfo.dataSize = sizeof(VkBool32);
+	specInfo.pData = &_create_info.oct_normals;
+
+	vertShaderStageInfo.pSpecializationInfo = &specInfo;
+
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
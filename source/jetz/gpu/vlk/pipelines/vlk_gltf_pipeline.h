@@ -71,10 +71,25 @@ struct vlk_gltf_push_constant_vertex
 	glm::mat4	model_matrix;	/* 16 * 4 = 64 bytes */
 };
 
+/**
+Fragment shader push constants - the material. The texture indices are only
+used by gltf_bindless.frag.
+*/
+struct vlk_gltf_push_constant_fragment
+{
+	uint32_t	material_index;				/* entry in the device's material buffer */
+	uint32_t	base_color_texture;			/* bindless texture indices, UINT32_MAX if none */
+	uint32_t	metallic_roughness_texture;
+	uint32_t	normal_texture;
+	uint32_t	occlusion_texture;
+	uint32_t	emissive_texture;			/* 24 bytes */
+};
+
 /** All push constants */
 struct vlk_gltf_push_constant
 {
 	vlk_gltf_push_constant_vertex	vertex;
+	vlk_gltf_push_constant_fragment	fragment;
 };
 
 }   /* namespace jetz */
@@ -7,6 +7,7 @@ INCLUDES
 =============================================================================*/
 
 #include "jetz/gpu/vlk/vlk.h"
+#include "jetz/gpu/vlk/vlk_scratch_allocator.h"
 #include "jetz/gpu/vlk/pipelines/vlk_imgui_pipeline.h"
 #include "jetz/main/common.h"
 #include "jetz/main/log.h"
@@ -29,7 +30,6 @@ vlk_imgui_pipeline::vlk_imgui_pipeline
 	)
 	: vlk_pipeline(device, render_pass, extent)
 {
-	create_buffers();
 	create_font_texture();
 	create_descriptor_pool();
 	create_descriptor_layout();
@@ -46,7 +46,6 @@ vlk_imgui_pipeline::~vlk_imgui_pipeline()
 	destroy_descriptor_layout();
 	destroy_descriptor_pool();
 	destroy_font_texture();
-	destroy_buffers();
 }
 
 /*=============================================================================
@@ -67,49 +66,21 @@ void vlk_imgui_pipeline::render(const vlk_frame& frame, ImDrawData* draw_data)
 	if (vertex_size == 0 || index_size == 0)
 		return;
 
-	if (vertex_buffers[frame.image_idx] == nullptr
-		|| vertex_buffer_sizes[frame.image_idx] < vertex_size)
-	{
-		if (vertex_buffers[frame.image_idx] != nullptr)
-		{
-			delete vertex_buffers[frame.image_idx];
-		}
-
-		vertex_buffers[frame.image_idx] = new jetz::vlk_buffer(_dev, vertex_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		vertex_buffer_sizes[frame.image_idx] = vertex_size;
-	}
+	/* Vertices and indices only live for the frame - write them to the frame's scratch buffer */
+	auto& scratch = _dev.get_scratch_allocator();
+	auto vertex_range = scratch.allocate(frame.get_frame_idx(), vertex_size, sizeof(float));
+	auto index_range = scratch.allocate(frame.get_frame_idx(), index_size, sizeof(ImDrawIdx));
 
-	if (index_buffers[frame.image_idx] == nullptr
-		|| index_buffer_sizes[frame.image_idx] < index_size)
+	if (vertex_range.buffer == VK_NULL_HANDLE || index_range.buffer == VK_NULL_HANDLE)
 	{
-		if (index_buffers[frame.image_idx] != nullptr)
-		{
-			delete index_buffers[frame.image_idx];
-		}
-
-		index_buffers[frame.image_idx] = new jetz::vlk_buffer(_dev, index_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		index_buffer_sizes[frame.image_idx] = index_size;
+		/* Scratch buffer is full */
+		return;
 	}
 
 	// Upload Vertex and index Data:
 	{
-		ImDrawVert* vertex_dest = NULL;
-		ImDrawIdx* index_dest = NULL;
-
-		VmaAllocation vertex_alloc = vertex_buffers[frame.image_idx]->get_allocation();
-		VmaAllocation index_alloc = index_buffers[frame.image_idx]->get_allocation();
-
-		VkResult result = vmaMapMemory(_dev.get_allocator(), vertex_alloc, (void**)&vertex_dest);
-		if (result != VK_SUCCESS)
-		{
-			LOG_FATAL("Error");
-		}
-
-		result = vmaMapMemory(_dev.get_allocator(), index_alloc, (void**)&index_dest);
-		if (result != VK_SUCCESS)
-		{
-			LOG_FATAL("Error");
-		}
+		ImDrawVert* vertex_dest = (ImDrawVert*)vertex_range.data;
+		ImDrawIdx* index_dest = (ImDrawIdx*)index_range.data;
 
 		for (int n = 0; n < draw_data->CmdListsCount; n++)
 		{
@@ -119,9 +90,6 @@ void vlk_imgui_pipeline::render(const vlk_frame& frame, ImDrawData* draw_data)
 			vertex_dest += cmd_list->VtxBuffer.Size;
 			index_dest += cmd_list->IdxBuffer.Size;
 		}
-
-		vmaUnmapMemory(_dev.get_allocator(), vertex_alloc);
-		vmaUnmapMemory(_dev.get_allocator(), index_alloc);
 	}
 
 	/*
@@ -133,10 +101,10 @@ void vlk_imgui_pipeline::render(const vlk_frame& frame, ImDrawData* draw_data)
 	/*
 	Bind buffers
 	*/
-	VkBuffer vert_buffers[1] = { vertex_buffers[frame.image_idx]->get_handle() };
-	VkDeviceSize vert_offset[1] = { 0 };
+	VkBuffer vert_buffers[1] = { vertex_range.buffer };
+	VkDeviceSize vert_offset[1] = { vertex_range.offset };
 	vkCmdBindVertexBuffers(frame.cmd_buf, 0, 1, vert_buffers, vert_offset);
-	vkCmdBindIndexBuffer(frame.cmd_buf, index_buffers[frame.image_idx]->get_handle(), 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindIndexBuffer(frame.cmd_buf, index_range.buffer, index_range.offset, VK_INDEX_TYPE_UINT16);
 
 	/*
 	Setup viewport
@@ -213,17 +181,6 @@ void vlk_imgui_pipeline::resize(VkExtent2D extent)
 PRIVATE METHODS
 =============================================================================*/
 
-void vlk_imgui_pipeline::create_buffers()
-{
-	/*
-	Resize buffer arrays. Buffers are created and updated as needed at render time.
-	*/
-	index_buffers.resize(gpu::num_frame_buf, nullptr);
-	index_buffer_sizes.resize(gpu::num_frame_buf, 0);
-	vertex_buffers.resize(gpu::num_frame_buf, nullptr);
-	vertex_buffer_sizes.resize(gpu::num_frame_buf, 0);
-}
-
 void vlk_imgui_pipeline::create_descriptor_layout()
 {
 	/* Font texture */
@@ -348,6 +305,7 @@ void vlk_imgui_pipeline::create_font_texture()
 	//create_info.type = TEXTURE_TYPE_2D;
 
 	font_texture = new jetz::vlk_texture(_dev, create_info);
+	font_texture->wait_upload();
 	io.Fonts->TexID = (void*)font_texture->get_image();
 
 	/*
@@ -612,24 +570,6 @@ void vlk_imgui_pipeline::create_pipeline_layout()
 	}
 }
 
-void vlk_imgui_pipeline::destroy_buffers()
-{
-	for (uint32_t i = 0; i < vertex_buffers.size(); ++i)
-	{
-		if (vertex_buffers[i] != nullptr)
-		{
-			delete vertex_buffers[i];
-			vertex_buffers[i] = nullptr;
-		}
-
-		if (index_buffers[i] != nullptr)
-		{
-			delete index_buffers[i];
-			index_buffers[i] = nullptr;
-		}
-	}
-}
-
 void vlk_imgui_pipeline::destroy_descriptor_layout()
 {
 	vkDestroyDescriptorSetLayout(_dev.get_handle(), descriptor_layout, NULL);
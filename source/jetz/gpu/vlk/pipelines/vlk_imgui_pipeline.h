@@ -59,7 +59,6 @@ private:
 	Private methods
 	-----------------------------------------------------*/
 	
-	void create_buffers();
 	void create_descriptor_layout();
 
 	/**
@@ -76,7 +75,6 @@ private:
 	void create_font_texture();
 	void create_pipeline();
 	void create_pipeline_layout();
-	void destroy_buffers();
 	void destroy_descriptor_layout();
 	void destroy_descriptor_pool();
 	void destroy_descriptor_sets();
@@ -96,11 +94,6 @@ private:
 	std::vector<VkDescriptorSet>	descriptor_sets;
 	vlk_texture*					font_texture;
 	VkSampler						font_texture_sampler;
-
-	std::vector<vlk_buffer*>		index_buffers;
-	std::vector<uint32_t>			index_buffer_sizes;
-	std::vector<vlk_buffer*>		vertex_buffers;
-	std::vector<uint32_t>			vertex_buffer_sizes;
 };
 
 }   /* namespace jetz */
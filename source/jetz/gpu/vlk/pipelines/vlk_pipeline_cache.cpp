@@ -6,10 +6,13 @@ vlk_pipeline_cache.cpp
 INCLUDES
 =============================================================================*/
 
+#include <cstddef>
 #include <vector>
 
 #include "jetz/gpu/vlk/vlk_device.h"
 #include "jetz/gpu/vlk/vlk_frame.h"
+#include "jetz/gpu/vlk/vlk_material_buffer.h"
+#include "jetz/gpu/vlk/descriptors/vlk_bindless_textures.h"
 #include "jetz/gpu/vlk/descriptors/vlk_per_view_set.h"
 #include "jetz/gpu/vlk/pipelines/vlk_gltf_pipeline.h"
 #include "jetz/gpu/vlk/pipelines/vlk_pipeline_cache.h"
@@ -52,6 +55,13 @@ vlk_pipeline_cache::~vlk_pipeline_cache()
 PUBLIC METHODS
 =============================================================================*/
 
+void vlk_pipeline_cache::bind_bindless_textures(VkCommandBuffer cmd_buf)
+{
+	/* Set num is specified in the shader. Stays bound across gltf pipelines since they share the layout. */
+	uint32_t set_num = 1;
+	_device.get_bindless_textures().bind(cmd_buf, _gltf_layout_handle, set_num);
+}
+
 void vlk_pipeline_cache::bind_per_view_set(VkCommandBuffer cmd_buf, vlk_frame& frame, vlk_per_view_set* set)
 {
 	set->bind(cmd_buf, frame, _gltf_layout_handle);
@@ -62,6 +72,7 @@ const vlk_gltf_pipeline& vlk_pipeline_cache::create_gltf_pipeline(vlk_pipeline_c
 	/* Hash pipeline create info and check for a compatible pipeline */
 	auto hash = create_info.hash();
 
+	std::lock_guard<std::mutex> lock(_gltf_mutex);
 	auto existing = _gltf_pipelines.find(hash);
 	if (existing != _gltf_pipelines.end())
 	{
@@ -85,9 +96,12 @@ void vlk_pipeline_cache::resize(VkExtent2D extent)
 {
 	_extent = extent;
 
-	for (auto& pipeline : _gltf_pipelines)
 	{
-		pipeline.second->resize(extent);
+		std::lock_guard<std::mutex> lock(_gltf_mutex);
+		for (auto& pipeline : _gltf_pipelines)
+		{
+			pipeline.second->resize(extent);
+		}
 	}
 
 	_imgui_pipeline->resize(extent);
@@ -101,10 +115,13 @@ void vlk_pipeline_cache::create_gltf_layout()
 {
 	auto& per_view_layout = _device.get_per_view_layout();
 	auto& material_layout = _device.get_material_layout();
+	bool bindless = _device.has_bindless_textures();
 
+	/* Set 1 is either the global texture array or the material's own textures */
 	std::vector<VkDescriptorSetLayout> set_layouts = {
 		per_view_layout.get_handle(),
-		material_layout.get_handle()
+		bindless ? _device.get_bindless_textures().get_layout_handle() : material_layout.get_handle(),
+		_device.get_material_buffer().get_layout_handle()
 	};
 
 	/*
@@ -115,10 +132,17 @@ void vlk_pipeline_cache::create_gltf_layout()
 	pc_vert.size = sizeof(vlk_gltf_push_constant_vertex);
 	pc_vert.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+	/* The fragment shader gets the material index (and bindless texture indices) */
+	VkPushConstantRange pc_frag = {};
+	pc_frag.offset = offsetof(vlk_gltf_push_constant, fragment);
+	pc_frag.size = sizeof(vlk_gltf_push_constant_fragment);
+	pc_frag.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
 	// TODO : size and offset must be a multiple of 4
 	auto push_constants = std::vector<VkPushConstantRange>
 	{
-		pc_vert
+		pc_vert,
+		pc_frag
 	};
 
 	/*
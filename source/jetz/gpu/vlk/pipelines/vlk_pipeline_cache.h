@@ -8,6 +8,7 @@ vlk_pipeline_cache.h
 INCLUDES
 =============================================================================*/
 
+#include <mutex>
 #include <unordered_map>
 #include <vulkan/vulkan.h>
 
@@ -48,6 +49,7 @@ public:
 	/*-----------------------------------------------------
 	Public Methods
 	-----------------------------------------------------*/
+	void							bind_bindless_textures(VkCommandBuffer cmd_buf);
 	void							bind_per_view_set(VkCommandBuffer cmd_buf, vlk_frame& frame, vlk_per_view_set* set);
 	const vlk_gltf_pipeline&		create_gltf_pipeline(vlk_pipeline_create_info create_info);
 	vlk_imgui_pipeline&				get_imgui_pipeline() const;
@@ -70,6 +72,7 @@ private:
 	Create/destory
 	*/
 	VkPipelineLayout			_gltf_layout_handle;
+	std::mutex					_gltf_mutex;		/* guards _gltf_pipelines - models create pipelines on loader threads */
 	std::unordered_map<vlk_pipeline_hash, uptr<vlk_gltf_pipeline>>
 								_gltf_pipelines;
 	sptr<vlk_imgui_pipeline>	_imgui_pipeline;
@@ -30,6 +30,9 @@ struct vlk_pipeline_create_info
 	std::vector<VkVertexInputBindingDescription>
 								vertex_binding_descriptions;
 
+	/** Normals are octahedral encoded (see gpu_mesh_quantized_vertex). */
+	VkBool32					oct_normals = VK_FALSE;
+
 	size_t hash()
 	{
 		size_t hash = 0;
@@ -51,6 +54,8 @@ struct vlk_pipeline_create_info
 			utl::hash_combine(hash, bind.stride);
 		}
 
+		utl::hash_combine(hash, oct_normals);
+
 		return hash;
 	}
 };
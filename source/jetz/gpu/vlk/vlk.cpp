@@ -22,6 +22,8 @@ NAMESPACE
 
 namespace jetz {
 
+float vlk::device_memory_fraction = 0.8f;
+
 /*=============================================================================
 STATIC FUNCTIONS
 =============================================================================*/
@@ -89,10 +91,44 @@ sptr<gpu_factory> vlk::get_factory() const
 	return _factory;
 }
 
+uint64_t vlk::get_memory_budget(uint64_t cache_size) const
+{
+	VmaAllocator allocator = _dev->get_allocator();
+
+	const VkPhysicalDeviceMemoryProperties* props;
+	vmaGetMemoryProperties(allocator, &props);
+
+	VmaStats stats;
+	vmaCalculateStats(allocator, &stats);
+
+	/* Sum device local heaps and what we've allocated from them */
+	uint64_t heap_size = 0;
+	uint64_t used = 0;
+	for (uint32_t i = 0; i < props->memoryHeapCount; ++i)
+	{
+		if (props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			heap_size += props->memoryHeaps[i].size;
+			used += stats.memoryHeap[i].usedBytes;
+		}
+	}
+
+	/* Memory not owned by the caches (swapchain, staging, etc) isn't available to them */
+	uint64_t other = used > cache_size ? used - cache_size : 0;
+	uint64_t target = (uint64_t)(heap_size * device_memory_fraction);
+
+	return target > other ? target - other : 1;
+}
+
 void vlk::wait_idle() const
 {
 	/* wait for device to finsih current operations. example usage is at
 	application exit - wait until current ops finish, then do cleanup. */
+
+	/* Uploads still in the staging ring may target resources that are about to be destroyed */
+	_dev->get_staging_ring().finish();
+
+	std::lock_guard<std::mutex> lock(_dev->get_queue_mutex());
 	vkDeviceWaitIdle(_dev->get_handle());
 }
 
@@ -156,7 +192,7 @@ void vlk::create_dbg_callbacks()
 
 void vlk::create_factory()
 {
-	auto factory = new vlk_factory(*_dev);
+	auto factory = new vlk_factory(*_dev, *this);
 	_factory = sptr<vlk_factory>(factory);
 }
 
@@ -255,6 +291,12 @@ void vlk::create_requirement_lists()
 	{
 		LOG_FATAL("Required instance extensions are not available.");
 	}
+
+	/* optional - the descriptor indexing and timeline semaphore device extensions depend on it */
+	if (vlk_util::are_instance_extensions_available({ VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME }))
+	{
+		_required_instance_ext.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
 }
 
 void vlk::destroy_device()
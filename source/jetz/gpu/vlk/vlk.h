@@ -41,6 +41,9 @@ public:
 	Public static variables
 	-----------------------------------------------------*/
 
+	/** Fraction of device local memory the application aims to use. */
+	static float device_memory_fraction;
+
 	/*-----------------------------------------------------
 	Public methods
 	-----------------------------------------------------*/
@@ -53,6 +56,7 @@ public:
 	-----------------------------------------------------*/
 
 	virtual sptr<gpu_factory> get_factory() const override;
+	virtual uint64_t get_memory_budget(uint64_t cache_size) const override;
 	virtual void wait_idle() const override;
 
 	/*-----------------------------------------------------
@@ -7,6 +7,8 @@ INCLUDES
 =============================================================================*/
 
 #include "jetz/gpu/vlk/vlk_buffer.h"
+#include "jetz/gpu/vlk/vlk_gpu.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
 #include "jetz/main/log.h"
 
 /*=============================================================================
@@ -29,7 +31,10 @@ vlk_buffer::vlk_buffer
 	: dev(device),
 	size(size),
 	buffer_usage(buffer_usage),
-	memory_usage(memory_usage)
+	memory_usage(memory_usage),
+	upload_value(0),
+	coherent(true),
+	mapped(NULL)
 {
 	if (memory_usage & VMA_MEMORY_USAGE_GPU_ONLY)
 	{
@@ -46,11 +51,24 @@ vlk_buffer::vlk_buffer
 	VmaAllocationCreateInfo alloc_info = {};
 	alloc_info.usage = memory_usage;
 
-	VkResult result = vmaCreateBuffer(dev.get_allocator(), &info, &alloc_info, &handle, &allocation, NULL);
+	if (memory_usage != VMA_MEMORY_USAGE_GPU_ONLY)
+	{
+		/* Host visible buffers stay mapped so updates are a plain memcpy */
+		alloc_info.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	}
+
+	VmaAllocationInfo allocation_info;
+	VkResult result = vmaCreateBuffer(dev.get_allocator(), &info, &alloc_info, &handle, &allocation, &allocation_info);
 	if (result != VK_SUCCESS)
 	{
 		LOG_FATAL("Failed to create buffer.");
 	}
+
+	mapped = allocation_info.pMappedData;
+
+	VkMemoryPropertyFlags mem_flags;
+	vmaGetMemoryTypeProperties(dev.get_allocator(), allocation_info.memoryType, &mem_flags);
+	coherent = (mem_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
 }
 
 vlk_buffer::~vlk_buffer()
@@ -72,6 +90,28 @@ VkBuffer vlk_buffer::get_handle() const
 	return handle;
 }
 
+void vlk_buffer::flush(VkDeviceSize offset, VkDeviceSize size)
+{
+	if (coherent || mapped == NULL)
+	{
+		return;
+	}
+
+	VkMappedMemoryRange range = get_mapped_range(offset, size);
+	vkFlushMappedMemoryRanges(dev.get_handle(), 1, &range);
+}
+
+void vlk_buffer::invalidate(VkDeviceSize offset, VkDeviceSize size)
+{
+	if (coherent || mapped == NULL)
+	{
+		return;
+	}
+
+	VkMappedMemoryRange range = get_mapped_range(offset, size);
+	vkInvalidateMappedMemoryRanges(dev.get_handle(), 1, &range);
+}
+
 VkDescriptorBufferInfo vlk_buffer::get_buffer_info() const
 {
 	VkDescriptorBufferInfo info = {};
@@ -81,6 +121,23 @@ VkDescriptorBufferInfo vlk_buffer::get_buffer_info() const
 	return info;
 }
 
+VkDeviceSize vlk_buffer::get_memory_size() const
+{
+	VmaAllocationInfo info;
+	vmaGetAllocationInfo(dev.get_allocator(), allocation, &info);
+	return info.size;
+}
+
+void* vlk_buffer::get_mapped() const
+{
+	return mapped;
+}
+
+bool vlk_buffer::is_ready() const
+{
+	return dev.get_staging_ring().is_ready(upload_value);
+}
+
 void vlk_buffer::update(void* data, VkDeviceSize offset, VkDeviceSize size)
 {
 	switch (memory_usage)
@@ -99,52 +156,40 @@ void vlk_buffer::update(void* data, VkDeviceSize offset, VkDeviceSize size)
 PRIVATE METHODS
 =============================================================================*/
 
-void vlk_buffer::update_direct(void* data, VkDeviceSize offset, VkDeviceSize data_size)
+VkMappedMemoryRange vlk_buffer::get_mapped_range(VkDeviceSize offset, VkDeviceSize size) const
 {
-	void* buf;
-	VkResult result = vmaMapMemory(dev.get_allocator(), allocation, &buf);
-	if (result != VK_SUCCESS)
-	{
-		LOG_FATAL("Unable to map Vulkan memory.");
-	}
+	VmaAllocationInfo info;
+	vmaGetAllocationInfo(dev.get_allocator(), allocation, &info);
+
+	/* Ranges must be aligned to the non-coherent atom size of the memory object */
+	VkDeviceSize atom = dev.get_gpu().get_properties().limits.nonCoherentAtomSize;
+	VkDeviceSize start = info.offset + offset;
+	VkDeviceSize end = start + size;
+	start = start / atom * atom;
+	end = (end + atom - 1) / atom * atom;
+
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = info.deviceMemory;
+	range.offset = start;
+
+	/* Rounding up may pass the end of the allocation - use the end of the memory object instead */
+	range.size = end >= info.offset + info.size ? VK_WHOLE_SIZE : end - start;
 
-	buf = (char*)buf + offset;
-	memcpy(buf, data, data_size);
-	vmaUnmapMemory(dev.get_allocator(), allocation);
+	return range;
+}
+
+void vlk_buffer::update_direct(void* data, VkDeviceSize offset, VkDeviceSize data_size)
+{
+	/* The buffer is persistently mapped - no map/unmap per update */
+	memcpy((char*)mapped + offset, data, data_size);
+	flush(offset, data_size);
 }
 
 void vlk_buffer::update_via_staging_buffer(void* data, VkDeviceSize offset, VkDeviceSize data_size)
 {
-	/*
-	Create staging buffer
-	*/
-	vlk_buffer staging_buffer = vlk_buffer(
-		dev,
-		data_size,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY);
-
-	/*
-	Load data to staging buffer
-	*/
-	staging_buffer.update(data, 0, data_size);
-
-	/*
-	Copy staging -> GPU
-	*/
-	VkCommandBuffer cmd_buf = dev.begin_one_time_cmd_buf();
-
-	VkBufferCopy copy_region = {};
-	copy_region.size = data_size;
-	copy_region.dstOffset = offset;
-	copy_region.srcOffset = 0;
-	vkCmdCopyBuffer(cmd_buf, staging_buffer.handle, handle, 1, &copy_region);
-
-	dev.end_one_time_cmd_buf(cmd_buf);
-
-	/*
-	Free staging buffer - done in destructor
-	*/
+	/* Copied through the staging ring and submitted with the frame's uploads */
+	upload_value = dev.get_staging_ring().copy_to_buffer(handle, offset, data, data_size);
 }
 
 }   /* namespace jetz */
@@ -48,11 +48,40 @@ public:
 	*/
 	VkBuffer get_handle() const;
 
+	/**
+	Flushes writes to a mapped range so the device can see them. Does nothing
+	if the memory is host coherent.
+	*/
+	void flush(VkDeviceSize offset, VkDeviceSize size);
+
+	/**
+	Invalidates a mapped range so the host sees writes made by the device.
+	Does nothing if the memory is host coherent.
+	*/
+	void invalidate(VkDeviceSize offset, VkDeviceSize size);
+
 	/**
 	Builds a VkDescriptorBufferInfo struct for this buffer.
 	*/
 	VkDescriptorBufferInfo get_buffer_info() const;
 
+	/**
+	Gets the size of the buffer's memory allocation in bytes.
+	*/
+	VkDeviceSize get_memory_size() const;
+
+	/**
+	Gets the persistently mapped memory of a host visible buffer, or NULL for
+	VMA_MEMORY_USAGE_GPU_ONLY buffers. Call flush after writing to it.
+	*/
+	void* get_mapped() const;
+
+	/**
+	Checks if the last update has finished uploading and the buffer can be
+	used by the graphics queue.
+	*/
+	bool is_ready() const;
+
 	/**
 	Updates the data in the buffer.
 	*/
@@ -64,6 +93,9 @@ private:
 	Private methods
 	-----------------------------------------------------*/
 
+	/** Gets the atom aligned memory range of a mapped range, for flushing and invalidating. */
+	VkMappedMemoryRange get_mapped_range(VkDeviceSize offset, VkDeviceSize size) const;
+
 	void update_direct
 		(
 		void*					data,
@@ -83,11 +115,14 @@ private:
 	-----------------------------------------------------*/
 
 	VmaAllocation					allocation;
+	bool							coherent;		/* mapped memory doesn't need flushing */
 	VkBufferUsageFlags				buffer_usage;	/* how the buffer is used */
 	vlk_device&						dev;			/* logical device */
 	VkBuffer						handle;			/* Vulkan buffer handle */
+	void*							mapped;			/* persistently mapped memory, NULL if not host visible */
 	VmaMemoryUsage					memory_usage;	/* how the underlying memory is used */
 	VkDeviceSize					size;			/* the size of the buffer */
+	uint64_t						upload_value;	/* staging ring value of the last upload */
 };
 
 }   /* namespace jetz */
@@ -6,9 +6,17 @@ vlk_device.cpp
 INCLUDES
 =============================================================================*/
 
+#include "jetz/gpu/gpu.h"
 #include "jetz/gpu/vlk/vlk_device.h"
 #include "jetz/gpu/vlk/vlk_texture.h"
+#include "jetz/gpu/vlk/vlk_material_buffer.h"
+#include "jetz/gpu/vlk/vlk_mesh_arena.h"
+#include "jetz/gpu/vlk/vlk_scratch_allocator.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
+#include "jetz/gpu/vlk/vlk_texture_streamer.h"
+#include "jetz/gpu/vlk/vlk_util.h"
 #include "jetz/gpu/vlk/vlk_window.h"
+#include "jetz/gpu/vlk/descriptors/vlk_bindless_textures.h"
 #include "jetz/gpu/vlk/pipelines/vlk_pipeline_cache.h"
 #include "jetz/main/common.h"
 #include "jetz/main/filesystem.h"
@@ -50,11 +58,22 @@ vlk_device::vlk_device
 {
 	gfx_family_idx = -1;
 	present_family_idx = -1;
+	transfer_family_idx = -1;
+	transfer_queue = VK_NULL_HANDLE;
+	_bindless = false;
+	_bindless_textures = nullptr;
+	_timeline_semaphores = false;
 
 	create_logical_device(req_dev_ext, req_inst_layers);
 	create_command_pool();
 	create_allocator();
+	create_staging_ring();
+	create_texture_streamer();
+	create_mesh_arena();
+	create_scratch_allocator();
+	create_material_buffer();
 	create_texture_sampler();
+	create_bindless_textures();
 	create_layouts();
 	create_render_pass();
 	create_picker_render_pass();
@@ -71,7 +90,13 @@ vlk_device::~vlk_device()
 	destroy_picker_render_pass();
 	destroy_render_pass();
 	destroy_layouts();
+	destroy_bindless_textures();
 	destroy_texture_sampler();
+	destroy_material_buffer();
+	destroy_scratch_allocator();
+	destroy_mesh_arena();
+	destroy_texture_streamer();
+	destroy_staging_ring();
 	destroy_allocator();
 	destroy_command_pool();
 	destroy_logical_device();
@@ -101,45 +126,6 @@ VkCommandBuffer vlk_device::begin_one_time_cmd_buf() const
 	return cmd_buf;
 }
 
-void vlk_device::copy_buffer_to_img_now
-	(
-	VkBuffer	buffer, 
-	VkImage		image, 
-	uint32_t	width, 
-	uint32_t	height
-	) const
-{
-	VkCommandBuffer cmd_buf = begin_one_time_cmd_buf();
-
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-
-	region.imageOffset.x = 0;
-	region.imageOffset.y = 0;
-	region.imageOffset.z = 0;
-	region.imageExtent.width = width;
-	region.imageExtent.height = height;
-	region.imageExtent.depth = 1;
-
-	vkCmdCopyBufferToImage(
-		cmd_buf,
-		buffer,
-		image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
-	);
-
-	end_one_time_cmd_buf(cmd_buf);
-}
-
 VkShaderModule vlk_device::create_shader(const std::string& file) const
 {
 	std::vector<char> code = filesystem::read_all(file);
@@ -173,14 +159,19 @@ void vlk_device::end_one_time_cmd_buf(VkCommandBuffer cmd_buf) const
 	submit_info.commandBufferCount = 1;
 	submit_info.pCommandBuffers = &cmd_buf;
 
-	vkQueueSubmit(gfx_queue, 1, &submit_info, VK_NULL_HANDLE);
-	vkQueueWaitIdle(gfx_queue);
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		vkQueueSubmit(gfx_queue, 1, &submit_info, VK_NULL_HANDLE);
+		vkQueueWaitIdle(gfx_queue);
+	}
 
 	vkFreeCommandBuffers(handle, command_pool, 1, &cmd_buf);
 }
 
 VmaAllocator vlk_device::get_allocator() const { return allocator; }
 
+vlk_bindless_textures& vlk_device::get_bindless_textures() const { return *_bindless_textures; }
+
 wptr<vlk_texture> vlk_device::get_default_texture() const { return _default_texture; }
 
 vlk_frame& vlk_device::get_frame(const gpu_frame& frame) { return _window->get_frame(frame); }
@@ -201,19 +192,39 @@ int vlk_device::get_gfx_family_idx() const { return gfx_family_idx; }
 
 VkQueue vlk_device::get_gfx_queue() const { return gfx_queue; }
 
+vlk_material_buffer& vlk_device::get_material_buffer() const { return *_material_buffer; }
+
 vlk_material_layout& vlk_device::get_material_layout() const { return *material_layout; }
 
+vlk_mesh_arena& vlk_device::get_mesh_arena() const { return *_mesh_arena; }
+
 vlk_per_view_layout& vlk_device::get_per_view_layout() const { return *per_view_layout; }
 
 int vlk_device::get_present_family_idx() const { return present_family_idx; }
 
 VkQueue vlk_device::get_present_queue() const { return present_queue; }
 
+std::mutex& vlk_device::get_queue_mutex() const { return _queue_mutex; }
+
+vlk_scratch_allocator& vlk_device::get_scratch_allocator() const { return *_scratch_allocator; }
+
+vlk_staging_ring& vlk_device::get_staging_ring() const { return *_staging_ring; }
+
 VkSampler vlk_device::get_texture_sampler() const { return texture_sampler; }
 
+int vlk_device::get_transfer_family_idx() const { return transfer_family_idx; }
+
+VkQueue vlk_device::get_transfer_queue() const { return transfer_queue; }
+
+bool vlk_device::has_bindless_textures() const { return _bindless; }
+
+bool vlk_device::has_timeline_semaphores() const { return _timeline_semaphores; }
+
+vlk_texture_streamer& vlk_device::get_texture_streamer() const { return *_texture_streamer; }
+
 wptr<vlk_window> vlk_device::get_window() const { return _window; }
 
-void vlk_device::transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout) const
+void vlk_device::transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels) const
 {
 	VkCommandBuffer cmd_buf = begin_one_time_cmd_buf();
 
@@ -242,7 +253,7 @@ void vlk_device::transition_image_layout(VkImage image, VkFormat format, VkImage
 	}
 
 	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.levelCount = mip_levels;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 
@@ -346,6 +357,14 @@ void vlk_device::create_allocator()
 	}
 }
 
+void vlk_device::create_bindless_textures()
+{
+	if (_bindless)
+	{
+		_bindless_textures = new vlk_bindless_textures(*this);
+	}
+}
+
 void vlk_device::create_command_pool()
 {
 	VkCommandPoolCreateInfo pool_info = {};
@@ -377,6 +396,9 @@ void vlk_device::create_default_texture()
 
 	auto t = new vlk_texture(*this, info);
 	_default_texture = sptr<vlk_texture>(t);
+
+	/* Stands in for textures that aren't loaded, so it must always be usable */
+	t->wait_upload();
 }
 
 void vlk_device::create_layouts()
@@ -423,6 +445,43 @@ void vlk_device::create_logical_device
 		used_queue_families.push_back((uint32_t)present_family_idx);
 	}
 
+	/*
+	Uploads use a separate transfer queue when there is one. Synchronizing it
+	with the graphics queue needs timeline semaphores, otherwise uploads stay
+	on the graphics queue.
+	*/
+	std::vector<const char*> dev_ext = req_dev_ext;
+	_timeline_semaphores = vlk_util::are_device_extensions_available({ VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME }, gpu);
+
+	if (_timeline_semaphores)
+	{
+		dev_ext.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+		for (auto family : gpu.queue_family_indices.transfer_families)
+		{
+			if (family != (uint32_t)gfx_family_idx && family != (uint32_t)present_family_idx)
+			{
+				transfer_family_idx = (int)family;
+				used_queue_families.push_back(family);
+				break;
+			}
+		}
+	}
+
+	/*
+	Material textures are sampled from one global array when descriptor
+	indexing is available. The features used are required by the extension.
+	*/
+	_bindless = jetz::gpu::bindless_textures
+		&& gpu.supported_features.shaderSampledImageArrayDynamicIndexing
+		&& vlk_util::are_device_extensions_available({ VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME }, gpu);
+
+	if (_bindless)
+	{
+		dev_ext.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		dev_ext.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	}
+
 	float queuePriority = 1.0f;
 
 	/* create multiple queues if needed based on QF properties */
@@ -441,6 +500,7 @@ void vlk_device::create_logical_device
 	*/
 	VkPhysicalDeviceFeatures device_features = {};
 	device_features.samplerAnisotropy = gpu.supported_features.samplerAnisotropy;
+	device_features.shaderSampledImageArrayDynamicIndexing = _bindless ? VK_TRUE : VK_FALSE;
 
 	/*
 	* Create the logical device
@@ -455,9 +515,33 @@ void vlk_device::create_logical_device
 	/* device features */
 	create_info.pEnabledFeatures = &device_features;
 
+	/* Required by the extension, so it doesn't need to be queried */
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {};
+	timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timeline_features.timelineSemaphore = VK_TRUE;
+
+	if (_timeline_semaphores)
+	{
+		timeline_features.pNext = (void*)create_info.pNext;
+		create_info.pNext = &timeline_features;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+	indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexing_features.runtimeDescriptorArray = VK_TRUE;
+	indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+	indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+	if (_bindless)
+	{
+		indexing_features.pNext = (void*)create_info.pNext;
+		create_info.pNext = &indexing_features;
+	}
+
 	/* extensions */
-	create_info.enabledExtensionCount = (uint32_t)req_dev_ext.size();
-	create_info.ppEnabledExtensionNames = req_dev_ext.data();
+	create_info.enabledExtensionCount = (uint32_t)dev_ext.size();
+	create_info.ppEnabledExtensionNames = dev_ext.data();
 
 	/* layers */
 	create_info.enabledLayerCount = (uint32_t)req_inst_layers.size();
@@ -474,6 +558,12 @@ void vlk_device::create_logical_device
 	*/
 	vkGetDeviceQueue(handle, gfx_family_idx, 0, &gfx_queue);
 	vkGetDeviceQueue(handle, present_family_idx, 0, &present_queue);
+
+	if (transfer_family_idx >= 0)
+	{
+		vkGetDeviceQueue(handle, transfer_family_idx, 0, &transfer_queue);
+		LOG_INFO_FMT("Using queue family {0} for uploads.", transfer_family_idx);
+	}
 }
 
 void vlk_device::create_picker_render_pass()
@@ -671,7 +761,7 @@ void vlk_device::create_texture_sampler()
 	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	sampler_info.mipLodBias = 0.0f;
 	sampler_info.minLod = 0.0f;
-	sampler_info.maxLod = 0.0f;
+	sampler_info.maxLod = VK_LOD_CLAMP_NONE;	/* views only cover resident mips */
 
 	if (vkCreateSampler(handle, &sampler_info, NULL, &texture_sampler) != VK_SUCCESS) 
 	{
@@ -679,6 +769,31 @@ void vlk_device::create_texture_sampler()
 	}
 }
 
+void vlk_device::create_material_buffer()
+{
+	_material_buffer = new vlk_material_buffer(*this);
+}
+
+void vlk_device::create_mesh_arena()
+{
+	_mesh_arena = new vlk_mesh_arena(*this);
+}
+
+void vlk_device::create_scratch_allocator()
+{
+	_scratch_allocator = new vlk_scratch_allocator(*this);
+}
+
+void vlk_device::create_staging_ring()
+{
+	_staging_ring = new vlk_staging_ring(*this);
+}
+
+void vlk_device::create_texture_streamer()
+{
+	_texture_streamer = new vlk_texture_streamer(*this);
+}
+
 void vlk_device::create_window()
 {
 	/* Must check to make sure surface supports presentation */
@@ -700,6 +815,12 @@ void vlk_device::destroy_allocator()
 	vmaDestroyAllocator(allocator);
 }
 
+void vlk_device::destroy_bindless_textures()
+{
+	delete _bindless_textures;
+	_bindless_textures = nullptr;
+}
+
 void vlk_device::destroy_command_pool()
 {
 	vkDestroyCommandPool(handle, command_pool, NULL);
@@ -721,6 +842,19 @@ void vlk_device::destroy_logical_device()
 	vkDestroyDevice(handle, NULL);
 }
 
+void vlk_device::destroy_material_buffer()
+{
+	delete _material_buffer;
+	_material_buffer = nullptr;
+}
+
+void vlk_device::destroy_mesh_arena()
+{
+	/* Models have been unloaded, so all ranges are retired */
+	delete _mesh_arena;
+	_mesh_arena = nullptr;
+}
+
 void vlk_device::destroy_picker_render_pass()
 {
 	vkDestroyRenderPass(handle, picker_render_pass, NULL);
@@ -741,6 +875,26 @@ void vlk_device::destroy_texture_sampler()
 	vkDestroySampler(handle, texture_sampler, NULL);
 }
 
+void vlk_device::destroy_scratch_allocator()
+{
+	delete _scratch_allocator;
+	_scratch_allocator = nullptr;
+}
+
+void vlk_device::destroy_staging_ring()
+{
+	/* Waits for in-flight uploads */
+	delete _staging_ring;
+	_staging_ring = nullptr;
+}
+
+void vlk_device::destroy_texture_streamer()
+{
+	/* Frees any retired texture images. Every texture is gone by now. */
+	delete _texture_streamer;
+	_texture_streamer = nullptr;
+}
+
 void vlk_device::destroy_window()
 {
 	_window.reset();
@@ -8,6 +8,7 @@ vlk_device.h
 INCLUDES
 =============================================================================*/
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
@@ -30,9 +31,15 @@ TYPES
 
 class gpu_frame;
 class vlk;
+class vlk_bindless_textures;
 class vlk_frame;
+class vlk_material_buffer;
+class vlk_mesh_arena;
 class vlk_pipeline_cache;
+class vlk_scratch_allocator;
+class vlk_staging_ring;
 class vlk_texture;
+class vlk_texture_streamer;
 class vlk_window;
 class window;
 
@@ -64,17 +71,6 @@ public:
 	*/
 	VkCommandBuffer begin_one_time_cmd_buf() const;
 
-	/**
-	Copies a buffer to an image.
-	*/
-	void copy_buffer_to_img_now
-	(
-		VkBuffer				buffer,
-		VkImage					image,
-		uint32_t				width,
-		uint32_t				height
-	) const;
-
 	/**
 	Creates a shader module.
 	*/
@@ -93,6 +89,9 @@ public:
 	/* Gets the VMA allocator handle. */
 	VmaAllocator get_allocator() const;
 
+	/* Gets the global texture array. Only valid if has_bindless_textures(). */
+	vlk_bindless_textures& get_bindless_textures() const;
+
 	/* Gets the placeholder texture. */
 	wptr<vlk_texture> get_default_texture() const;
 
@@ -119,11 +118,37 @@ public:
 
 	int									get_gfx_family_idx() const;
 	VkQueue								get_gfx_queue() const;
+	vlk_material_buffer&				get_material_buffer() const;
 	vlk_material_layout&				get_material_layout() const;
+	vlk_mesh_arena&						get_mesh_arena() const;
 	vlk_per_view_layout&				get_per_view_layout() const;
 	int									get_present_family_idx() const;
 	VkQueue								get_present_queue() const;
+
+	/**
+	Gets the lock for submitting to and presenting on the device's queues.
+	Uploads submit from loader threads, so every vkQueueSubmit,
+	vkQueuePresentKHR, and wait idle call holds it.
+	*/
+	std::mutex&							get_queue_mutex() const;
+
+	vlk_scratch_allocator&				get_scratch_allocator() const;
+	vlk_staging_ring&					get_staging_ring() const;
 	VkSampler							get_texture_sampler() const;
+	vlk_texture_streamer&				get_texture_streamer() const;
+
+	/** Gets the queue family used for uploads, or -1 if uploads use the graphics queue. */
+	int									get_transfer_family_idx() const;
+
+	/** Gets the queue used for uploads, or VK_NULL_HANDLE if uploads use the graphics queue. */
+	VkQueue								get_transfer_queue() const;
+
+	/** Checks if textures are sampled through the global texture array (VK_EXT_descriptor_indexing). */
+	bool								has_bindless_textures() const;
+
+	/** Checks if VK_KHR_timeline_semaphore is enabled. */
+	bool								has_timeline_semaphores() const;
+
 	wptr<vlk_window>					get_window() const;
 
 	void transition_image_layout
@@ -131,7 +156,8 @@ public:
 		VkImage							image,
 		VkFormat						format,
 		VkImageLayout					old_layout,
-		VkImageLayout					new_layout
+		VkImageLayout					new_layout,
+		uint32_t						mip_levels = 1
 		) const;
 
 private:
@@ -143,6 +169,9 @@ private:
 	/** Creates a memory allocator using the Vulkan Memory Allocation library. */
 	void create_allocator();
 
+	/** Creates the global texture array if descriptor indexing is enabled. */
+	void create_bindless_textures();
+
 	/** Creates the command pool. */
 	void create_command_pool();
 	void create_default_texture();
@@ -157,22 +186,36 @@ private:
 		const std::vector<const char*>&		req_inst_layers		/* required instance layers */
 		);
 
+	/** Creates the storage buffer holding every material's parameters. */
+	void create_material_buffer();
+
+	void create_mesh_arena();
+
 	/** Creates render pass for the screen picker. Used for determining where the mouse clicked in the editor. */
 	void create_picker_render_pass();
 	void create_pipeline_cache();
 	void create_render_pass();
+	void create_scratch_allocator();
+	void create_staging_ring();
 	void create_texture_sampler();
+	void create_texture_streamer();
 	void create_window();
 
 	void destroy_allocator();
+	void destroy_bindless_textures();
 	void destroy_command_pool();
 	void destroy_default_texture();
 	void destroy_layouts();
 	void destroy_logical_device();
+	void destroy_material_buffer();
+	void destroy_mesh_arena();
 	void destroy_picker_render_pass();
 	void destroy_pipeline_cache();
 	void destroy_render_pass();
+	void destroy_scratch_allocator();
+	void destroy_staging_ring();
 	void destroy_texture_sampler();
+	void destroy_texture_streamer();
 	void destroy_window();
 
 	/*-----------------------------------------------------
@@ -190,12 +233,18 @@ private:
 	Create/destroy
 	*/
 	VmaAllocator					allocator;
+	vlk_bindless_textures*			_bindless_textures;		/* Texture array indexed by shaders, null if unsupported */
 	VkCommandPool					command_pool;
 	sptr<vlk_texture>				_default_texture;		/* default texture */
 	VkDevice						handle;					/* Handle for the logical device */
+	vlk_material_buffer*			_material_buffer;		/* Parameters of all materials */
+	vlk_mesh_arena*					_mesh_arena;			/* Vertex and index buffers shared by all models */
 	sptr<vlk_pipeline_cache>		_pipeline_cache;
+	vlk_scratch_allocator*			_scratch_allocator;		/* Per-frame transient data */
+	vlk_staging_ring*				_staging_ring;
 	VkSurfaceKHR					_surface;
 	VkSampler						texture_sampler;
+	vlk_texture_streamer*			_texture_streamer;
 	std::vector<uint32_t>			used_queue_families;	/* Unique set of queue family indices used by this device */
 	sptr<vlk_window>				_window;
 
@@ -212,6 +261,11 @@ private:
 	VkQueue							gfx_queue;
 	int								present_family_idx;
 	VkQueue							present_queue;
+	int								transfer_family_idx;	/* -1 if there's no separate transfer queue */
+	VkQueue							transfer_queue;
+	mutable std::mutex				_queue_mutex;
+	bool							_bindless;
+	bool							_timeline_semaphores;
 };
 
 }   /* namespace jetz */
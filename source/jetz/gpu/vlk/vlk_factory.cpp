@@ -8,6 +8,7 @@ INCLUDES
 
 #include "jetz/gpu/vlk/vlk_factory.h"
 #include "jetz/gpu/vlk/vlk_model.h"
+#include "jetz/gpu/vlk/vlk_texture.h"
 #include "jetz/main/log.h"
 
 /*=============================================================================
@@ -22,10 +23,12 @@ CONSTRUCTORS
 
 vlk_factory::vlk_factory
 	(
-	vlk_device&					device
+	vlk_device&					device,
+	gpu&						gpu
 	)
 	: 
-	_device(device)
+	_device(device),
+	_gpu(gpu)
 {
 }
 
@@ -37,14 +40,31 @@ vlk_factory::~vlk_factory()
 PUBLIC METHODS
 =============================================================================*/
 
-uptr<gpu_model> vlk_factory::create_model(uptr<tinygltf::Model> gltf)
+uptr<gpu_model> vlk_factory::create_model(uptr<gpu_gltf> gltf)
 {
-	auto model_ptr = new vlk_model(_device, std::move(gltf), _device.get_pipeline_cache());
+	auto model_ptr = new vlk_model(_device, _gpu, std::move(gltf), _device.get_pipeline_cache());
 	auto model = uptr<vlk_model>(model_ptr);
 
 	return std::move(model);
 }
 
+uptr<gpu_texture> vlk_factory::create_texture
+	(
+	const void*					data,
+	size_t						size,
+	uint32_t					width,
+	uint32_t					height
+	)
+{
+	vlk_texture_create_info create_info = {};
+	create_info.data = (void*)data;
+	create_info.size = size;
+	create_info.width = width;
+	create_info.height = height;
+
+	return uptr<gpu_texture>(new vlk_texture(_device, create_info));
+}
+
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
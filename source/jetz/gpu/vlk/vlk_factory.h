@@ -21,6 +21,8 @@ NAMESPACE
 =============================================================================*/
 
 namespace jetz {
+
+class gpu;
 	
 /*=============================================================================
 CLASS
@@ -32,7 +34,8 @@ public:
 
 	vlk_factory
 		(
-		vlk_device&					device
+		vlk_device&					device,
+		gpu&						gpu
 		);
 	virtual ~vlk_factory();
 
@@ -40,7 +43,15 @@ public:
 	Public Methods
 	-----------------------------------------------------*/
 
-	uptr<gpu_model> create_model(uptr<tinygltf::Model> gltf) override;
+	uptr<gpu_model> create_model(uptr<gpu_gltf> gltf) override;
+
+	uptr<gpu_texture> create_texture
+		(
+		const void*					data,
+		size_t						size,
+		uint32_t					width,
+		uint32_t					height
+		) override;
 
 private:
 
@@ -49,6 +60,7 @@ private:
 	-----------------------------------------------------*/
 
 	vlk_device&					_device;
+	gpu&						_gpu;
 
 	/*-----------------------------------------------------
 	Private Methods
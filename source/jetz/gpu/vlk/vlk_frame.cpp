@@ -24,7 +24,16 @@ vlk_frame::vlk_frame(uint8_t frame_idx)
 	cmd_buf(VK_NULL_HANDLE),
 	picker_cmd_buf(VK_NULL_HANDLE),
 	image_idx(0),
-	delta_time(0.0)
+	delta_time(0.0),
+	view(1.0f),
+	proj(1.0f),
+	camera_pos(0.0f),
+	extent({ 0, 0 }),
+	frustum(),
+	_bound_vertex_buffer(VK_NULL_HANDLE),
+	_bound_index_buffer(VK_NULL_HANDLE),
+	_bound_index_type(VK_INDEX_TYPE_UINT16),
+	_bound_material_set(VK_NULL_HANDLE)
 {
 }
 
@@ -46,6 +55,48 @@ uint8_t vlk_frame::get_frame_idx() const
 	return _gpu_frame.get_frame_idx();
 }
 
+void vlk_frame::bind_vertex_buffer(VkBuffer buffer)
+{
+	if (buffer == _bound_vertex_buffer)
+	{
+		return;
+	}
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmd_buf, 0, 1, &buffer, &offset);
+	_bound_vertex_buffer = buffer;
+}
+
+void vlk_frame::bind_index_buffer(VkBuffer buffer, VkIndexType index_type)
+{
+	if (buffer == _bound_index_buffer && index_type == _bound_index_type)
+	{
+		return;
+	}
+
+	vkCmdBindIndexBuffer(cmd_buf, buffer, 0, index_type);
+	_bound_index_buffer = buffer;
+	_bound_index_type = index_type;
+}
+
+void vlk_frame::bind_material_set(VkPipelineLayout pipeline_layout, uint32_t set_num, VkDescriptorSet set)
+{
+	if (set == _bound_material_set)
+	{
+		return;
+	}
+
+	vkCmdBindDescriptorSets(cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set_num, 1, &set, 0, NULL);
+	_bound_material_set = set;
+}
+
+void vlk_frame::reset_bindings()
+{
+	_bound_vertex_buffer = VK_NULL_HANDLE;
+	_bound_index_buffer = VK_NULL_HANDLE;
+	_bound_material_set = VK_NULL_HANDLE;
+}
+
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
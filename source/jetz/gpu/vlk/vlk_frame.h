@@ -8,6 +8,7 @@ vlk_frame.h
 INCLUDES
 =============================================================================*/
 
+#include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 
 #include "jetz/gpu/gpu_frame.h"
@@ -41,6 +42,30 @@ public:
 	gpu_frame&						get_gpu_frame();
 	uint8_t							get_frame_idx() const;
 
+	/**
+	Binds a vertex buffer at offset 0 to the frame's command buffer, unless
+	it is already bound.
+	*/
+	void							bind_vertex_buffer(VkBuffer buffer);
+
+	/**
+	Binds an index buffer at offset 0 to the frame's command buffer, unless
+	it is already bound with the same index type.
+	*/
+	void							bind_index_buffer(VkBuffer buffer, VkIndexType index_type);
+
+	/**
+	Binds the material buffer's descriptor set to the frame's command buffer,
+	unless it is already bound.
+	*/
+	void							bind_material_set(VkPipelineLayout pipeline_layout, uint32_t set_num, VkDescriptorSet set);
+
+	/**
+	Forgets the bound vertex and index buffers and material set. Call when the command buffer
+	is begun and after recording binds without the methods above.
+	*/
+	void							reset_bindings();
+
 	/*-----------------------------------------------------
 	Public variables
 	-----------------------------------------------------*/
@@ -50,6 +75,15 @@ public:
 	uint32_t						image_idx;
 	double							delta_time;
 
+	/* Per-view data, set when the per-view set is updated */
+	glm::mat4						view;
+	glm::mat4						proj;
+	glm::vec3						camera_pos;
+	VkExtent2D						extent;
+
+	/* World space frustum planes (left, right, bottom, top, near, far), xyz pointing inward */
+	glm::vec4						frustum[6];
+
 private: 
 
 	/*-----------------------------------------------------
@@ -57,6 +91,12 @@ private:
 	-----------------------------------------------------*/
 
 	gpu_frame						_gpu_frame;
+
+	/* Buffers and sets bound to cmd_buf */
+	VkBuffer						_bound_vertex_buffer;
+	VkBuffer						_bound_index_buffer;
+	VkIndexType						_bound_index_type;
+	VkDescriptorSet					_bound_material_set;
 };
 
 }   /* namespace jetz */
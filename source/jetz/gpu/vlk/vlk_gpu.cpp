@@ -197,6 +197,42 @@ vlk_gpu::vlk_gpu
 		}
 	}
 
+	/*
+	Texture uploads copy bands of rows at any offset and small mip levels of
+	any size, which needs an image transfer granularity of one texel. Uploads
+	stay on the graphics queue if no family has it.
+	*/
+	auto texel_granularity = [&](uint32_t i) {
+		VkExtent3D granularity = queue_family_props[i].minImageTransferGranularity;
+		return granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+	};
+
+	/* Transfer-only families are usually DMA engines, so prefer them over async compute families */
+	for (uint32_t i = 0; i < queue_family_props.size(); ++i)
+	{
+		VkQueueFlags flags = queue_family_props[i].queueFlags;
+		if (queue_family_props[i].queueCount > 0
+			&& texel_granularity(i)
+			&& (flags & VK_QUEUE_TRANSFER_BIT)
+			&& !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			queue_family_indices.transfer_families.push_back(i);
+		}
+	}
+
+	for (uint32_t i = 0; i < queue_family_props.size(); ++i)
+	{
+		VkQueueFlags flags = queue_family_props[i].queueFlags;
+		if (queue_family_props[i].queueCount > 0
+			&& texel_granularity(i)
+			&& (flags & VK_QUEUE_COMPUTE_BIT)
+			&& !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			/* Compute queues support transfers even if the bit isn't reported */
+			queue_family_indices.transfer_families.push_back(i);
+		}
+	}
+
 	/*-----------------------------------------------------
 
 	Memory properties
@@ -283,6 +319,11 @@ VkPhysicalDevice vlk_gpu::get_handle() const
 	return handle;
 }
 
+const VkPhysicalDeviceProperties& vlk_gpu::get_properties() const
+{
+	return device_properties;
+}
+
 VkResult vlk_gpu::query_surface_capabilties
 	(
 	const VkSurfaceKHR			surface,
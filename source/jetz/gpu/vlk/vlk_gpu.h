@@ -28,6 +28,7 @@ struct vlk_gpu_qfi
 {
 	std::vector<uint32_t>			graphics_families;
 	std::vector<uint32_t>			present_families;
+	std::vector<uint32_t>			transfer_families;	/* Non-graphics families that can transfer with texel granularity, dedicated transfer families first */
 };
 
 /**
@@ -78,6 +79,11 @@ public:
 	*/
 	VkPhysicalDevice get_handle() const;
 
+	/**
+	Gets the physical device properties, including the device limits.
+	*/
+	const VkPhysicalDeviceProperties& get_properties() const;
+
 	/**
 	Query device for current surface capabilities. Some of the capabilties don't
 	change, but the surface extent does. This is just a wrapper around the 
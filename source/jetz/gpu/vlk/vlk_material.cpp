@@ -6,9 +6,15 @@ vlk_material.cpp
 INCLUDES
 =============================================================================*/
 
+#include <cstddef>
+
 #include "jetz/gpu/gpu.h"
 #include "jetz/gpu/vlk/vlk_material.h"
+#include "jetz/gpu/vlk/vlk_material_buffer.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
+#include "jetz/gpu/vlk/descriptors/vlk_bindless_textures.h"
 #include "jetz/gpu/vlk/descriptors/vlk_material_layout.h"
+#include "jetz/gpu/vlk/pipelines/vlk_gltf_pipeline.h"
 #include "jetz/main/log.h"
 
 /*=============================================================================
@@ -32,7 +38,9 @@ vlk_material::vlk_material
 	_emissive_factor(0.0f, 0.0f, 0.0f),
 	_metallic_factor(1.0f),
 	_roughness_factor(1.0f),
-	_default_texture(device.get_default_texture())
+	_default_texture(device.get_default_texture()),
+	_material_index(0),
+	_upload_value(0)
 {
 	_emissive_factor = create_info.emissive_factor;
 	_emissive_texture = create_info.emissive_texture;
@@ -43,15 +51,23 @@ vlk_material::vlk_material
 	_metallic_roughness_texture = create_info.metallic_roughness_texture;
 	_roughness_factor = create_info.roughness_factor;
 
-	/* Create the UBOs and descriptor set and update them with the material properties/textures */
-	create_buffers();
+	/* Upload the material properties to the material buffer */
+	create_data();
+
+	/* Bindless textures are indexed with push constants - no set needed */
+	if (_device.has_bindless_textures())
+	{
+		return;
+	}
+
+	/* Create the descriptor sets and update them with the material textures */
 	create_sets();
 }
 
 vlk_material::~vlk_material()
 {
 	destroy_sets();
-	destroy_buffers();
+	destroy_data();
 }
 
 /*=============================================================================
@@ -60,45 +76,80 @@ PUBLIC METHODS
 
 void vlk_material::bind
 	(
-	const vlk_frame&			frame,
+	vlk_frame&					frame,
 	VkPipelineLayout			pipeline_layout
 	) const
 {
+	/*
+	Textures still uploading draw with their previous image, or the default
+	texture if they have none, so recording never waits on a texture upload.
+	The texture streamer swaps in new images at the start of a frame.
+	*/
+
+	/* All materials share one buffer, so it's only bound when the frame doesn't have it bound yet */
+	_device.get_staging_ring().wait(_upload_value);
+	_device.get_material_buffer().bind(frame, pipeline_layout);
+	push_constants(frame, pipeline_layout);
+
+	if (_device.has_bindless_textures())
+	{
+		return;
+	}
+
+	/* One set per frame in flight, so a set is never rewritten while a pending frame uses it */
+	uint8_t frame_idx = frame.get_frame_idx();
+
+	/* Rewrite the set if a texture changed since it was written */
+	uint32_t version = get_texture_version();
+	if (_set_versions[frame_idx] != version)
+	{
+		write_set(frame_idx);
+		_set_versions[frame_idx] = version;
+	}
+
 	/* Set num is specified in the shader */
 	uint32_t set_num = 1;
-	vkCmdBindDescriptorSets(frame.cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set_num, 1, &_sets[frame.image_idx], 0, NULL);
+	vkCmdBindDescriptorSets(frame.cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set_num, 1, &_sets[frame_idx], 0, NULL);
+}
+
+void vlk_material::request_mips(float uv_per_pixel) const
+{
+	const wptr<vlk_texture>* textures[] = { &_base_color_texture, &_emissive_texture, &_metallic_roughness_texture, &_normal_texture, &_occlusion_texture };
+	for (auto tex : textures)
+	{
+		auto t = tex->lock();
+		if (t)
+		{
+			t->request_mip(uv_per_pixel);
+		}
+	}
+}
+
+uint64_t vlk_material::get_memory_size() const
+{
+	/* Textures are owned (and counted) by whoever loaded them */
+	return sizeof(vlk_material_data);
 }
 
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
 
-void vlk_material::create_buffers()
+void vlk_material::create_data()
 {
-	VkDeviceSize buffer_size = sizeof(vlk_material_ubo);
-	_buffers.clear();
-
-	/* Setup data to send to GPU */
-	vlk_material_ubo ubo = {};
-	ubo.base_color_factor = _base_color_factor;
-	ubo.emissive_factor = _emissive_factor;
-	ubo.metallic_factor = _metallic_factor;
-	ubo.roughness_factor = _roughness_factor;
-	ubo.hasBaseColorTexture = !_base_color_texture.expired();
-	ubo.hasEmissiveTexture = !_emissive_texture.expired();
-	ubo.hasMetallicRoughnessTexture = !_metallic_roughness_texture.expired();
-	ubo.hasNormalTexture = !_normal_texture.expired();
-	ubo.hasOcclusionTexture = !_occlusion_texture.expired();
-
-	/* Create a UBO for all frames */
-	for (uint8_t i = 0; i < gpu::num_frame_buf; ++i)
-	{
-		auto buffer = new vlk_buffer(_device, buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		_buffers.push_back(uptr<vlk_buffer>(buffer));
-
-		/* Populate the buffer on the GPU */
-		buffer->update((void*)&ubo, 0, buffer_size);
-	}
+	vlk_material_data data = {};
+	data.base_color_factor = _base_color_factor;
+	data.emissive_factor = _emissive_factor;
+	data.metallic_factor = _metallic_factor;
+	data.roughness_factor = _roughness_factor;
+	data.texture_flags |= _base_color_texture.expired() ? 0 : vlk_material_data::has_base_color_texture;
+	data.texture_flags |= _emissive_texture.expired() ? 0 : vlk_material_data::has_emissive_texture;
+	data.texture_flags |= _metallic_roughness_texture.expired() ? 0 : vlk_material_data::has_metallic_roughness_texture;
+	data.texture_flags |= _normal_texture.expired() ? 0 : vlk_material_data::has_normal_texture;
+	data.texture_flags |= _occlusion_texture.expired() ? 0 : vlk_material_data::has_occlusion_texture;
+
+	/* Uploaded once - the data never changes */
+	_material_index = _device.get_material_buffer().add(data, _upload_value);
 }
 
 void vlk_material::create_sets()
@@ -108,104 +159,130 @@ void vlk_material::create_sets()
 	*/
 	_sets.resize(gpu::num_frame_buf);
 
-	auto& layout = _device.get_material_layout();
-	auto layout_handles = std::vector<VkDescriptorSetLayout>(gpu::num_frame_buf, layout.get_handle());
+	/* Sets may be recycled from an unloaded material - they're all written below */
+	_device.get_material_layout().get_allocator().allocate((uint32_t)_sets.size(), _sets.data());
 
-	VkDescriptorSetAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	alloc_info.descriptorPool = layout.get_pool_handle();
-	alloc_info.descriptorSetCount = layout_handles.size();
-	alloc_info.pSetLayouts = layout_handles.data();
+	uint32_t version = get_texture_version();
+	_set_versions.assign(_sets.size(), version);
 
-	VkResult result = vkAllocateDescriptorSets(_device.get_handle(), &alloc_info, _sets.data());
-	if (result != VK_SUCCESS)
+	for (uint32_t i = 0; i < _sets.size(); i++)
 	{
-		LOG_FATAL("Failed to allocate descriptor sets.");
+		write_set(i);
 	}
+}
 
-	for (uint32_t i = 0; i < _buffers.size(); i++)
+void vlk_material::destroy_data()
+{
+	/* Reused once frames in flight are done with it */
+	_device.get_material_buffer().remove(_material_index);
+}
+
+void vlk_material::destroy_sets()
+{
+	/* Recycled once frames in flight are done with them */
+	_device.get_material_layout().get_allocator().free((uint32_t)_sets.size(), _sets.data());
+	_sets.clear();
+}
+
+uint32_t vlk_material::get_bindless_index(wptr<vlk_texture> tex) const
+{
+	auto t = tex.lock();
+	if (!t)
 	{
-		VkDescriptorBufferInfo buffer_info = _buffers[i]->get_buffer_info();
-
-		std::vector<VkWriteDescriptorSet> descriptor_writes;
-		descriptor_writes.resize(6);
-
-		/* Material UBO */
-		descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptor_writes[0].dstSet = _sets[i];
-		descriptor_writes[0].dstBinding = 0;
-		descriptor_writes[0].dstArrayElement = 0;
-		descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptor_writes[0].descriptorCount = 1;
-		descriptor_writes[0].pBufferInfo = &buffer_info;
-
-		/* Base color texture */
-		descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptor_writes[1].dstSet = _sets[i];
-		descriptor_writes[1].dstBinding = 1;
-		descriptor_writes[1].dstArrayElement = 0;
-		descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptor_writes[1].descriptorCount = 1;
-		descriptor_writes[1].pImageInfo = get_img_info(_base_color_texture);
-
-		/* Metallic/roughness texture */
-		descriptor_writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptor_writes[2].dstSet = _sets[i];
-		descriptor_writes[2].dstBinding = 2;
-		descriptor_writes[2].dstArrayElement = 0;
-		descriptor_writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptor_writes[2].descriptorCount = 1;
-		descriptor_writes[2].pImageInfo = get_img_info(_metallic_roughness_texture);
-
-		/* Normal texture */
-		descriptor_writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptor_writes[3].dstSet = _sets[i];
-		descriptor_writes[3].dstBinding = 3;
-		descriptor_writes[3].dstArrayElement = 0;
-		descriptor_writes[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptor_writes[3].descriptorCount = 1;
-		descriptor_writes[3].pImageInfo = get_img_info(_normal_texture);
-
-		/* Occlusion texture */
-		descriptor_writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptor_writes[4].dstSet = _sets[i];
-		descriptor_writes[4].dstBinding = 4;
-		descriptor_writes[4].dstArrayElement = 0;
-		descriptor_writes[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptor_writes[4].descriptorCount = 1;
-		descriptor_writes[4].pImageInfo = get_img_info(_occlusion_texture);
-
-		/* Emissive texture */
-		descriptor_writes[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptor_writes[5].dstSet = _sets[i];
-		descriptor_writes[5].dstBinding = 5;
-		descriptor_writes[5].dstArrayElement = 0;
-		descriptor_writes[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptor_writes[5].descriptorCount = 1;
-		descriptor_writes[5].pImageInfo = get_img_info(_emissive_texture);
-
-		vkUpdateDescriptorSets(_device.get_handle(), descriptor_writes.size(), descriptor_writes.data(), 0, NULL);
+		return vlk_bindless_textures::invalid_index;
 	}
+
+	return t->has_image() ? t->get_bindless_index() : _default_texture.lock()->get_bindless_index();
 }
 
-void vlk_material::destroy_buffers()
+/** Gets the image info for a texture. If the texture is null or has no image yet, the default texture is used. */
+VkDescriptorImageInfo* vlk_material::get_img_info(wptr<vlk_texture> tex) const
 {
-	_buffers.clear();
+	auto t = tex.lock();
+	return t && t->has_image() ? t->get_image_info() : _default_texture.lock()->get_image_info();
 }
 
-void vlk_material::destroy_sets()
+void vlk_material::push_constants(const vlk_frame& frame, VkPipelineLayout pipeline_layout) const
 {
-	/*
-	Descriptor sets are destroyed automatically when the parent descriptor pool
-	is destroyed.
-	*/
+	/* Texture indices are read every bind since streamed textures move to a new slot when their view changes */
+	vlk_gltf_push_constant_fragment pc = {};
+	pc.material_index = _material_index;
+	pc.base_color_texture = get_bindless_index(_base_color_texture);
+	pc.metallic_roughness_texture = get_bindless_index(_metallic_roughness_texture);
+	pc.normal_texture = get_bindless_index(_normal_texture);
+	pc.occlusion_texture = get_bindless_index(_occlusion_texture);
+	pc.emissive_texture = get_bindless_index(_emissive_texture);
+
+	uint32_t offset = offsetof(vlk_gltf_push_constant, fragment);
+	vkCmdPushConstants(frame.cmd_buf, pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, offset, sizeof(pc), &pc);
 }
 
-/** Gets the image info for a texture. If the texture is null, the default texture is used. */
-VkDescriptorImageInfo* vlk_material::get_img_info(wptr<vlk_texture> tex)
+uint32_t vlk_material::get_texture_version() const
 {
-	auto t = tex.lock();
-	return t ? t->get_image_info() : _default_texture.lock()->get_image_info();
+	const wptr<vlk_texture>* textures[] = { &_base_color_texture, &_emissive_texture, &_metallic_roughness_texture, &_normal_texture, &_occlusion_texture };
+
+	uint32_t version = 0;
+	for (auto tex : textures)
+	{
+		auto t = tex->lock();
+		version += t ? t->get_version() : 0;
+	}
+
+	return version;
+}
+
+void vlk_material::write_set(uint32_t i) const
+{
+	/* The material parameters are in the material buffer - the set only has the textures */
+	std::vector<VkWriteDescriptorSet> descriptor_writes;
+	descriptor_writes.resize(5);
+
+	/* Base color texture */
+	descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[0].dstSet = _sets[i];
+	descriptor_writes[0].dstBinding = 1;
+	descriptor_writes[0].dstArrayElement = 0;
+	descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_writes[0].descriptorCount = 1;
+	descriptor_writes[0].pImageInfo = get_img_info(_base_color_texture);
+
+	/* Metallic/roughness texture */
+	descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[1].dstSet = _sets[i];
+	descriptor_writes[1].dstBinding = 2;
+	descriptor_writes[1].dstArrayElement = 0;
+	descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_writes[1].descriptorCount = 1;
+	descriptor_writes[1].pImageInfo = get_img_info(_metallic_roughness_texture);
+
+	/* Normal texture */
+	descriptor_writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[2].dstSet = _sets[i];
+	descriptor_writes[2].dstBinding = 3;
+	descriptor_writes[2].dstArrayElement = 0;
+	descriptor_writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_writes[2].descriptorCount = 1;
+	descriptor_writes[2].pImageInfo = get_img_info(_normal_texture);
+
+	/* Occlusion texture */
+	descriptor_writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[3].dstSet = _sets[i];
+	descriptor_writes[3].dstBinding = 4;
+	descriptor_writes[3].dstArrayElement = 0;
+	descriptor_writes[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_writes[3].descriptorCount = 1;
+	descriptor_writes[3].pImageInfo = get_img_info(_occlusion_texture);
+
+	/* Emissive texture */
+	descriptor_writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[4].dstSet = _sets[i];
+	descriptor_writes[4].dstBinding = 5;
+	descriptor_writes[4].dstArrayElement = 0;
+	descriptor_writes[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_writes[4].descriptorCount = 1;
+	descriptor_writes[4].pImageInfo = get_img_info(_emissive_texture);
+
+	vkUpdateDescriptorSets(_device.get_handle(), descriptor_writes.size(), descriptor_writes.data(), 0, NULL);
 }
 
 }   /* namespace jetz */
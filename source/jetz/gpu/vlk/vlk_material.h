@@ -12,7 +12,6 @@ INCLUDES
 #include <vulkan/vulkan.h>
 
 #include "jetz/gpu/gpu_material.h"
-#include "jetz/gpu/vlk/vlk_buffer.h"
 #include "jetz/gpu/vlk/vlk_device.h"
 #include "jetz/gpu/vlk/vlk_frame.h"
 #include "jetz/gpu/vlk/vlk_texture.h"
@@ -51,22 +50,6 @@ struct vlk_material_create_info
 	float							roughness_factor;
 };
 
-/**
-This maps the UBO layout as used by the shader.
-*/
-struct vlk_material_ubo
-{
-	glm::vec4		base_color_factor;
-	glm::vec3		emissive_factor;
-	float			metallic_factor;
-	float			roughness_factor;
-	bool			hasBaseColorTexture;
-	bool			hasMetallicRoughnessTexture;
-	bool			hasNormalTexture;
-	bool			hasOcclusionTexture;
-	bool			hasEmissiveTexture;
-};
-
 class vlk_material : public gpu_material {
 
 public:
@@ -82,25 +65,60 @@ public:
 	Public Methods
 	-----------------------------------------------------*/
 
-	/** Binds the descriptor set for the material for rendering. */
+	/**
+	Binds the material for rendering. The material's index in the material
+	buffer is pushed as a fragment push constant. With bindless textures the
+	textures' indices in the global texture array are pushed with it;
+	otherwise the material's texture set is bound, rewritten first if any
+	texture's image view changed (e.g. streamed mips).
+	*/
 	void bind
 		(
-		const vlk_frame&			frame,
+		vlk_frame&					frame,
 		VkPipelineLayout			pipeline_layout
 		) const;
 
+	/**
+	Requests texture mips for sampling at a given density.
+
+	@param uv_per_pixel Texture coordinate units covered by one screen pixel.
+	*/
+	void request_mips(float uv_per_pixel) const;
+
+	/*-----------------------------------------------------
+	jetz::gpu_material Methods
+	-----------------------------------------------------*/
+
+	virtual uint64_t get_memory_size() const override;
+
 private:
 
 	/*-----------------------------------------------------
 	Private methods
 	-----------------------------------------------------*/
 
-	void create_buffers();
+	/** Adds the material's parameters to the device's material buffer. */
+	void create_data();
 	void create_sets();
-	void destroy_buffers();
+	void destroy_data();
 	void destroy_sets();
 
-	VkDescriptorImageInfo* get_img_info(wptr<vlk_texture> tex);
+	/**
+	Gets a texture's bindless index, or vlk_bindless_textures::invalid_index if
+	the texture is null. Textures without an image yet use the default texture.
+	*/
+	uint32_t get_bindless_index(wptr<vlk_texture> tex) const;
+
+	VkDescriptorImageInfo* get_img_info(wptr<vlk_texture> tex) const;
+
+	/** Pushes the material index and bindless texture indices for the fragment shader. */
+	void push_constants(const vlk_frame& frame, VkPipelineLayout pipeline_layout) const;
+
+	/** Sums the versions of the material's textures. Changes when any image view changes. */
+	uint32_t get_texture_version() const;
+
+	/** Writes the textures to a descriptor set. */
+	void write_set(uint32_t i) const;
 
 	/*-----------------------------------------------------
 	Private variables
@@ -115,8 +133,10 @@ private:
 	/*
 	Create/destroy
 	*/
-	std::vector<uptr<vlk_buffer>>	_buffers;
-	std::vector<VkDescriptorSet>	_sets;
+	uint32_t						_material_index;	/* entry in the device's material buffer */
+	uint64_t						_upload_value;		/* staging ring value of the entry's upload */
+	std::vector<VkDescriptorSet>	_sets;				/* texture sets, only without bindless textures */
+	mutable std::vector<uint32_t>	_set_versions;		/* texture version each set was written with */
 
 	/*
 	Normal/occlusion/emissive
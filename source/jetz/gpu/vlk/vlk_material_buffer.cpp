@@ -0,0 +1,260 @@
+/*=============================================================================
+vlk_material_buffer.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/vlk/vlk_buffer.h"
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/vlk_frame.h"
+#include "jetz/gpu/vlk/vlk_material_buffer.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
+#include "jetz/gpu/vlk/descriptors/vlk_descriptor_allocator.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Set num is specified in the shaders */
+static const uint32_t material_set_num = 2;
+
+/* A set is created each time the buffer grows, so pools only need a few */
+static const uint32_t sets_per_pool = 4;
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_material_buffer::vlk_material_buffer(vlk_device& device, uint32_t capacity)
+	:
+	_device(device),
+	_layout(VK_NULL_HANDLE),
+	_frame_num(0),
+	_capacity(0),
+	_count(0)
+{
+	create_layout();
+
+	std::vector<VkDescriptorPoolSize> set_sizes(1);
+	set_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	set_sizes[0].descriptorCount = 1;
+
+	_set_allocator = uptr<vlk_descriptor_allocator>(new vlk_descriptor_allocator(device, _layout, set_sizes, sets_per_pool, "Material buffer"));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	create_storage(capacity);
+}
+
+vlk_material_buffer::~vlk_material_buffer()
+{
+	LOG_INFO_FMT("Material buffer: {0} of {1} entries in use.", _count, _capacity);
+
+	/* Sets are freed with the allocator's pools */
+	_retired_storage.clear();
+	_storage.buffer.reset();
+	_set_allocator.reset();
+
+	destroy_layout();
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+uint32_t vlk_material_buffer::add(const vlk_material_data& data, uint64_t& upload_value)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_count++;
+
+	/* Reuse recycled entries first */
+	uint32_t index;
+	if (!_free.empty())
+	{
+		index = _free.back();
+		_free.pop_back();
+		_entries[index] = data;
+	}
+	else
+	{
+		index = (uint32_t)_entries.size();
+		_entries.push_back(data);
+	}
+
+	/* No room - the new buffer is filled with all entries, including this one */
+	if (index >= _capacity)
+	{
+		create_storage(_capacity * 2);
+		upload_value = _storage.upload_value;
+		return index;
+	}
+
+	VkDeviceSize stride = sizeof(vlk_material_data);
+	upload_value = _device.get_staging_ring().copy_to_buffer(_storage.buffer->get_handle(), index * stride, &data, stride);
+	_storage.last_value = upload_value;
+	return index;
+}
+
+void vlk_material_buffer::bind(vlk_frame& frame, VkPipelineLayout pipeline_layout)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	/* Entries uploaded before the buffer grew are copied to the new buffer by its initial upload */
+	_device.get_staging_ring().wait(_storage.upload_value);
+	frame.bind_material_set(pipeline_layout, material_set_num, _storage.set);
+}
+
+uint32_t vlk_material_buffer::get_capacity() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _capacity;
+}
+
+uint32_t vlk_material_buffer::get_count() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _count;
+}
+
+VkDescriptorSetLayout vlk_material_buffer::get_layout_handle() const
+{
+	return _layout;
+}
+
+void vlk_material_buffer::remove(uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_count--;
+
+	retired_entry r = {};
+	r.index = index;
+	r.frame = _frame_num;
+	_retired.push_back(r);
+}
+
+void vlk_material_buffer::update()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_frame_num++;
+	_set_allocator->update();
+
+	/* Frames that could still read an entry or buffer have finished after num_frame_buf frames */
+	size_t kept = 0;
+	for (size_t i = 0; i < _retired.size(); ++i)
+	{
+		auto& r = _retired[i];
+		if (r.frame + gpu::num_frame_buf > _frame_num)
+		{
+			_retired[kept++] = r;
+			continue;
+		}
+
+		_free.push_back(r.index);
+	}
+
+	_retired.resize(kept);
+
+	/* Frame fences don't cover transfer queue copies, so a replaced buffer also waits for its last upload */
+	auto& staging_ring = _device.get_staging_ring();
+
+	kept = 0;
+	for (size_t i = 0; i < _retired_storage.size(); ++i)
+	{
+		auto& r = _retired_storage[i];
+		if (r.frame + gpu::num_frame_buf > _frame_num || !staging_ring.is_complete(r.storage.last_value))
+		{
+			_retired_storage[kept++] = std::move(r);
+			continue;
+		}
+
+		_set_allocator->free(1, &r.storage.set);
+	}
+
+	_retired_storage.resize(kept);
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void vlk_material_buffer::create_layout()
+{
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.bindingCount = 1;
+	layout_info.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(_device.get_handle(), &layout_info, NULL, &_layout) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create material buffer descriptor set layout.");
+	}
+}
+
+void vlk_material_buffer::create_storage(uint32_t capacity)
+{
+	if (_storage.buffer)
+	{
+		LOG_INFO_FMT("Material buffer grown to {0} entries.", capacity);
+
+		retired_storage r = {};
+		r.storage = std::move(_storage);
+		r.frame = _frame_num;
+		_retired_storage.push_back(std::move(r));
+	}
+
+	_capacity = capacity;
+
+	VkDeviceSize size = (VkDeviceSize)capacity * sizeof(vlk_material_data);
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	_storage.buffer = uptr<vlk_buffer>(new vlk_buffer(_device, size, usage, VMA_MEMORY_USAGE_GPU_ONLY));
+
+	/* Fill it with the entries so far */
+	_storage.upload_value = 0;
+	if (!_entries.empty())
+	{
+		_storage.upload_value = _device.get_staging_ring().copy_to_buffer(_storage.buffer->get_handle(), 0, _entries.data(), _entries.size() * sizeof(vlk_material_data));
+	}
+
+	_storage.last_value = _storage.upload_value;
+
+	/* Sets may be recycled from a replaced buffer - written below */
+	_set_allocator->allocate(1, &_storage.set);
+
+	VkDescriptorBufferInfo buffer_info = _storage.buffer->get_buffer_info();
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = _storage.set;
+	write.dstBinding = 0;
+	write.dstArrayElement = 0;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &buffer_info;
+
+	vkUpdateDescriptorSets(_device.get_handle(), 1, &write, 0, NULL);
+}
+
+void vlk_material_buffer::destroy_layout()
+{
+	vkDestroyDescriptorSetLayout(_device.get_handle(), _layout, NULL);
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,179 @@
+/*=============================================================================
+vlk_material_buffer.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "jetz/main/common.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_buffer;
+class vlk_descriptor_allocator;
+class vlk_device;
+class vlk_frame;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+One material's entry in the material buffer. This maps the std430 layout
+used by the shaders.
+*/
+struct vlk_material_data
+{
+	/* Texture flags */
+	static const uint32_t has_base_color_texture = 1 << 0;
+	static const uint32_t has_metallic_roughness_texture = 1 << 1;
+	static const uint32_t has_normal_texture = 1 << 2;
+	static const uint32_t has_occlusion_texture = 1 << 3;
+	static const uint32_t has_emissive_texture = 1 << 4;
+
+	glm::vec4		base_color_factor;
+	glm::vec3		emissive_factor;
+	float			metallic_factor;
+	float			roughness_factor;
+	uint32_t		texture_flags;
+	uint32_t		pad[2];			/* 48 bytes */
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Holds the parameters of every material in one device local storage buffer.
+Material data never changes, so each entry is uploaded once through the
+staging ring and draws select their material with an index in push
+constants.
+
+The buffer is bound with its own descriptor set (set 2 of the gltf pipeline
+layout). When it fills up a larger buffer is created and all entries are
+uploaded to it again from a CPU copy; the old buffer and set are destroyed
+once frames that may use them are done.
+
+Entries may be added and removed from any thread.
+*/
+class vlk_material_buffer {
+
+public:
+
+	/** Number of materials the buffer holds initially. */
+	static const uint32_t default_capacity = 1024;
+
+	vlk_material_buffer(vlk_device& device, uint32_t capacity = default_capacity);
+	~vlk_material_buffer();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Adds a material's data and records its upload.
+
+	@param data The material data.
+	@param upload_value Set to the upload's staging ring value. Wait on it
+		before the material is first drawn.
+	@returns The material's index in the buffer.
+	*/
+	uint32_t add(const vlk_material_data& data, uint64_t& upload_value);
+
+	/**
+	Binds the buffer's descriptor set, unless the frame already has it
+	bound. Waits for the buffer's initial upload if it was just grown.
+	*/
+	void bind(vlk_frame& frame, VkPipelineLayout pipeline_layout);
+
+	/** Gets the number of materials the buffer can hold before it grows. */
+	uint32_t get_capacity() const;
+
+	/** Gets the number of materials in the buffer. */
+	uint32_t get_count() const;
+
+	VkDescriptorSetLayout get_layout_handle() const;
+
+	/** Frees an entry once frames that may use it are done. */
+	void remove(uint32_t index);
+
+	/**
+	Recycles removed entries and destroys replaced buffers once the staging
+	ring has finished copying into them. Call at the start of a frame, after
+	the frame's fence has been waited on.
+	*/
+	void update();
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	/** A buffer and the set it's bound with. Replaced when the buffer grows. */
+	struct material_storage
+	{
+		uptr<vlk_buffer>		buffer;
+		VkDescriptorSet			set;
+		uint64_t				upload_value;	/* staging ring value of the upload that filled the buffer */
+		uint64_t				last_value;		/* staging ring value of the last upload into the buffer */
+	};
+
+	struct retired_storage
+	{
+		material_storage		storage;
+		uint64_t				frame;			/* frame the storage was replaced */
+	};
+
+	struct retired_entry
+	{
+		uint32_t				index;
+		uint64_t				frame;			/* frame the entry was removed */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	void create_layout();
+	void destroy_layout();
+
+	/**
+	Creates a buffer with room for capacity entries and uploads all entries
+	to it. The current buffer is retired. Requires the lock.
+	*/
+	void create_storage(uint32_t capacity);
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+	VkDescriptorSetLayout			_layout;
+	uptr<vlk_descriptor_allocator>	_set_allocator;
+
+	mutable std::mutex				_mutex;
+	uint64_t						_frame_num;
+	uint32_t						_capacity;
+	material_storage				_storage;
+	std::vector<retired_storage>	_retired_storage;
+	std::vector<vlk_material_data>	_entries;		/* CPU copy of every entry, uploaded again when the buffer grows */
+	std::vector<uint32_t>			_free;			/* recycled entries ready for reuse */
+	std::vector<retired_entry>		_retired;
+	uint32_t						_count;
+};
+
+}   /* namespace jetz */
@@ -0,0 +1,172 @@
+/*=============================================================================
+vlk_mesh_arena.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/vlk/vlk_buffer.h"
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/vlk_mesh_arena.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Index ranges start on a 32-bit index so either index type can be used */
+static const VkDeviceSize index_alignment = sizeof(uint32_t);
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_mesh_arena::vlk_mesh_arena(vlk_device& device)
+	:
+	_device(device),
+	_frame_num(0)
+{
+	_vertices.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	_vertices.block_size = vertex_block_size;
+
+	_indices.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+	_indices.block_size = index_block_size;
+}
+
+vlk_mesh_arena::~vlk_mesh_arena()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	free_retired(true);
+
+	for (const auto* pool : { &_vertices, &_indices })
+	{
+		for (const auto& block : pool->blocks)
+		{
+			if (block->free_list.get_used() > 0)
+			{
+				LOG_WARN_FMT("Mesh arena destroyed with {0} bytes still allocated.", block->free_list.get_used());
+			}
+		}
+	}
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+vlk_mesh_range vlk_mesh_arena::allocate_vertices(VkDeviceSize size, uint32_t stride)
+{
+	return allocate(_vertices, size, stride);
+}
+
+vlk_mesh_range vlk_mesh_arena::allocate_indices(VkDeviceSize size)
+{
+	return allocate(_indices, size, index_alignment);
+}
+
+void vlk_mesh_arena::free_vertices(const vlk_mesh_range& range)
+{
+	retire(_vertices, range);
+}
+
+void vlk_mesh_arena::free_indices(const vlk_mesh_range& range)
+{
+	retire(_indices, range);
+}
+
+void vlk_mesh_arena::update()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_frame_num++;
+	free_retired(false);
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+vlk_mesh_range vlk_mesh_arena::allocate(arena_pool& pool, VkDeviceSize size, VkDeviceSize alignment)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	vlk_mesh_range range = {};
+	if (size == 0)
+	{
+		return range;
+	}
+
+	for (size_t i = 0; i < pool.blocks.size(); ++i)
+	{
+		auto& block = *pool.blocks[i];
+		if (block.free_list.allocate(size, alignment, range.offset))
+		{
+			range.buffer = block.buffer->get_handle();
+			range.block = static_cast<uint32_t>(i);
+			range.size = size;
+			return range;
+		}
+	}
+
+	/* No room - add a block, large enough for the range on its own if needed */
+	VkDeviceSize block_size = (std::max)(pool.block_size, size);
+	auto buffer = uptr<vlk_buffer>(new vlk_buffer(_device, block_size, pool.usage, VMA_MEMORY_USAGE_GPU_ONLY));
+	pool.blocks.push_back(uptr<arena_block>(new arena_block(std::move(buffer), block_size)));
+
+	auto& block = *pool.blocks.back();
+	if (!block.free_list.allocate(size, alignment, range.offset))
+	{
+		LOG_FATAL("Failed to allocate mesh arena range.");
+	}
+
+	range.buffer = block.buffer->get_handle();
+	range.block = static_cast<uint32_t>(pool.blocks.size() - 1);
+	range.size = size;
+	return range;
+}
+
+void vlk_mesh_arena::retire(arena_pool& pool, const vlk_mesh_range& range)
+{
+	if (range.buffer == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	retired_range r = {};
+	r.pool = &pool;
+	r.range = range;
+	r.frame = _frame_num;
+
+	_retired.push_back(r);
+}
+
+void vlk_mesh_arena::free_retired(bool force)
+{
+	/* Frames that could still be drawing from a range have finished after num_frame_buf frames */
+	size_t kept = 0;
+	for (size_t i = 0; i < _retired.size(); ++i)
+	{
+		auto& r = _retired[i];
+		if (!force && r.frame + gpu::num_frame_buf > _frame_num)
+		{
+			_retired[kept++] = r;
+			continue;
+		}
+
+		r.pool->blocks[r.range.block]->free_list.free(r.range.offset, r.range.size);
+	}
+
+	_retired.resize(kept);
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,156 @@
+/*=============================================================================
+vlk_mesh_arena.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "jetz/main/common.h"
+#include "jetz/gpu/gpu_free_list.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_buffer;
+class vlk_device;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+A range of one of the mesh arena's buffers.
+*/
+struct vlk_mesh_range
+{
+	VkBuffer					buffer;			/* arena buffer holding the range, null if not allocated */
+	uint32_t					block;			/* index of the buffer in its pool */
+	VkDeviceSize				offset;			/* byte offset of the range in the buffer */
+	VkDeviceSize				size;
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Large device local vertex and index buffers shared by all models. Models
+sub-allocate their geometry from the arena and draw with vertex and index
+offsets into it, so the buffers only need to be bound when a draw uses a
+different block than the last one - usually once per frame.
+
+A pool grows by another block when no free range fits. Freed ranges are only
+reused once frames that may still draw from them are done.
+
+Ranges may be allocated and freed from any thread.
+*/
+class vlk_mesh_arena {
+
+public:
+
+	/** Size of each vertex buffer block in bytes. */
+	static const VkDeviceSize vertex_block_size = 64 * 1024 * 1024;
+
+	/** Size of each index buffer block in bytes. */
+	static const VkDeviceSize index_block_size = 32 * 1024 * 1024;
+
+	vlk_mesh_arena(vlk_device& device);
+	~vlk_mesh_arena();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Allocates a vertex range. The offset is a multiple of the vertex stride,
+	so the range's first vertex is offset / stride with the buffer bound at
+	offset 0.
+	*/
+	vlk_mesh_range allocate_vertices(VkDeviceSize size, uint32_t stride);
+
+	/**
+	Allocates an index range. The offset is 4 byte aligned, so it is a whole
+	number of indices of either index type.
+	*/
+	vlk_mesh_range allocate_indices(VkDeviceSize size);
+
+	/** Queues a vertex range to be freed once frames that may use it are done. */
+	void free_vertices(const vlk_mesh_range& range);
+
+	/** Queues an index range to be freed once frames that may use it are done. */
+	void free_indices(const vlk_mesh_range& range);
+
+	/**
+	Frees retired ranges. Call at the start of a frame, after the frame's
+	fence has been waited on.
+	*/
+	void update();
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct arena_block
+	{
+		uptr<vlk_buffer>		buffer;
+		gpu_free_list			free_list;
+
+		arena_block(uptr<vlk_buffer> buffer, VkDeviceSize size)
+			: buffer(std::move(buffer)), free_list(size) {}
+	};
+
+	struct arena_pool
+	{
+		VkBufferUsageFlags		usage;
+		VkDeviceSize			block_size;
+		std::vector<uptr<arena_block>>
+								blocks;
+	};
+
+	struct retired_range
+	{
+		arena_pool*				pool;
+		vlk_mesh_range			range;
+		uint64_t				frame;			/* frame the range was freed */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Allocates from the first block with room, adding a block if none has. */
+	vlk_mesh_range allocate(arena_pool& pool, VkDeviceSize size, VkDeviceSize alignment);
+
+	/** Queues a range to be freed. */
+	void retire(arena_pool& pool, const vlk_mesh_range& range);
+
+	/** Frees retired ranges, or all of them if force is set. Requires the lock. */
+	void free_retired(bool force);
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+	std::mutex						_mutex;
+	uint64_t						_frame_num;
+
+	arena_pool						_vertices;
+	arena_pool						_indices;
+	std::vector<retired_range>		_retired;
+};
+
+}   /* namespace jetz */
@@ -6,22 +6,28 @@ vlk_texture.cpp
 INCLUDES
 =============================================================================*/
 
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
-#include <unordered_set>
 
 #include "jetz/ecs/components/ecs_transform_component.h"
+#include "jetz/gpu/gpu.h"
 #include "jetz/gpu/gpu_frame.h"
+#include "jetz/gpu/gpu_mesh_packer.h"
 #include "jetz/gpu/vlk/vlk_device.h"
 #include "jetz/gpu/vlk/vlk_frame.h"
 #include "jetz/gpu/vlk/vlk_material.h"
 #include "jetz/gpu/vlk/vlk_model.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
 #include "jetz/gpu/vlk/vlk_texture.h"
 #include "jetz/gpu/vlk/pipelines/vlk_gltf_pipeline.h"
 #include "jetz/gpu/vlk/pipelines/vlk_pipeline_cache.h"
 #include "jetz/main/log.h"
+#include "jetz/main/utl.h"
 
 /*=============================================================================
 NAMESPACE
@@ -29,6 +35,36 @@ NAMESPACE
 
 namespace jetz {
 
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Hashes a material by its factors and texture objects.
+*/
+static uint64_t hash_material(const vlk_material_create_info& info)
+{
+	const void* textures[] =
+	{
+		info.base_color_texture.lock().get(),
+		info.emissive_texture.lock().get(),
+		info.metallic_roughness_texture.lock().get(),
+		info.normal_texture.lock().get(),
+		info.occlusion_texture.lock().get()
+	};
+
+	float factors[] =
+	{
+		info.base_color_factor.r, info.base_color_factor.g, info.base_color_factor.b, info.base_color_factor.a,
+		info.emissive_factor.r, info.emissive_factor.g, info.emissive_factor.b,
+		info.metallic_factor,
+		info.roughness_factor
+	};
+
+	uint64_t hash = utl::hash_bytes(textures, sizeof(textures));
+	return utl::hash_bytes(factors, sizeof(factors), hash);
+}
+
 /*=============================================================================
 CONSTRUCTORS
 =============================================================================*/
@@ -36,17 +72,28 @@ CONSTRUCTORS
 vlk_model::vlk_model
 	(
 	vlk_device&					dev,
-	uptr<tinygltf::Model>		gltf,
+	gpu&						gpu,
+	uptr<gpu_gltf>				gltf,
 	sptr<vlk_pipeline_cache>	pipeline_cache
 	)
 	: 
 	_device(dev),
+	_gpu(gpu),
 	_gltf(std::move(gltf)),
-	_pipeline_cache(pipeline_cache)
+	_pipeline_cache(pipeline_cache),
+	_quantized(gpu::quantize_vertices),
+	_index_range(),
+	_vertex_range(),
+	_upload_value(0),
+	_lod_state_count(0)
 {
 	create_textures();
 	create_materials();
 	create_primitives();
+	create_nodes();
+
+	/* Everything needed to render has been extracted - free the CPU-side model */
+	_gltf.reset();
 }
 
 vlk_model::~vlk_model()
@@ -61,199 +108,255 @@ vlk_model::~vlk_model()
 PUBLIC METHODS
 =============================================================================*/
 
-void vlk_model::render(const gpu_frame& gpu_frame, const ecs_transform_component& transform)
+uint64_t vlk_model::get_memory_size() const
 {
-	vlk_frame& frame = _device.get_frame(gpu_frame);
+	/* Geometry lives in the shared mesh arena - count the model's ranges */
+	uint64_t size = _vertex_range.size + _index_range.size;
 
-	for (const auto& scene : _gltf->scenes)
+	/* The model owns its materials and textures */
+	for (const auto& mat : _materials)
 	{
-		for (auto nodeIndex : scene.nodes)
-		{
-			// TODO : model scale and rotation
-			auto root_transform = glm::mat4(1.0f);
-			root_transform = glm::translate(root_transform, transform.pos);
-			render_node(nodeIndex, frame, frame.cmd_buf, root_transform);
-		}
+		size += mat ? mat->get_memory_size() : 0;
 	}
-}
 
-/*=============================================================================
-PRIVATE METHODS
-=============================================================================*/
-
-void vlk_model::create_buffer(int bufferIndex)
-{
-	/* Validate buffer index */
-	if (bufferIndex < 0)
+	for (const auto& tex : _textures)
 	{
-		/* No buffer */
-		return;
+		size += tex ? tex->get_memory_size() : 0;
 	}
 
-	if (bufferIndex >= _gltf->buffers.size())
+	return size;
+}
+
+void vlk_model::render(const gpu_frame& gpu_frame, const ecs_transform_component& transform, gpu_model_instance& instance)
+{
+	vlk_frame& frame = _device.get_frame(gpu_frame);
+
+	if (_vertex_range.buffer == VK_NULL_HANDLE || _index_range.buffer == VK_NULL_HANDLE)
 	{
-		LOG_ERROR_FMT("Invalid buffer index {0}, no buffer created.", bufferIndex);
+		/* Nothing to render */
 		return;
 	}
 
-	/* Check if buffer already created */
-	const auto it = _buffers.find(bufferIndex);
-	if (it != _buffers.end())
+	if (!_device.get_staging_ring().is_ready(_upload_value))
 	{
-		/* Buffer already created */
+		/* Geometry is still uploading */
 		return;
 	}
 
-	/* Create the buffer */
-	const auto& b = _gltf->buffers[bufferIndex];
-	size_t buf_size = b.data.size();
-
-	auto vlk_buf = new vlk_buffer(
-		_device,
-		buf_size,
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY);
+	/* Vertices are addressed with the draw's vertex offset, so the arena buffer is only bound when it changes */
+	frame.bind_vertex_buffer(_vertex_range.buffer);
 
-	_buffers[bufferIndex] = uptr<vlk_buffer>(vlk_buf);
+	/* Make sure there is LOD state for each primitive of each node */
+	if (instance.lods.size() != _lod_state_count)
+	{
+		instance.lods.assign(_lod_state_count, 0);
+	}
 
-	/* Transfer data to GPU */
-	_buffers[bufferIndex]->update((void*)b.data.data(), 0, buf_size);
+	for (auto node_idx : _root_nodes)
+	{
+		// TODO : model scale and rotation
+		auto root_transform = glm::mat4(1.0f);
+		root_transform = glm::translate(root_transform, transform.pos);
+		render_node(node_idx, frame, frame.cmd_buf, root_transform, instance);
+	}
 }
 
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
 void vlk_model::create_materials()
 {
-	for (const auto& mat : _gltf->materials)
+	for (const auto& mat : _gltf->model.materials)
 	{
 		load_material(mat);
 	}
 }
 
-void vlk_model::create_primitives()
+void vlk_model::create_nodes()
 {
-	size_t numPrimitives = 0;
-	_primitives.resize(_gltf->meshes.size());
+	const auto& model = _gltf->model;
+	_nodes.resize(model.nodes.size());
 
-	for (size_t i = 0; i < _gltf->meshes.size(); ++i)
+	for (size_t i = 0; i < model.nodes.size(); ++i)
 	{
-		const auto& mesh = _gltf->meshes[i];
+		const auto& gltf_node = model.nodes[i];
+		auto& node = _nodes[i];
 
-		for (size_t j = 0; j < mesh.primitives.size(); ++j)
+		/*
+		Compute the node's local transform
+		*/
+		node.matrix = glm::mat4(1.0f);
+
+		if (gltf_node.matrix.size() == 16)
 		{
-			const auto& prim = mesh.primitives[j];
-			load_primitive(prim, i);
+			// Node uses a transformation matrix
+			node.matrix = glm::mat4(glm::make_mat4x4(gltf_node.matrix.data()));
 		}
-	}
-}
+		else
+		{
+			/*
+			Node either uses translation, rotation, and scale vectors, or has no transform
+			M = T * R * S
+			*/
 
-void vlk_model::load_primitive(const tinygltf::Primitive& prim, uint32_t mesh_idx)
-{
-	std::vector<VkVertexInputAttributeDescription>	input_attributes;
-	std::vector<VkVertexInputBindingDescription>	input_bindings;
-	std::vector<VkBuffer>							input_binding_buffers;
-	std::vector<VkDeviceSize>						input_binding_offsets;
+			/* Translation */
+			if (gltf_node.translation.size() == 3)
+			{
+				auto translation = glm::vec3(glm::make_vec3(gltf_node.translation.data()));
+				node.matrix = glm::translate(node.matrix, translation);
+			}
 
-	std::unordered_map<int, int> accessor_index_to_input_binding;
+			/* Rotation */
+			if (gltf_node.rotation.size() == 4)
+			{
+				auto rotateQuat = glm::highp_fquat(glm::make_quat(gltf_node.rotation.data()));
+				node.matrix = node.matrix * glm::mat4_cast(rotateQuat);
+			}
 
-	/* Function to load a vertex attribute description */
-	auto load_attribute = 
-		[this, prim, &accessor_index_to_input_binding, &input_attributes, &input_bindings, &input_binding_buffers, &input_binding_offsets]
-		(attribute_type type)
-	{
-		/* Try to find the attribute in this primitve */
-		auto attr = prim.attributes.find(attribute_names[type]);
-		if (attr == prim.attributes.end())
-		{
-			/* Not found */
-			return;
+			/* Scale */
+			if (gltf_node.scale.size() == 3)
+			{
+				auto scale = glm::vec3(glm::make_vec3(gltf_node.scale.data()));
+				node.matrix = glm::scale(node.matrix, scale);
+			}
 		}
 
-		/* Get accessor and buffer view */
-		const auto& a = _gltf->accessors[attr->second];
-		const auto& bv = _gltf->bufferViews[a.bufferView];
+		/* A node can contain a mesh or a camera, or it can be empty and just define a transform */
+		node.mesh = gltf_node.mesh >= 0 && gltf_node.mesh < (int)_primitives.size() ? gltf_node.mesh : -1;
 
-		/* Load buffer if needed */
-		create_buffer(bv.buffer);
+		/* Nodes can share a mesh, so each node keeps its own LOD state for the mesh's primitives */
+		node.lod_state = _lod_state_count;
+		if (node.mesh >= 0)
+		{
+			_lod_state_count += (uint32_t)_primitives[node.mesh].size();
+		}
 
-		/* Create input binding if needed - we create an input binding for each accessor */
-		auto accessorIndex = attr->second;
-		if (accessor_index_to_input_binding.find(accessorIndex) == accessor_index_to_input_binding.end())
+		for (auto child : gltf_node.children)
 		{
-			/* Determine byte stride */
-			int byteStride = a.ByteStride(bv);
-			if (byteStride < 0)
+			if (child < 0 || child >= (int)model.nodes.size())
 			{
-				LOG_ERROR_FMT("Invalid byte stride {0}; setting to 0.", byteStride);
-				LOG_ERROR_FMT("Accessor: {0}; BufferView: {1}", a.name, bv.name);
+				LOG_WARN_FMT("Invalid GLTF node index {0}.", child);
+				continue;
+			}
 
-				byteStride = 0;
+			node.children.push_back((uint32_t)child);
+		}
+	}
+
+	for (const auto& scene : model.scenes)
+	{
+		for (auto node_idx : scene.nodes)
+		{
+			if (node_idx < 0 || node_idx >= (int)model.nodes.size())
+			{
+				LOG_WARN_FMT("Invalid GLTF node index {0}.", node_idx);
+				continue;
 			}
 
-			/* Determine binding index */
-			auto bindingIndex = input_bindings.size();
+			_root_nodes.push_back((uint32_t)node_idx);
+		}
+	}
+}
 
-			/* Determine binding buffer */
-			input_binding_buffers.push_back(_buffers[bv.buffer]->get_handle());
+void vlk_model::create_primitives()
+{
+	gpu_mesh_packer packer(gpu::max_lods, _quantized);
 
-			/* Determine binding offset (within the buffer) */
-			input_binding_offsets.push_back(bv.byteOffset + a.byteOffset);
+	_primitives.resize(_gltf->model.meshes.size());
 
-			/* Create input binding */
-			VkVertexInputBindingDescription input_binding = {};
-			input_binding.binding = bindingIndex;
-			input_binding.stride = static_cast<uint32_t>(byteStride);
-			input_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-			input_bindings.push_back(input_binding);
+	for (size_t i = 0; i < _gltf->model.meshes.size(); ++i)
+	{
+		const auto& mesh = _gltf->model.meshes[i];
 
-			accessor_index_to_input_binding[accessorIndex] = bindingIndex;
+		for (size_t j = 0; j < mesh.primitives.size(); ++j)
+		{
+			const auto& prim = mesh.primitives[j];
+			load_primitive(packer, prim, i);
 		}
+	}
 
-		/* Get input binding index */
-		auto bindingIndex = accessor_index_to_input_binding[accessorIndex];
+	const auto& vertex_data = packer.vertex_data;
+	const auto& index_data = packer.index_data;
 
-		/* Create the attribute description */
-		assert(attribute_locations[type] >= 0);
+	if (vertex_data.empty() || index_data.empty())
+	{
+		/* Nothing to render */
+		return;
+	}
 
-		VkVertexInputAttributeDescription input_attribute = {};
-		input_attribute.binding = bindingIndex;
-		input_attribute.location = attribute_locations[type];
-		input_attribute.format = get_vk_format(a.type, a.componentType);
-		input_attribute.offset = 0;
+	/*
+	Upload the repacked geometry. Only data referenced by the primitives is
+	uploaded, in one vertex range and one index range of the shared mesh arena.
+	*/
+	auto& arena = _device.get_mesh_arena();
+	_vertex_range = arena.allocate_vertices(vertex_data.size(), get_vertex_stride());
+	_index_range = arena.allocate_indices(index_data.size());
 
-		input_attributes.push_back(input_attribute);
-	};
+	/* Offsets were relative to the model's data - make them relative to the arena buffers */
+	int32_t first_vertex = static_cast<int32_t>(_vertex_range.offset / get_vertex_stride());
 
-	/* Load attributes */
-	load_attribute(POSITION);
-	load_attribute(NORMAL);
-	//load_attribute(TANGENT);
-	load_attribute(TEXCOORD_0);
-	//load_attribute(TEXCOORD_1);
-	//load_attribute(COLOR_0);
-	//load_attribute(JOINTS_0);
-	//load_attribute(WEIGHTS_0;
-
-	/* Create index buffer */
-	const auto& indicesAccessor = _gltf->accessors[prim.indices];
-	const auto& indicesBufferView = _gltf->bufferViews[indicesAccessor.bufferView];
-	create_buffer(indicesBufferView.buffer);
-
-	/* Get a pipeline for this mesh primitive */
-	auto create_info = vlk_pipeline_create_info();
-	create_info.vertex_attribute_descriptions = input_attributes;
-	create_info.vertex_binding_descriptions = input_bindings;
-	const auto& pipeline = _pipeline_cache->create_gltf_pipeline(create_info);
+	for (auto& mesh : _primitives)
+	{
+		for (auto& prim : mesh)
+		{
+			uint32_t index_size = prim.index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+			uint32_t first_index = static_cast<uint32_t>(_index_range.offset / index_size);
+
+			prim.vertex_offset += first_vertex;
+			for (auto& lod : prim.lods)
+			{
+				lod.first_index += first_index;
+			}
+		}
+	}
+
+	auto& ring = _device.get_staging_ring();
+	ring.copy_to_buffer(_vertex_range.buffer, _vertex_range.offset, vertex_data.data(), vertex_data.size());
+	_upload_value = ring.copy_to_buffer(_index_range.buffer, _index_range.offset, index_data.data(), index_data.size());
+}
+
+void vlk_model::load_primitive
+	(
+	gpu_mesh_packer&				packer,
+	const tinygltf::Primitive&		prim,
+	uint32_t						mesh_idx
+	)
+{
+	/* Repack, optimize, and build LODs and meshlets, then append to the model's data */
+	gpu_packed_primitive packed;
+	if (!packer.add(*_gltf, prim, packed))
+	{
+		LOG_ERROR_FMT("Failed to load primitive for mesh {0}.", mesh_idx);
+		return;
+	}
+
+	/* Get a pipeline for this mesh primitive - all primitives share the same vertex layout */
+	const auto& pipeline = _pipeline_cache->create_gltf_pipeline(get_pipeline_create_info());
 
 	/* Create a primitive wrapper to store data for this primitive */
-	auto p = Primitive(prim, pipeline);
+	auto p = Primitive(pipeline);
 	p.material = get_vulkan_material(prim.material);
-	p.input_binding_buffers = input_binding_buffers;
-	p.input_binding_offsets = input_binding_offsets;
+	p.index_type = packed.use_16bit_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	p.id = (uint32_t)_primitives[mesh_idx].size();
+	p.meshlets = std::move(packed.meshlets);
+	p.uv_density = packed.uv_density;
+	p.center = packed.center;
+	p.radius = packed.radius;
+	p.dequant = packed.dequant;
+	p.vertex_offset = packed.vertex_offset;
+
+	for (const auto& lod : packed.lods)
+	{
+		p.lods.push_back({ lod.index_count, lod.first_index, lod.error });
+	}
+
 	_primitives[mesh_idx].push_back(p);
 }
 
 void vlk_model::create_textures()
 {
-	for (const auto& img : _gltf->images)
+	for (const auto& img : _gltf->model.images)
 	{
 		load_texture(img);
 	}
@@ -261,10 +364,13 @@ void vlk_model::create_textures()
 
 void vlk_model::destroy_buffers()
 {
-	for (size_t i = 0; i < _buffers.size(); ++i)
-	{
-		_buffers[i].reset();
-	}
+	/* Frames in flight may still draw the model - the arena reuses the ranges once they are done */
+	auto& arena = _device.get_mesh_arena();
+	arena.free_indices(_index_range);
+	arena.free_vertices(_vertex_range);
+
+	_index_range = {};
+	_vertex_range = {};
 }
 
 void vlk_model::destroy_materials()
@@ -296,107 +402,66 @@ void vlk_model::destroy_textures()
 }
 
 /**
-Gets a Vulkan format from a GLTF type and format.
-
-gltfType - TINYGLTF_TYPE_*
-gltfComponentType - TINYGLTF_COMPONENT_TYPE_*
+Gets the pipeline vertex input description for the interleaved vertex layout.
+Locations are hard coded in the shader.
 */
-VkFormat vlk_model::get_vk_format(int gltfType, int gltfComponentType) const
+vlk_pipeline_create_info vlk_model::get_pipeline_create_info() const
 {
-	if (gltfType == TINYGLTF_TYPE_VEC2)
-	{
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_BYTE)
-			return VK_FORMAT_R8G8_SINT;
-		//if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_DOUBLE)
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-			return VK_FORMAT_R32G32_SFLOAT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_INT)
-			return VK_FORMAT_R32G32_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_SHORT)
-			return VK_FORMAT_R16G16_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-			return VK_FORMAT_R8G8_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-			return VK_FORMAT_R32G32_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-			return VK_FORMAT_R16G16_UINT;
-	}
-	else if (gltfType == TINYGLTF_TYPE_VEC3)
-	{
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_BYTE)
-			return VK_FORMAT_R8G8B8_SINT;
-		//if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_DOUBLE)
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-			return VK_FORMAT_R32G32B32_SFLOAT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_INT)
-			return VK_FORMAT_R32G32B32_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_SHORT)
-			return VK_FORMAT_R16G16B16_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-			return VK_FORMAT_R8G8B8_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-			return VK_FORMAT_R32G32B32_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-			return VK_FORMAT_R16G16B16_UINT;
-	}
-	else if (gltfType == TINYGLTF_TYPE_VEC4)
-	{
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_BYTE)
-			return VK_FORMAT_R8G8B8A8_SINT;
-		//if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_DOUBLE)
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-			return VK_FORMAT_R32G32B32A32_SFLOAT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_INT)
-			return VK_FORMAT_R32G32B32A32_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_SHORT)
-			return VK_FORMAT_R16G16B16A16_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-			return VK_FORMAT_R8G8B8A8_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-			return VK_FORMAT_R32G32B32A32_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-			return VK_FORMAT_R16G16B16A16_UINT;
-	}
-	else if (gltfType == TINYGLTF_TYPE_SCALAR)
-	{
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_BYTE)
-			return VK_FORMAT_R8_SINT;
-		//if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_DOUBLE)
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-			return VK_FORMAT_R32_SFLOAT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_INT)
-			return VK_FORMAT_R32_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_SHORT)
-			return VK_FORMAT_R16_SINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-			return VK_FORMAT_R8_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-			return VK_FORMAT_R32_UINT;
-		if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-			return VK_FORMAT_R16_UINT;
-	}
-	//else if (gltfType == TINYGLTF_TYPE_MAT2)
-	//else if (gltfType == TINYGLTF_TYPE_MAT3)
-	//else if (gltfType == TINYGLTF_TYPE_MAT4)
-	//else if (gltfType == TINYGLTF_TYPE_MATRIX)
-	//else if (gltfType == TINYGLTF_TYPE_VECTOR)
-
-	LOG_FATAL("Unknown format");
+	auto create_info = vlk_pipeline_create_info();
+
+	VkVertexInputBindingDescription binding = {};
+	binding.binding = 0;
+	binding.stride = get_vertex_stride();
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	create_info.vertex_binding_descriptions.push_back(binding);
+
+	VkVertexInputAttributeDescription pos = {};
+	pos.binding = 0;
+	pos.location = 0;
+
+	VkVertexInputAttributeDescription normal = {};
+	normal.binding = 0;
+	normal.location = 1;
+
+	VkVertexInputAttributeDescription uv = {};
+	uv.binding = 0;
+	uv.location = 2;
+
+	if (_quantized)
+	{
+		pos.format = VK_FORMAT_R16G16B16A16_UNORM;
+		pos.offset = offsetof(gpu_mesh_quantized_vertex, pos);
+		normal.format = VK_FORMAT_R16G16_SNORM;
+		normal.offset = offsetof(gpu_mesh_quantized_vertex, normal);
+		uv.format = VK_FORMAT_R16G16_SFLOAT;
+		uv.offset = offsetof(gpu_mesh_quantized_vertex, uv);
+
+		/* Shader decodes octahedral normals */
+		create_info.oct_normals = VK_TRUE;
+	}
+	else
+	{
+		pos.format = VK_FORMAT_R32G32B32_SFLOAT;
+		pos.offset = offsetof(gpu_mesh_vertex, pos);
+		normal.format = VK_FORMAT_R32G32B32_SFLOAT;
+		normal.offset = offsetof(gpu_mesh_vertex, normal);
+		uv.format = VK_FORMAT_R32G32_SFLOAT;
+		uv.offset = offsetof(gpu_mesh_vertex, uv);
+	}
+
+	create_info.vertex_attribute_descriptions.push_back(pos);
+	create_info.vertex_attribute_descriptions.push_back(normal);
+	create_info.vertex_attribute_descriptions.push_back(uv);
+
+	return create_info;
 }
 
 /**
-Gets a Vulkan format from a GLTF type and format.
-
-gltfComponentType - TINYGLTF_COMPONENT_TYPE_*
+Gets the size of a vertex in the vertex buffer.
 */
-VkIndexType vlk_model::get_vk_index_type(int gltfComponentType) const
+uint32_t vlk_model::get_vertex_stride() const
 {
-	if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-		return VK_INDEX_TYPE_UINT32;
-	if (gltfComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-		return VK_INDEX_TYPE_UINT16;
-
-	LOG_FATAL("Unknown index type.");
+	return _quantized ? sizeof(gpu_mesh_quantized_vertex) : sizeof(gpu_mesh_vertex);
 }
 
 wptr<vlk_material> vlk_model::get_vulkan_material(int index)
@@ -412,13 +477,13 @@ wptr<vlk_material> vlk_model::get_vulkan_material(int index)
 
 wptr<vlk_texture> vlk_model::get_vulkan_texture(int index)
 {
-	if (index < 0 || index >= _gltf->textures.size())
+	if (index < 0 || index >= _gltf->model.textures.size())
 	{
 		LOG_ERROR("Invalid texture index.");
 		return wptr<vlk_texture>();
 	}
 
-	auto imgIdx = _gltf->textures[index].source;
+	auto imgIdx = _gltf->model.textures[index].source;
 
 	if (imgIdx < 0 || imgIdx >= _textures.size())
 	{
@@ -495,55 +560,55 @@ void vlk_model::load_material(const tinygltf::Material& mat)
 		mat_info.metallic_roughness_texture = get_vulkan_texture(tex_idx);
 	}
 
+	/*
+	Share an identical material if one exists. Textures are already shared by
+	content, so identical materials reference the same texture objects.
+	*/
+	uint64_t hash = hash_material(mat_info);
+	auto existing = std::static_pointer_cast<vlk_material>(_gpu.find_shared_material(hash));
+	if (existing)
+	{
+		_materials.push_back(existing);
+		return;
+	}
+
 	/*
 	Save material
 	*/
-	auto material = new vlk_material(_device, mat_info);
-	_materials.push_back(sptr<vlk_material>(material));
+	auto material = sptr<vlk_material>(new vlk_material(_device, mat_info));
+	_gpu.share_material(hash, material);
+	_materials.push_back(material);
 }
 
 void vlk_model::load_texture(const tinygltf::Image& image)
 {
-	/* Setup */
-	vlk_texture_create_info create_info = {};
-	create_info.data = (void*)image.image.data();
-	create_info.size = image.image.size();
-	create_info.width = static_cast<uint32_t>(image.width);
-	create_info.height = static_cast<uint32_t>(image.height);
-
-	/* Create and store texture */
-	auto texture = new vlk_texture(_device, create_info);
-	_textures.push_back(sptr<vlk_texture>(texture));
+	/* Textures are shared across models by content */
+	auto texture = _gpu.create_shared_texture(image.image.data(), image.image.size(), static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height));
+	_textures.push_back(std::static_pointer_cast<vlk_texture>(texture));
 }
 
 void vlk_model::render_mesh
 	(
 	size_t							index,
-	const vlk_frame&				frame,
+	vlk_frame&						frame,
 	VkCommandBuffer					cmd,
-	glm::mat4						transform
+	glm::mat4						transform,
+	gpu_model_instance&				instance,
+	uint32_t						lod_state
 	) const
 {
 	/* Validate index */
-	if (index >= _gltf->meshes.size())
+	if (index >= _primitives.size())
 	{
 		/* Invalid index */
 		return;
 	}
 
-	/* Get the mesh */
-	const auto& mesh = _gltf->meshes[index];
-
 	/*
 	Render each mesh component (GLTF "primitives")
 	*/
-	for (size_t i = 0; i < mesh.primitives.size(); ++i)
+	for (const auto& prim : _primitives[index])
 	{
-		const auto& prim = _primitives[index][i];
-
-		/* Bind vertex buffers for primitive */
-		vkCmdBindVertexBuffers(cmd, 0, static_cast<uint32_t>(prim.input_binding_buffers.size()), prim.input_binding_buffers.data(), prim.input_binding_offsets.data());
-
 		/*
 		Bind pipeline for primitive
 		*/
@@ -553,7 +618,7 @@ void vlk_model::render_mesh
 		Set shader push constants
 		*/
 		vlk_gltf_push_constant pc = {};
-		pc.vertex.model_matrix = transform;
+		pc.vertex.model_matrix = transform * prim.dequant;
 
 		uint32_t pc_vert_size = sizeof(vlk_gltf_push_constant_vertex);
 		vkCmdPushConstants(frame.cmd_buf, prim.pipeline.get_layout_handle(), VK_SHADER_STAGE_VERTEX_BIT, 0, pc_vert_size, &pc.vertex);
@@ -561,6 +626,8 @@ void vlk_model::render_mesh
 		/*
 		Bind material
 		*/
+		float mesh_to_px = get_mesh_to_px(prim, frame, transform);
+
 		auto mat = prim.material.lock();
 		if (mat == nullptr)
 		{
@@ -568,111 +635,145 @@ void vlk_model::render_mesh
 		}
 		else
 		{
+			/* Request the texture mips needed for the primitive's size on screen */
+			mat->request_mips(prim.uv_density / mesh_to_px);
 			mat->bind(frame, prim.pipeline.get_layout_handle());
 		}
 
 		/*
-		Bind index buffer for primitive
+		Pick a LOD
 		*/
-		auto a = _gltf->accessors[prim.data.indices];
-		auto bv = _gltf->bufferViews[a.bufferView];
-		auto offset = a.byteOffset + bv.byteOffset;
-		auto idx_type = get_vk_index_type(a.componentType);
-		auto buffer = _buffers.at(bv.buffer)->get_handle();
+		uint8_t& lod_state_prim = instance.lods[lod_state + prim.id];
+		uint8_t lod_idx = select_lod(prim, mesh_to_px, lod_state_prim);
+		lod_state_prim = lod_idx;
+		const auto& lod = prim.lods[lod_idx];
 
-		vkCmdBindIndexBuffer(cmd, buffer, offset, idx_type);
+		/*
+		Bind the arena's index buffer - only rebound when the block or index type changes
+		*/
+		frame.bind_index_buffer(_index_range.buffer, prim.index_type);
 
 		/*
 		Draw indexed
 		*/
-		vkCmdDrawIndexed(cmd, static_cast<uint32_t>(a.count), 1, 0, 0, 0);
+		if (lod_idx != 0 || prim.meshlets.empty())
+		{
+			vkCmdDrawIndexed(cmd, lod.index_count, 1, lod.first_index, prim.vertex_offset, 0);
+			continue;
+		}
+
+		/*
+		Cull meshlets in mesh space and draw the visible ranges
+		*/
+		glm::vec4 planes[6];
+		for (int i = 0; i < 6; ++i)
+		{
+			planes[i] = glm::transpose(transform) * frame.frustum[i];
+		}
+
+		float scale_x = glm::length(glm::vec3(transform[0]));
+		float scale_y = glm::length(glm::vec3(transform[1]));
+		float scale_z = glm::length(glm::vec3(transform[2]));
+		float scale = max(scale_x, max(scale_y, scale_z));
+		float min_scale = min(scale_x, min(scale_y, scale_z));
+		bool uniform_scale = scale > 0.0f && min_scale / scale > meshlet_uniform_scale;
+
+		glm::vec3 camera_pos = glm::vec3(glm::inverse(transform) * glm::vec4(frame.camera_pos, 1.0f));
+
+		prim.meshlets.cull(planes, scale, camera_pos, uniform_scale, _cull_scratch);
+		for (const auto& range : _cull_scratch)
+		{
+			vkCmdDrawIndexed(cmd, range.index_count, 1, lod.first_index + range.first_index, prim.vertex_offset, 0);
+		}
 	}
 }
 
 void vlk_model::render_node
 	(
 	size_t							index,
-	const vlk_frame&				frame,
+	vlk_frame&						frame,
 	VkCommandBuffer					cmd,
-	glm::mat4						parent_transform
+	glm::mat4						parent_transform,
+	gpu_model_instance&				instance
 	) const
 {
-	/* Validate index */
-	// TOOD : the GLTF loader should be trusted to provide valid indices
-	if (index >= _gltf->nodes.size())
+	/* Indices were validated at load */
+	const auto& node = _nodes[index];
+	glm::mat4 transform = parent_transform * node.matrix;
+
+	if (node.mesh >= 0)
 	{
-		/* Invalid index */
-		LOG_WARN_FMT("Invalid GLTF node index {0}.", index);
-		return;
+		render_mesh(node.mesh, frame, cmd, transform, instance, node.lod_state);
 	}
 
-	/* Get the node */
-	const auto& node = _gltf->nodes[index];
-
-	/*
-	Compute the transform for this node
-	*/
-	glm::mat4 transform = glm::mat4(parent_transform);
-
-	if (node.matrix.size() == 16)
+	/* Render child nodes */
+	for (auto child_idx : node.children)
 	{
-		// Node uses a transformation matrix
-		auto matrix = glm::make_mat4x4(node.matrix.data());
-		transform = transform * glm::mat4(matrix);
+		render_node(child_idx, frame, cmd, transform, instance);
 	}
-	else
-	{
-		/*
-		Node either uses translation, rotation, and scale vectors, or has no transform
-		M = T * R * S
-		*/
-
-		/* Translation */
-		if (node.translation.size() == 3)
-		{
-			auto translation = glm::vec3(glm::make_vec3(node.translation.data()));
-			transform = glm::translate(transform, translation);
-		}
-
-		/* Rotation */
-		if (node.rotation.size() == 4)
-		{
-			auto rotateQuat = glm::highp_fquat(glm::make_quat(node.rotation.data()));
-			transform = transform * glm::mat4_cast(rotateQuat);
-		}
+}
 
-		/* Scale */
-		if (node.scale.size() == 3)
-		{
-			// TODO : potentially make tinygltf allow float vectors/matrices so don't have to convert all the time.
-			// either that or convert and store manually.
-			auto scale = glm::vec3(glm::make_vec3(node.scale.data()));
-			transform = glm::scale(transform, scale);
-		}
+/**
+Projects mesh units to pixels at the closest point of a primitive's bounds.
+*/
+float vlk_model::get_mesh_to_px
+	(
+	const Primitive&				prim,
+	const vlk_frame&				frame,
+	const glm::mat4&				transform
+	) const
+{
+	/* Bounding sphere in world space */
+	float scale = glm::length(glm::vec3(transform[0]));
+	scale = max(scale, glm::length(glm::vec3(transform[1])));
+	scale = max(scale, glm::length(glm::vec3(transform[2])));
+	glm::vec3 center = glm::vec3(transform * glm::vec4(prim.center, 1.0f));
+	float radius = prim.radius * scale;
+
+	/* Distance to the closest point of the sphere - inside the sphere uses full detail */
+	float dist = glm::length(center - frame.camera_pos) - radius;
+	if (dist <= 0.0f)
+	{
+		return FLT_MAX;
 	}
 
-	/*
-	A node can contain a mesh or a camera, or it can be empty and just define a transform
-	*/
-	if (node.mesh >= 0 && node.mesh < _gltf->meshes.size())
-	{
-		/* Node points to mesh */
-		render_mesh(node.mesh, frame, cmd, transform);
-	}
-	else if (node.camera >= 0 && node.camera < _gltf->cameras.size())
+	/* World units to pixels at that distance */
+	float px_per_unit = fabsf(frame.proj[1][1]) * frame.extent.height * 0.5f / dist;
+	return scale * px_per_unit;
+}
+
+/**
+Picks a LOD for a primitive from its geometric error projected to pixels.
+Uses hysteresis so a primitive near a threshold doesn't flicker between LODs.
+*/
+uint8_t vlk_model::select_lod
+	(
+	const Primitive&				prim,
+	float							mesh_to_px,
+	uint8_t							current
+	) const
+{
+	uint8_t lod_count = (uint8_t)prim.lods.size();
+	if (lod_count <= 1 || mesh_to_px == FLT_MAX)
 	{
-		/* Node points to camera */
+		return 0;
 	}
-	else
+
+	uint8_t lod = current < lod_count ? current : lod_count - 1;
+
+	/* Refine while the current LOD is too coarse */
+	while (lod > 0 && prim.lods[lod].error * mesh_to_px > lod_pixel_error)
 	{
-		/* Transform only */
+		lod--;
 	}
 
-	/* Render child nodes */
-	for (auto childIndex : node.children)
+	/* Coarsen while the next LOD is comfortably under the threshold */
+	while (lod + 1 < lod_count && prim.lods[lod + 1].error * mesh_to_px <= lod_pixel_error * lod_hysteresis)
 	{
-		render_node(childIndex, frame, cmd, transform);
+		lod++;
 	}
+
+	return lod;
 }
 
 }   /* namespace jetz */
@@ -12,10 +12,14 @@ INCLUDES
 #include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
-#include <unordered_map>
 
 #include "jetz/main/common.h"
+#include "jetz/gpu/gpu_gltf.h"
+#include "jetz/gpu/gpu_mesh.h"
+#include "jetz/gpu/gpu_meshlets.h"
 #include "jetz/gpu/gpu_model.h"
+#include "jetz/gpu/vlk/vlk_mesh_arena.h"
+#include "jetz/gpu/vlk/pipelines/vlk_pipeline_create_info.h"
 #include "thirdparty/tinygltf/tiny_gltf.h"
 
 /*=============================================================================
@@ -25,8 +29,9 @@ NAMESPACE
 namespace jetz {
 
 class ecs_transform_component;
+class gpu;
 class gpu_frame;
-class vlk_buffer;
+class gpu_mesh_packer;
 class vlk_device;
 class vlk_frame;
 class vlk_material;
@@ -45,55 +50,16 @@ public:
 	vlk_model
 		(
 		vlk_device&					dev,
-		uptr<tinygltf::Model>		gltf,
+		gpu&						gpu,
+		uptr<gpu_gltf>				gltf,
 		sptr<vlk_pipeline_cache>	pipeline_cache
 		);
 
 	virtual ~vlk_model() override;
 
-	/*-----------------------------------------------------
-	Public Types
-	-----------------------------------------------------*/
-	enum attribute_type
-	{
-		POSITION,
-		NORMAL,
-		TANGENT,
-		TEXCOORD_0,
-		TEXCOORD_1,
-		COLOR_0,
-		JOINTS_0,
-		WEIGHTS_0
-	};
-
 	/*-----------------------------------------------------
 	Public Variables
 	-----------------------------------------------------*/
-	const std::vector<std::string> attribute_names =
-	{
-		"POSITION",
-		"NORMAL",
-		"TANGENT",
-		"TEXCOORD_0",
-		"TEXCOORD_1",
-		"COLOR_0",
-		"JOINTS_0",
-		"WEIGHTS_0"
-	};
-
-	// Locations hard coded in shader right now.
-	// -1 means not used.
-	const std::vector<int> attribute_locations =
-	{
-		0,		// POSITION
-		1,		// NORMAL
-		-1,		// TANGENT
-		2,		// TEXCOORD_0
-		-1,		// TEXCOORD_1
-		-1,		// COLOR_0
-		-1,		// JOINTS_0
-		-1		// WEIGHTS_0
-	};
 
 	/* Material attributes */
 	const char* MAT_PBR_METALLIC_ROUGHNESS = "pbrMetallicRoughness";
@@ -116,7 +82,8 @@ public:
 	jetz::gpu_model Methods
 	-----------------------------------------------------*/
 
-	virtual void render(const gpu_frame& frame, const ecs_transform_component& transform) override;
+	virtual uint64_t get_memory_size() const override;
+	virtual void render(const gpu_frame& frame, const ecs_transform_component& transform, gpu_model_instance& instance) override;
 
 protected:
 
@@ -129,26 +96,62 @@ private:
 	Class to encapsulate GLTF mesh primitives
 	-----------------------------------------------------*/
 
+	class Lod
+	{
+	public:
+		uint32_t					index_count;
+		uint32_t					first_index;	/* first index of the LOD in the arena's index buffer */
+		float						error;			/* geometric error in mesh units */
+	};
+
+	/** A glTF node, flattened at load so the glTF model can be freed. */
+	class Node
+	{
+	public:
+		glm::mat4					matrix;			/* transform relative to the parent node */
+		int32_t						mesh;			/* index into _primitives, or -1 */
+		uint32_t					lod_state;		/* first of the node's entries in gpu_model_instance::lods */
+		std::vector<uint32_t>		children;
+	};
+
 	class Primitive
 	{
 	public:
-		const tinygltf::Primitive&	data;		/* the actual primitive data from the GLTF model */
-		const vlk_gltf_pipeline&	pipeline;	/* pipeline used to render this mesh primitive */
+		const vlk_gltf_pipeline&	pipeline;		/* pipeline used to render this mesh primitive */
 		wptr<vlk_material>			material;
 		VkIndexType					index_type;
-		std::vector<VkBuffer>		input_binding_buffers;
-		std::vector<VkDeviceSize>	input_binding_offsets;
-
-		Primitive(const tinygltf::Primitive& data, const vlk_gltf_pipeline& pipeline)
-			: data(data), pipeline(pipeline), index_type(VK_INDEX_TYPE_UINT16) {}
+		std::vector<Lod>			lods;			/* finest first; always at least one */
+		int32_t						vertex_offset;	/* first vertex of the primitive in the arena's vertex buffer */
+		glm::mat4					dequant;		/* maps quantized positions to mesh space (identity if not quantized) */
+		glm::vec3					center;			/* bounding sphere in mesh space */
+		float						radius;
+		float						uv_density;		/* UV units per mesh unit, for texture mip requests */
+		uint32_t					id;				/* index of the primitive within its mesh */
+		gpu_meshlets				meshlets;		/* LOD 0 clusters for culling; empty for small primitives */
+
+		Primitive(const vlk_gltf_pipeline& pipeline)
+			: pipeline(pipeline), index_type(VK_INDEX_TYPE_UINT16), vertex_offset(0), dequant(1.0f), center(0.0f), radius(0.0f), uv_density(0.0f), id(0) {}
 	};
 
+	/*-----------------------------------------------------
+	Private constants
+	-----------------------------------------------------*/
+
+	/** Switch to a finer LOD when the projected error exceeds this many pixels. */
+	static constexpr float lod_pixel_error = 1.0f;
+
+	/** Only switch to a coarser LOD once its error is this fraction of the threshold. */
+	static constexpr float lod_hysteresis = 0.75f;
+
+	/** Meshlet cone culling needs the min/max axis scale ratio of the transform to be at least this. */
+	static constexpr float meshlet_uniform_scale = 0.99f;
+
 	/*-----------------------------------------------------
 	Private methods
 	-----------------------------------------------------*/
 
-	void create_buffer(int bufferIndex);
 	void create_materials();
+	void create_nodes();
 	void create_primitives();
 	void create_textures();
 	void destroy_buffers();
@@ -156,28 +159,52 @@ private:
 	void destroy_primitives();
 	void destroy_textures();
 
-	VkFormat					get_vk_format(int gltfType, int gltfComponentType) const;
-	VkIndexType					get_vk_index_type(int gltfComponentType) const;
+	vlk_pipeline_create_info	get_pipeline_create_info() const;
+	uint32_t					get_vertex_stride() const;
 	wptr<vlk_material>			get_vulkan_material(int index);
 	wptr<vlk_texture>			get_vulkan_texture(int index);
 	void						load_material(const tinygltf::Material& mat);
-	void						load_primitive(const tinygltf::Primitive& prim, uint32_t mesh_idx);
 	void						load_texture(const tinygltf::Image& image);
 
+	void load_primitive
+		(
+		gpu_mesh_packer&				packer,
+		const tinygltf::Primitive&		prim,
+		uint32_t						mesh_idx
+		);
+
 	void render_mesh
 		(
 		size_t							index,
-		const vlk_frame&				frame,
+		vlk_frame&						frame,
 		VkCommandBuffer					cmd,
-		glm::mat4						transform
+		glm::mat4						transform,
+		gpu_model_instance&				instance,
+		uint32_t						lod_state
 		) const;
 
 	void render_node
 		(
 		size_t							index,
-		const vlk_frame&				frame,
+		vlk_frame&						frame,
 		VkCommandBuffer					cmd,
-		glm::mat4						parent_transform
+		glm::mat4						parent_transform,
+		gpu_model_instance&				instance
+		) const;
+
+	/** Pixels per mesh unit at the primitive's closest point, or FLT_MAX if the camera is inside it. */
+	float get_mesh_to_px
+		(
+		const Primitive&				prim,
+		const vlk_frame&				frame,
+		const glm::mat4&				transform
+		) const;
+
+	uint8_t select_lod
+		(
+		const Primitive&				prim,
+		float							mesh_to_px,
+		uint8_t							current
 		) const;
 
 	/*-----------------------------------------------------
@@ -188,18 +215,36 @@ private:
 	Dependencies
 	*/
 	vlk_device&							_device;
-	uptr<tinygltf::Model>				_gltf;
+	gpu&								_gpu;
+	uptr<gpu_gltf>						_gltf;				/* Source model, only held while loading */
 	sptr<vlk_pipeline_cache>			_pipeline_cache;
 
+	/*
+	Options
+	*/
+	bool								_quantized;			/* Vertices are stored as gpu_mesh_quantized_vertex */
+
 	/*
 	Create/destroy
 	*/
-	std::unordered_map<int, uptr<vlk_buffer>>	_buffers;	/* Dictionary of buffers keyed by buffer index (from the gltf file) */
+	vlk_mesh_range						_index_range;		/* Indices for all primitives, packed tightly */
+	vlk_mesh_range						_vertex_range;		/* Interleaved (possibly quantized) vertices for all primitives */
+	uint64_t							_upload_value;		/* Staging ring value of the geometry upload */
 	std::vector<sptr<vlk_material>>		_materials;
 	std::vector<sptr<vlk_texture>>		_textures;
 
 	/* A list of primitives for each mesh */
 	std::vector<std::vector<Primitive>>	_primitives;
+
+	/* Number of LOD state entries an instance needs - one per primitive of each node */
+	uint32_t							_lod_state_count;
+
+	/* Node hierarchy and the root nodes of all scenes */
+	std::vector<Node>					_nodes;
+	std::vector<uint32_t>				_root_nodes;
+
+	/* Scratch list of visible meshlet ranges, reused between draws */
+	mutable std::vector<gpu_index_range>	_cull_scratch;
 };
 
 }   /* namespace jetz */
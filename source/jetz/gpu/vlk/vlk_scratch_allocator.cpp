@@ -0,0 +1,136 @@
+/*=============================================================================
+vlk_scratch_allocator.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/vlk/vlk_buffer.h"
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/vlk_gpu.h"
+#include "jetz/gpu/vlk/vlk_scratch_allocator.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+static const VkBufferUsageFlags scratch_usage =
+	VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+	| VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	| VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+	| VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_scratch_allocator::vlk_scratch_allocator(vlk_device& device, VkDeviceSize size)
+	:
+	_device(device),
+	_size(size),
+	_high_water(0)
+{
+	const auto& limits = device.get_gpu().get_properties().limits;
+	_uniform_alignment = limits.minUniformBufferOffsetAlignment;
+	_storage_alignment = limits.minStorageBufferOffsetAlignment;
+
+	_frames.resize(gpu::num_frame_buf);
+	for (auto& frame : _frames)
+	{
+		frame.buffer = uptr<vlk_buffer>(new vlk_buffer(device, size, scratch_usage, VMA_MEMORY_USAGE_CPU_TO_GPU));
+		frame.mapped = (uint8_t*)frame.buffer->get_mapped();
+		frame.used = 0;
+		frame.requested = 0;
+		frame.overflowed = false;
+	}
+}
+
+vlk_scratch_allocator::~vlk_scratch_allocator()
+{
+	LOG_INFO_FMT("Frame scratch high-water mark: {0} of {1} bytes.", _high_water, _size);
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+vlk_scratch_range vlk_scratch_allocator::allocate(uint8_t frame_idx, VkDeviceSize size, VkDeviceSize alignment)
+{
+	auto& frame = _frames[frame_idx];
+
+	VkDeviceSize offset = (frame.used + alignment - 1) & ~(alignment - 1);
+	frame.requested += (offset - frame.used) + size;
+	_high_water = (std::max)(_high_water, frame.requested);
+
+	vlk_scratch_range range = {};
+	if (offset + size > _size)
+	{
+		if (!frame.overflowed)
+		{
+			LOG_WARN_FMT("Frame scratch buffer is full ({0} bytes) - raise its size.", _size);
+			frame.overflowed = true;
+		}
+
+		return range;
+	}
+
+	frame.used = offset + size;
+
+	range.buffer = frame.buffer->get_handle();
+	range.offset = offset;
+	range.data = frame.mapped + offset;
+	return range;
+}
+
+vlk_scratch_range vlk_scratch_allocator::allocate_uniform(uint8_t frame_idx, VkDeviceSize size)
+{
+	return allocate(frame_idx, size, _uniform_alignment);
+}
+
+vlk_scratch_range vlk_scratch_allocator::allocate_storage(uint8_t frame_idx, VkDeviceSize size)
+{
+	return allocate(frame_idx, size, _storage_alignment);
+}
+
+void vlk_scratch_allocator::flush(uint8_t frame_idx)
+{
+	auto& frame = _frames[frame_idx];
+	if (frame.used > 0)
+	{
+		frame.buffer->flush(0, frame.used);
+	}
+}
+
+VkBuffer vlk_scratch_allocator::get_buffer(uint8_t frame_idx) const
+{
+	return _frames[frame_idx].buffer->get_handle();
+}
+
+VkDeviceSize vlk_scratch_allocator::get_high_water() const
+{
+	return _high_water;
+}
+
+VkDeviceSize vlk_scratch_allocator::get_size() const
+{
+	return _size;
+}
+
+void vlk_scratch_allocator::reset(uint8_t frame_idx)
+{
+	auto& frame = _frames[frame_idx];
+	frame.used = 0;
+	frame.requested = 0;
+	frame.overflowed = false;
+}
+
+}   /* namespace jetz */
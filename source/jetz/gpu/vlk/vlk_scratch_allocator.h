@@ -0,0 +1,133 @@
+/*=============================================================================
+vlk_scratch_allocator.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "jetz/main/common.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_buffer;
+class vlk_device;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+A range of a frame's scratch buffer.
+*/
+struct vlk_scratch_range
+{
+	VkBuffer					buffer;			/* the frame's scratch buffer, null if the allocation failed */
+	VkDeviceSize				offset;			/* byte offset of the range in the buffer */
+	void*						data;			/* mapped memory of the range */
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Linear allocator for data that is only used by one frame - per-view uniforms,
+imgui vertices, and so on. Each frame in flight has a persistently mapped
+host visible buffer. Allocations bump a pointer through it and are written
+directly; the buffer is bound once per descriptor set and ranges are selected
+with dynamic offsets. A frame's buffer is reset when its fence has been
+waited on.
+
+The largest amount requested by a frame is tracked as a high-water mark, to
+size the buffers.
+*/
+class vlk_scratch_allocator {
+
+public:
+
+	/** Size of each frame's scratch buffer in bytes. */
+	static const VkDeviceSize default_size = 4 * 1024 * 1024;
+
+	vlk_scratch_allocator(vlk_device& device, VkDeviceSize size = default_size);
+	~vlk_scratch_allocator();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Allocates a range of the frame's scratch buffer. Logs a warning and
+	returns a range with a null buffer if the buffer is full.
+
+	@param frame_idx The frame in flight the data is used by.
+	@param size The size of the range in bytes.
+	@param alignment The offset is a multiple of this. Must be a power of two.
+	*/
+	vlk_scratch_range allocate(uint8_t frame_idx, VkDeviceSize size, VkDeviceSize alignment);
+
+	/** Allocates a range that can be bound as a dynamic uniform buffer. */
+	vlk_scratch_range allocate_uniform(uint8_t frame_idx, VkDeviceSize size);
+
+	/** Allocates a range that can be bound as a dynamic storage buffer. */
+	vlk_scratch_range allocate_storage(uint8_t frame_idx, VkDeviceSize size);
+
+	/**
+	Flushes the frame's writes if the memory isn't host coherent. Call
+	before submitting the frame's command buffers.
+	*/
+	void flush(uint8_t frame_idx);
+
+	/** Gets a frame's scratch buffer, for writing descriptor sets. */
+	VkBuffer get_buffer(uint8_t frame_idx) const;
+
+	/** Gets the most bytes requested by a single frame so far. */
+	VkDeviceSize get_high_water() const;
+
+	/** Gets the size of each frame's scratch buffer. */
+	VkDeviceSize get_size() const;
+
+	/**
+	Frees all of a frame's allocations. Call at the start of the frame, after
+	its fence has been waited on.
+	*/
+	void reset(uint8_t frame_idx);
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct frame_scratch
+	{
+		uptr<vlk_buffer>		buffer;
+		uint8_t*				mapped;
+		VkDeviceSize			used;			/* bytes allocated this frame, including padding */
+		VkDeviceSize			requested;		/* bytes requested this frame, including failed allocations */
+		bool					overflowed;		/* an allocation failed this frame */
+	};
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+	VkDeviceSize					_size;
+	VkDeviceSize					_high_water;
+	VkDeviceSize					_uniform_alignment;
+	VkDeviceSize					_storage_alignment;
+	std::vector<frame_scratch>		_frames;
+};
+
+}   /* namespace jetz */
@@ -0,0 +1,1061 @@
+/*=============================================================================
+vlk_staging_ring.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Buffer copies are split so one upload never needs more than this fraction of the ring */
+static const VkDeviceSize max_copy_fraction = 4;
+
+/* Alignment of copy sources within the ring - a multiple of the texel sizes used */
+static const VkDeviceSize copy_alignment = 16;
+
+/* Access by anything that reads uploaded data */
+static const VkAccessFlags read_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+	| VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Generates mip levels [first_level, level_count) by blitting each level from
+the one before it. Levels before first_level must be in
+VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, later levels are undefined. Leaves every
+level in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+*/
+static void record_mip_blits
+	(
+	VkCommandBuffer			cmd_buf,
+	VkImage					image,
+	uint32_t				width,
+	uint32_t				height,
+	uint32_t				first_level,
+	uint32_t				level_count
+	)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	/* Generated levels start undefined */
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.subresourceRange.baseMipLevel = first_level;
+	barrier.subresourceRange.levelCount = level_count - first_level;
+
+	vkCmdPipelineBarrier(
+		cmd_buf,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, NULL,
+		0, NULL,
+		1, &barrier);
+
+	for (uint32_t i = first_level; i < level_count; ++i)
+	{
+		VkImageBlit blit = {};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1].x = (int32_t)(std::max)(width >> (i - 1), 1u);
+		blit.srcOffsets[1].y = (int32_t)(std::max)(height >> (i - 1), 1u);
+		blit.srcOffsets[1].z = 1;
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = i;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1].x = (int32_t)(std::max)(width >> i, 1u);
+		blit.dstOffsets[1].y = (int32_t)(std::max)(height >> i, 1u);
+		blit.dstOffsets[1].z = 1;
+
+		vkCmdBlitImage(
+			cmd_buf,
+			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR);
+
+		/* The level is the source of the next blit */
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.subresourceRange.baseMipLevel = i;
+		barrier.subresourceRange.levelCount = 1;
+
+		vkCmdPipelineBarrier(
+			cmd_buf,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, NULL,
+			0, NULL,
+			1, &barrier);
+	}
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = level_count;
+
+	vkCmdPipelineBarrier(
+		cmd_buf,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		0, NULL,
+		0, NULL,
+		1, &barrier);
+}
+
+/**
+Copies mip levels [src.level, src.level + level_count) of an image into
+another image, starting at dst_level, or into a buffer, tightly packed. The
+source levels must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and are left
+in it. Destination image levels start undefined and end up in
+VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; buffer data is made visible to the
+host.
+*/
+static void record_level_copy
+	(
+	VkCommandBuffer				cmd_buf,
+	const vlk_image_source&		src,
+	uint32_t					level_count,
+	uint32_t					texel_size,
+	VkImage						dst_image,
+	uint32_t					dst_level,
+	VkBuffer					dst_buffer
+	)
+{
+	VkImageMemoryBarrier barriers[2];
+	memset(barriers, 0, sizeof(barriers));
+
+	for (auto& barrier : barriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = level_count;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+	}
+
+	/* Source levels may still be sampled by earlier frames */
+	barriers[0].image = src.image;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].subresourceRange.baseMipLevel = src.level;
+
+	barriers[1].image = dst_image;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].subresourceRange.baseMipLevel = dst_level;
+
+	uint32_t barrier_count = dst_image != VK_NULL_HANDLE ? 2 : 1;
+
+	vkCmdPipelineBarrier(
+		cmd_buf,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, NULL,
+		0, NULL,
+		barrier_count, barriers);
+
+	VkDeviceSize buffer_offset = 0;
+
+	for (uint32_t i = 0; i < level_count; ++i)
+	{
+		uint32_t width = (std::max)(src.width >> i, 1u);
+		uint32_t height = (std::max)(src.height >> i, 1u);
+
+		if (dst_image != VK_NULL_HANDLE)
+		{
+			VkImageCopy region = {};
+			region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.srcSubresource.mipLevel = src.level + i;
+			region.srcSubresource.baseArrayLayer = 0;
+			region.srcSubresource.layerCount = 1;
+			region.dstSubresource = region.srcSubresource;
+			region.dstSubresource.mipLevel = dst_level + i;
+			region.extent.width = width;
+			region.extent.height = height;
+			region.extent.depth = 1;
+
+			vkCmdCopyImage(
+				cmd_buf,
+				src.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &region);
+		}
+		else
+		{
+			VkBufferImageCopy region = {};
+			region.bufferOffset = buffer_offset;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = src.level + i;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent.width = width;
+			region.imageExtent.height = height;
+			region.imageExtent.depth = 1;
+
+			vkCmdCopyImageToBuffer(cmd_buf, src.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst_buffer, 1, &region);
+			buffer_offset += (VkDeviceSize)width * height * texel_size;
+		}
+	}
+
+	/* Back to sampling */
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkBufferMemoryBarrier buffer_barrier = {};
+	buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.buffer = dst_buffer;
+	buffer_barrier.offset = 0;
+	buffer_barrier.size = buffer_offset;
+
+	uint32_t buffer_barrier_count = dst_buffer != VK_NULL_HANDLE ? 1 : 0;
+
+	vkCmdPipelineBarrier(
+		cmd_buf,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		0, NULL,
+		buffer_barrier_count, &buffer_barrier,
+		barrier_count, barriers);
+}
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_staging_ring::vlk_staging_ring(vlk_device& device, VkDeviceSize size)
+	:
+	_device(device),
+	_buffer(VK_NULL_HANDLE),
+	_allocation(VK_NULL_HANDLE),
+	_mapped(NULL),
+	_size(size),
+	_head(0),
+	_used(0),
+	_transfer_queue(device.get_transfer_family_idx() >= 0),
+	_queue(VK_NULL_HANDLE),
+	_cmd_pool(VK_NULL_HANDLE),
+	_acquire_cmd_pool(VK_NULL_HANDLE),
+	_timeline(VK_NULL_HANDLE),
+	_next_value(1),
+	_acquired_value(0),
+	_completed_value(0),
+	_get_counter_value(NULL),
+	_wait_semaphores(NULL),
+	_current()
+{
+	VkDevice dev = _device.get_handle();
+
+	/*
+	Create the ring buffer, mapped for its whole lifetime
+	*/
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = size;
+	buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo alloc_info = {};
+	alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+	alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo info = {};
+	if (vmaCreateBuffer(_device.get_allocator(), &buffer_info, &alloc_info, &_buffer, &_allocation, &info) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create staging ring buffer.");
+	}
+
+	_mapped = (uint8_t*)info.pMappedData;
+
+	/*
+	Upload command buffers are reset individually when their batch is reused
+	*/
+	int family = _transfer_queue ? _device.get_transfer_family_idx() : _device.get_gfx_family_idx();
+	_queue = _transfer_queue ? _device.get_transfer_queue() : _device.get_gfx_queue();
+
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	if (vkCreateCommandPool(dev, &pool_info, NULL, &_cmd_pool) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create upload command pool.");
+	}
+
+	if (!_transfer_queue)
+	{
+		return;
+	}
+
+	/*
+	The graphics queue acquires ownership of uploads from its own pool, and
+	waits on the transfer queue through a timeline semaphore
+	*/
+	pool_info.queueFamilyIndex = _device.get_gfx_family_idx();
+	if (vkCreateCommandPool(dev, &pool_info, NULL, &_acquire_cmd_pool) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create upload command pool.");
+	}
+
+	VkSemaphoreTypeCreateInfoKHR type_info = {};
+	type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	type_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphore_info = {};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = &type_info;
+
+	if (vkCreateSemaphore(dev, &semaphore_info, NULL, &_timeline) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to create upload timeline semaphore.");
+	}
+
+	_get_counter_value = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(dev, "vkGetSemaphoreCounterValueKHR");
+	_wait_semaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(dev, "vkWaitSemaphoresKHR");
+	if (!_get_counter_value || !_wait_semaphores)
+	{
+		LOG_FATAL("Failed to get timeline semaphore functions.");
+	}
+}
+
+vlk_staging_ring::~vlk_staging_ring()
+{
+	VkDevice device = _device.get_handle();
+
+	/* Uploads never submitted are dropped - their targets are being destroyed too */
+	if (_current.cmd_buf != VK_NULL_HANDLE)
+	{
+		vkEndCommandBuffer(_current.cmd_buf);
+		_free.push_back(_current);
+	}
+
+	/* The device is idle by now. Batches never acquired have nothing left to wait on. */
+	for (auto& batch : _in_flight)
+	{
+		if (batch.acquired)
+		{
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		}
+
+		_free.push_back(batch);
+	}
+
+	_in_flight.clear();
+
+	for (auto& batch : _free)
+	{
+		vkDestroyFence(device, batch.fence, NULL);
+	}
+
+	/* Frees the command buffers too */
+	vkDestroyCommandPool(device, _cmd_pool, NULL);
+
+	if (_transfer_queue)
+	{
+		vkDestroyCommandPool(device, _acquire_cmd_pool, NULL);
+		vkDestroySemaphore(device, _timeline, NULL);
+	}
+
+	vmaDestroyBuffer(_device.get_allocator(), _buffer, _allocation);
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+uint64_t vlk_staging_ring::copy_to_buffer
+	(
+	VkBuffer				dst,
+	VkDeviceSize			dst_offset,
+	const void*				data,
+	VkDeviceSize			size
+	)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkDeviceSize max_copy = _size / max_copy_fraction;
+	VkDeviceSize copied = 0;
+
+	while (copied < size)
+	{
+		VkDeviceSize chunk = (std::min)(size - copied, max_copy);
+		VkDeviceSize offset = stage((const uint8_t*)data + copied, chunk, copy_alignment);
+
+		VkBufferCopy region = {};
+		region.srcOffset = offset;
+		region.dstOffset = dst_offset + copied;
+		region.size = chunk;
+		vkCmdCopyBuffer(begin_batch(), _buffer, dst, 1, &region);
+
+		if (_transfer_queue)
+		{
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = _device.get_transfer_family_idx();
+			barrier.dstQueueFamilyIndex = _device.get_gfx_family_idx();
+			barrier.buffer = dst;
+			barrier.offset = region.dstOffset;
+			barrier.size = chunk;
+			_current.buffer_ownership.push_back(barrier);
+		}
+
+		copied += chunk;
+	}
+
+	/* Later batches are acquired after earlier ones, so the last chunk's value covers the whole copy */
+	return _current.value;
+}
+
+uint64_t vlk_staging_ring::copy_to_image
+	(
+	VkImage									image,
+	const std::vector<vlk_image_level>&		levels,
+	uint32_t								texel_size,
+	uint32_t								mip_levels,
+	const vlk_image_source*					src
+	)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	/* Levels past the uploaded ones are copied from src, or generated */
+	bool copy = src != NULL && mip_levels > levels.size();
+	bool generate = src == NULL && mip_levels > levels.size();
+
+	if (!levels.empty())
+	{
+		record_image_upload(image, levels, texel_size, generate);
+	}
+
+	if (copy)
+	{
+		level_copy c = {};
+		c.src = *src;
+		c.level_count = mip_levels - (uint32_t)levels.size();
+		c.texel_size = texel_size;
+		c.dst_image = image;
+		c.dst_level = (uint32_t)levels.size();
+
+		/* The source image is owned by the graphics queue */
+		if (_transfer_queue)
+		{
+			begin_batch();
+			_current.level_copies.push_back(c);
+		}
+		else
+		{
+			record_level_copy(begin_batch(), c.src, c.level_count, c.texel_size, c.dst_image, c.dst_level, VK_NULL_HANDLE);
+		}
+	}
+
+	if (generate)
+	{
+		mip_generation gen = {};
+		gen.image = image;
+		gen.width = levels[0].width;
+		gen.height = levels[0].height;
+		gen.first_level = (uint32_t)levels.size();
+		gen.level_count = mip_levels;
+
+		if (_transfer_queue)
+		{
+			_current.mip_generations.push_back(gen);
+		}
+		else
+		{
+			record_mip_blits(_current.cmd_buf, gen.image, gen.width, gen.height, gen.first_level, gen.level_count);
+		}
+	}
+
+	begin_batch();
+	return _current.value;
+}
+
+uint64_t vlk_staging_ring::copy_from_image
+	(
+	const vlk_image_source&		src,
+	uint32_t					level_count,
+	uint32_t					texel_size,
+	VkBuffer					dst
+	)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	level_copy c = {};
+	c.src = src;
+	c.level_count = level_count;
+	c.texel_size = texel_size;
+	c.dst_buffer = dst;
+
+	/* The source image is owned by the graphics queue */
+	if (_transfer_queue)
+	{
+		begin_batch();
+		_current.level_copies.push_back(c);
+	}
+	else
+	{
+		record_level_copy(begin_batch(), c.src, c.level_count, c.texel_size, VK_NULL_HANDLE, 0, c.dst_buffer);
+	}
+
+	return _current.value;
+}
+
+void vlk_staging_ring::flush()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_current.cmd_buf != VK_NULL_HANDLE)
+	{
+		submit_batch();
+	}
+
+	acquire_batches(false);
+	retire_batches(false);
+}
+
+void vlk_staging_ring::finish()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_current.cmd_buf != VK_NULL_HANDLE)
+	{
+		submit_batch();
+	}
+
+	while (!_in_flight.empty())
+	{
+		acquire_batches(true);
+		retire_batches(true);
+	}
+}
+
+bool vlk_staging_ring::is_complete(uint64_t value) const
+{
+	return value <= _completed_value;
+}
+
+bool vlk_staging_ring::is_ready(uint64_t value) const
+{
+	/* Uploads on the graphics queue are ordered before the frame that uses them */
+	return !_transfer_queue || value <= _acquired_value;
+}
+
+void vlk_staging_ring::wait(uint64_t value)
+{
+	if (is_ready(value))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	/* The upload may not have been submitted yet */
+	if (_current.cmd_buf != VK_NULL_HANDLE && _current.value <= value)
+	{
+		submit_batch();
+	}
+
+	while (_acquired_value < value)
+	{
+		bool pending = false;
+		for (const auto& batch : _in_flight)
+		{
+			pending |= !batch.acquired;
+		}
+
+		if (!pending)
+		{
+			break;
+		}
+
+		acquire_batches(true);
+	}
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void vlk_staging_ring::record_image_upload
+	(
+	VkImage									image,
+	const std::vector<vlk_image_level>&		levels,
+	uint32_t								texel_size,
+	bool									generate
+	)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = (uint32_t)levels.size();
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(
+		begin_batch(),
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, NULL,
+		0, NULL,
+		1, &barrier);
+
+	/*
+	Copy each level. Levels too big for one ring allocation are copied in
+	bands of rows. If the ring fills up part way the batch is submitted and
+	the copies continue in the next one, which the same queue runs in order.
+	*/
+	VkDeviceSize max_copy = _size / max_copy_fraction;
+
+	for (uint32_t i = 0; i < levels.size(); ++i)
+	{
+		const auto& level = levels[i];
+		VkDeviceSize row_size = (VkDeviceSize)level.width * texel_size;
+		uint32_t rows_per_copy = (uint32_t)(std::max)(max_copy / row_size, (VkDeviceSize)1);
+
+		for (uint32_t row = 0; row < level.height; row += rows_per_copy)
+		{
+			uint32_t rows = (std::min)(rows_per_copy, level.height - row);
+			VkDeviceSize offset = stage((const uint8_t*)level.data + row * row_size, rows * row_size, copy_alignment);
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = offset;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = i;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset.y = (int32_t)row;
+			region.imageExtent.width = level.width;
+			region.imageExtent.height = rows;
+			region.imageExtent.depth = 1;
+
+			vkCmdCopyBufferToImage(begin_batch(), _buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		}
+	}
+
+	/* Copied levels become blit sources if the rest of the chain is generated */
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = generate ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	if (_transfer_queue)
+	{
+		/* The transition happens as part of the ownership transfer. Blits need the graphics queue. */
+		barrier.srcQueueFamilyIndex = _device.get_transfer_family_idx();
+		barrier.dstQueueFamilyIndex = _device.get_gfx_family_idx();
+		_current.image_ownership.push_back(barrier);
+	}
+	else
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = generate ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			_current.cmd_buf,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, generate ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0,
+			0, NULL,
+			0, NULL,
+			1, &barrier);
+	}
+}
+
+bool vlk_staging_ring::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	if (size > _size)
+	{
+		return false;
+	}
+
+	for (;;)
+	{
+		/* Allocations are contiguous - wrap to the start if it doesn't fit at the end */
+		VkDeviceSize aligned = (_head + alignment - 1) & ~(alignment - 1);
+		VkDeviceSize start = aligned + size > _size ? 0 : aligned;
+		VkDeviceSize needed = (start == 0 ? _size - _head : aligned - _head) + size;
+
+		if (_used == 0)
+		{
+			/* Empty ring - start over at the beginning */
+			_head = 0;
+			start = 0;
+			needed = size;
+		}
+
+		if (_used + needed <= _size)
+		{
+			offset = start;
+			_head = start + size;
+			_used += needed;
+			begin_batch();
+			_current.size += needed;
+			return true;
+		}
+
+		/* Ring is full. Make sure there's a batch to wait on, then wait for the oldest one. */
+		if (_in_flight.empty())
+		{
+			submit_batch();
+		}
+
+		acquire_batches(true);
+		retire_batches(true);
+	}
+}
+
+VkDeviceSize vlk_staging_ring::stage(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize offset;
+	if (!allocate(size, alignment, offset))
+	{
+		LOG_FATAL("Staging ring allocation failed.");
+	}
+
+	memcpy(_mapped + offset, data, size);
+	return offset;
+}
+
+VkCommandBuffer vlk_staging_ring::begin_batch()
+{
+	if (_current.cmd_buf != VK_NULL_HANDLE)
+	{
+		return _current.cmd_buf;
+	}
+
+	VkDevice device = _device.get_handle();
+
+	if (!_free.empty())
+	{
+		_current = _free.back();
+		_free.pop_back();
+
+		vkResetCommandBuffer(_current.cmd_buf, 0);
+		vkResetFences(device, 1, &_current.fence);
+	}
+	else
+	{
+		VkCommandBufferAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandPool = _cmd_pool;
+		alloc_info.commandBufferCount = 1;
+
+		VkFenceCreateInfo fence_info = {};
+		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkAllocateCommandBuffers(device, &alloc_info, &_current.cmd_buf) != VK_SUCCESS
+			|| vkCreateFence(device, &fence_info, NULL, &_current.fence) != VK_SUCCESS)
+		{
+			LOG_FATAL("Failed to create upload batch.");
+		}
+
+		if (_transfer_queue)
+		{
+			alloc_info.commandPool = _acquire_cmd_pool;
+			if (vkAllocateCommandBuffers(device, &alloc_info, &_current.acquire_cmd_buf) != VK_SUCCESS)
+			{
+				LOG_FATAL("Failed to create upload batch.");
+			}
+		}
+	}
+
+	_current.size = 0;
+	_current.value = _next_value++;
+	_current.acquired = false;
+	_current.buffer_ownership.clear();
+	_current.image_ownership.clear();
+	_current.mip_generations.clear();
+	_current.level_copies.clear();
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(_current.cmd_buf, &begin_info);
+
+	/* Don't overwrite buffers still being read by earlier submissions */
+	vkCmdPipelineBarrier(
+		_current.cmd_buf,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, NULL,
+		0, NULL,
+		0, NULL);
+
+	return _current.cmd_buf;
+}
+
+void vlk_staging_ring::submit_batch()
+{
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &_current.cmd_buf;
+
+	VkTimelineSemaphoreSubmitInfoKHR timeline_info = {};
+	timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timeline_info.signalSemaphoreValueCount = 1;
+	timeline_info.pSignalSemaphoreValues = &_current.value;
+
+	VkFence fence = _current.fence;
+
+	if (_transfer_queue)
+	{
+		/* Release the uploaded ranges to the graphics queue */
+		for (auto& barrier : _current.buffer_ownership)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+
+		for (auto& barrier : _current.image_ownership)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+
+		vkCmdPipelineBarrier(
+			_current.cmd_buf,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, NULL,
+			(uint32_t)_current.buffer_ownership.size(), _current.buffer_ownership.data(),
+			(uint32_t)_current.image_ownership.size(), _current.image_ownership.data());
+
+		/* The fence is signaled by the acquire */
+		submit_info.pNext = &timeline_info;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &_timeline;
+		fence = VK_NULL_HANDLE;
+	}
+	else
+	{
+		/*
+		Make the copies visible to everything submitted after this batch. Work
+		later in submission order on the same queue is covered by the barrier, so
+		the frame doesn't need to wait on the batch's fence.
+		*/
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = read_access;
+
+		vkCmdPipelineBarrier(
+			_current.cmd_buf,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			1, &barrier,
+			0, NULL,
+			0, NULL);
+
+		_current.acquired = true;
+	}
+
+	if (vkEndCommandBuffer(_current.cmd_buf) != VK_SUCCESS)
+	{
+		LOG_FATAL("Failed to record upload command buffer.");
+	}
+
+	{
+		std::lock_guard<std::mutex> queue_lock(_device.get_queue_mutex());
+		if (vkQueueSubmit(_queue, 1, &submit_info, fence) != VK_SUCCESS)
+		{
+			LOG_FATAL("Failed to submit upload command buffer.");
+		}
+	}
+
+	_in_flight.push_back(_current);
+	_current = upload_batch();
+}
+
+void vlk_staging_ring::acquire_batches(bool wait)
+{
+	if (!_transfer_queue)
+	{
+		return;
+	}
+
+	VkDevice device = _device.get_handle();
+
+	for (auto& batch : _in_flight)
+	{
+		if (batch.acquired)
+		{
+			continue;
+		}
+
+		if (wait)
+		{
+			VkSemaphoreWaitInfoKHR wait_info = {};
+			wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+			wait_info.semaphoreCount = 1;
+			wait_info.pSemaphores = &_timeline;
+			wait_info.pValues = &batch.value;
+			_wait_semaphores(device, &wait_info, UINT64_MAX);
+			wait = false;
+		}
+
+		/* Acquire in order, and only batches whose copies are done so the graphics queue never stalls */
+		uint64_t completed = 0;
+		_get_counter_value(device, _timeline, &completed);
+		if (completed < batch.value)
+		{
+			break;
+		}
+
+		/*
+		Acquire the uploaded ranges on the graphics queue. The submission waits
+		on the batch's timeline value - already reached, but it's what orders
+		the release before the acquire.
+		*/
+		for (auto& barrier : batch.buffer_ownership)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = read_access;
+		}
+
+		for (auto& barrier : batch.image_ownership)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = barrier.newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+				? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT;
+		}
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkResetCommandBuffer(batch.acquire_cmd_buf, 0);
+		vkBeginCommandBuffer(batch.acquire_cmd_buf, &begin_info);
+
+		vkCmdPipelineBarrier(
+			batch.acquire_cmd_buf,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			0, NULL,
+			(uint32_t)batch.buffer_ownership.size(), batch.buffer_ownership.data(),
+			(uint32_t)batch.image_ownership.size(), batch.image_ownership.data());
+
+		for (const auto& gen : batch.mip_generations)
+		{
+			record_mip_blits(batch.acquire_cmd_buf, gen.image, gen.width, gen.height, gen.first_level, gen.level_count);
+		}
+
+		for (const auto& c : batch.level_copies)
+		{
+			record_level_copy(batch.acquire_cmd_buf, c.src, c.level_count, c.texel_size, c.dst_image, c.dst_level, c.dst_buffer);
+		}
+
+		if (vkEndCommandBuffer(batch.acquire_cmd_buf) != VK_SUCCESS)
+		{
+			LOG_FATAL("Failed to record upload acquire command buffer.");
+		}
+
+		VkTimelineSemaphoreSubmitInfoKHR timeline_info = {};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timeline_info.waitSemaphoreValueCount = 1;
+		timeline_info.pWaitSemaphoreValues = &batch.value;
+
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_info;
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = &_timeline;
+		submit_info.pWaitDstStageMask = &wait_stage;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &batch.acquire_cmd_buf;
+
+		{
+			std::lock_guard<std::mutex> queue_lock(_device.get_queue_mutex());
+			if (vkQueueSubmit(_device.get_gfx_queue(), 1, &submit_info, batch.fence) != VK_SUCCESS)
+			{
+				LOG_FATAL("Failed to submit upload acquire command buffer.");
+			}
+		}
+
+		batch.acquired = true;
+		_acquired_value = batch.value;
+	}
+}
+
+void vlk_staging_ring::retire_batches(bool wait)
+{
+	VkDevice device = _device.get_handle();
+
+	if (wait && !_in_flight.empty() && _in_flight.front().acquired)
+	{
+		vkWaitForFences(device, 1, &_in_flight.front().fence, VK_TRUE, UINT64_MAX);
+	}
+
+	/* Batches finish in submission order */
+	while (!_in_flight.empty()
+		&& _in_flight.front().acquired
+		&& vkGetFenceStatus(device, _in_flight.front().fence) == VK_SUCCESS)
+	{
+		_used -= _in_flight.front().size;
+		_completed_value = _in_flight.front().value;
+		_free.push_back(_in_flight.front());
+		_in_flight.pop_front();
+	}
+}
+
+}   /* namespace jetz */
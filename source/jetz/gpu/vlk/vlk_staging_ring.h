@@ -0,0 +1,313 @@
+/*=============================================================================
+vlk_staging_ring.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "thirdparty/vma/vma.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_device;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+Tightly packed pixels of one mip level.
+*/
+struct vlk_image_level
+{
+	const void*					data;
+	uint32_t					width;
+	uint32_t					height;
+};
+
+/**
+Mip levels of an existing image that are copied on the graphics queue. The
+image must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, owned by the
+graphics queue, and have VK_IMAGE_USAGE_TRANSFER_SRC_BIT. It must stay alive
+until is_complete returns true for the copy.
+*/
+struct vlk_image_source
+{
+	VkImage						image;
+	uint32_t					level;		/* first mip level to copy */
+	uint32_t					width;		/* extent of that level */
+	uint32_t					height;
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Persistently mapped staging memory used as a ring buffer for uploads to
+device local memory. Uploads are sub-allocated from the ring and recorded
+into a shared upload command buffer, which is submitted once per frame with
+its own fence. Ring space is reclaimed once a batch's fence signals, so in
+steady state uploads never wait on the queue.
+
+If the device has a separate transfer queue, batches are submitted there and
+signal a timeline semaphore. Once a batch's value is reached, ownership of
+the uploaded resources is transferred to the graphics queue, which waits on
+that value only. Rendering keeps going while uploads are in flight; use
+is_ready to check whether an upload can be used yet.
+
+Uploads may be recorded from any thread. Batches may be submitted from any
+of them too, so submits hold the device's queue lock.
+*/
+class vlk_staging_ring {
+
+public:
+
+	/** Size of the staging ring in bytes. */
+	static const VkDeviceSize default_size = 32 * 1024 * 1024;
+
+	vlk_staging_ring(vlk_device& device, VkDeviceSize size = default_size);
+	~vlk_staging_ring();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Records a copy of data into a buffer. The copy runs when the current
+	batch is submitted.
+
+	@param dst The destination buffer.
+	@param dst_offset The offset in the destination buffer.
+	@param data The data to copy.
+	@param size The size of the data in bytes.
+	@returns The upload's timeline value, for is_ready.
+	*/
+	uint64_t copy_to_buffer
+		(
+		VkBuffer				dst,
+		VkDeviceSize			dst_offset,
+		const void*				data,
+		VkDeviceSize			size
+		);
+
+	/**
+	Records copies of mip levels into a new image, with the layout
+	transitions around them. The image ends up in
+	VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. Many images can be recorded into
+	one batch; the batch is submitted once.
+
+	Mip levels past the copied ones are copied from src on the graphics queue
+	if it's given, starting at its src->level. Otherwise they're generated on
+	the graphics queue with a chain of linear blits, each level from the one
+	before it; the image needs VK_IMAGE_USAGE_TRANSFER_SRC_BIT and a format
+	that supports linear blits in that case.
+
+	@param image The destination image, in VK_IMAGE_LAYOUT_UNDEFINED.
+	@param levels The mip levels to copy, finest first. Level i is copied to
+		mip i. May be empty if src is given.
+	@param texel_size The size of a texel in bytes.
+	@param mip_levels The number of mip levels in the image.
+	@param src Image to copy the remaining levels from, or NULL.
+	@returns The upload's timeline value, for is_ready and wait.
+	*/
+	uint64_t copy_to_image
+		(
+		VkImage									image,
+		const std::vector<vlk_image_level>&		levels,
+		uint32_t								texel_size,
+		uint32_t								mip_levels,
+		const vlk_image_source*					src = NULL
+		);
+
+	/**
+	Records a copy of mip levels of an image into a host visible buffer,
+	tightly packed and finest first. The copy runs on the graphics queue
+	after the current batch's uploads. Read the buffer once is_complete
+	returns true.
+
+	@param src The image and its first level to copy.
+	@param level_count The number of levels to copy.
+	@param texel_size The size of a texel in bytes.
+	@param dst The destination buffer, with VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+	@returns The copy's timeline value, for is_complete.
+	*/
+	uint64_t copy_from_image
+		(
+		const vlk_image_source&		src,
+		uint32_t					level_count,
+		uint32_t					texel_size,
+		VkBuffer					dst
+		);
+
+	/**
+	Submits the uploads recorded since the last flush and reclaims ring space
+	from batches that have finished. Call once per frame before submitting the
+	frame's command buffers.
+	*/
+	void flush();
+
+	/**
+	Submits the uploads recorded so far and waits until every upload has
+	completed, so nothing in the ring refers to their targets any more.
+	*/
+	void finish();
+
+	/**
+	Checks if an upload, including any work it runs on the graphics queue,
+	has finished on the device. Updated by flush.
+
+	@param value The value returned when the upload was recorded.
+	*/
+	bool is_complete(uint64_t value) const;
+
+	/**
+	Checks if an upload can be used by work submitted to the graphics queue
+	from now on.
+
+	@param value The value returned when the upload was recorded.
+	*/
+	bool is_ready(uint64_t value) const;
+
+	/**
+	Makes an upload usable by work submitted to the graphics queue from now
+	on, submitting and waiting for it if needed. Only blocks when uploads go
+	through the transfer queue.
+
+	@param value The value returned when the upload was recorded.
+	*/
+	void wait(uint64_t value);
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct mip_generation
+	{
+		VkImage					image;
+		uint32_t				width;				/* extent of mip 0 */
+		uint32_t				height;
+		uint32_t				first_level;		/* first generated level */
+		uint32_t				level_count;		/* mip levels in the image */
+	};
+
+	struct level_copy
+	{
+		vlk_image_source		src;
+		uint32_t				level_count;		/* levels to copy */
+		uint32_t				texel_size;
+		VkImage					dst_image;			/* destination image, or VK_NULL_HANDLE */
+		uint32_t				dst_level;			/* first destination mip level */
+		VkBuffer				dst_buffer;			/* destination buffer, or VK_NULL_HANDLE */
+	};
+
+	struct upload_batch
+	{
+		VkCommandBuffer			cmd_buf;			/* copies, recorded for the upload queue */
+		VkCommandBuffer			acquire_cmd_buf;	/* ownership acquires for the graphics queue */
+		VkFence					fence;				/* signaled when the batch's last submission finishes */
+		VkDeviceSize			size;				/* ring bytes used by the batch, including padding */
+		uint64_t				value;				/* timeline value signaled when the copies finish */
+		bool					acquired;			/* set once the graphics queue owns the uploads */
+		std::vector<VkBufferMemoryBarrier>
+								buffer_ownership;	/* queue family ownership transfers of buffers */
+		std::vector<VkImageMemoryBarrier>
+								image_ownership;	/* queue family ownership transfers of images */
+		std::vector<mip_generation>
+								mip_generations;	/* mips to generate on the graphics queue after the acquire */
+		std::vector<level_copy>	level_copies;		/* copies from existing images on the graphics queue after the acquire */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/**
+	Allocates ring space, waiting for in-flight batches if the ring is full.
+	Returns false if the allocation can never fit.
+	*/
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+	/**
+	Allocates ring space and copies data into it. Returns the offset of the
+	data in the ring.
+	*/
+	VkDeviceSize stage(const void* data, VkDeviceSize size, VkDeviceSize alignment);
+
+	/**
+	Records copies of mip levels into the first levels of a new image and the
+	barriers that release them to the graphics queue. Requires the lock.
+
+	@param generate The rest of the chain is generated from the copied levels.
+	*/
+	void record_image_upload
+		(
+		VkImage									image,
+		const std::vector<vlk_image_level>&		levels,
+		uint32_t								texel_size,
+		bool									generate
+		);
+
+	/** Begins the current batch if needed and returns its command buffer. */
+	VkCommandBuffer begin_batch();
+
+	/** Submits the current batch. Requires the lock. */
+	void submit_batch();
+
+	/**
+	Transfers ownership of finished batches to the graphics queue, waiting
+	on the oldest batch if wait is set.
+	*/
+	void acquire_batches(bool wait);
+
+	/** Reclaims finished batches, waiting on the oldest one if wait is set. */
+	void retire_batches(bool wait);
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+	std::mutex						_mutex;
+
+	VkBuffer						_buffer;
+	VmaAllocation					_allocation;
+	uint8_t*						_mapped;		/* persistently mapped ring memory */
+	VkDeviceSize					_size;
+	VkDeviceSize					_head;			/* next free byte */
+	VkDeviceSize					_used;			/* bytes used by pending and in-flight batches */
+
+	bool							_transfer_queue;	/* uploads go through a separate transfer queue */
+	VkQueue							_queue;				/* queue uploads are submitted to */
+	VkCommandPool					_cmd_pool;
+	VkCommandPool					_acquire_cmd_pool;	/* graphics queue pool for ownership acquires */
+	VkSemaphore						_timeline;
+	uint64_t						_next_value;
+	std::atomic<uint64_t>			_acquired_value;	/* latest value usable by the graphics queue */
+	std::atomic<uint64_t>			_completed_value;	/* latest value whose batch has finished */
+	PFN_vkGetSemaphoreCounterValueKHR
+									_get_counter_value;
+	PFN_vkWaitSemaphoresKHR			_wait_semaphores;
+
+	upload_batch					_current;		/* batch being recorded, cmd_buf is null if none */
+	std::deque<upload_batch>		_in_flight;		/* submitted batches, oldest first */
+	std::vector<upload_batch>		_free;			/* finished batches available for reuse */
+};
+
+}   /* namespace jetz */
@@ -124,6 +124,8 @@ void vlk_swapchain::end_frame(const vlk_frame& frame)
 	submit_info.signalSemaphoreCount = 1;
 	submit_info.pSignalSemaphores = signal_semaphores;
 
+	/* Uploads submit to the same queues from loader threads */
+	std::unique_lock<std::mutex> queue_lock(dev.get_queue_mutex());
 	result = vkQueueSubmit(dev.get_gfx_queue(), 1, &submit_info, in_flight_fences[frame.get_frame_idx()]);
 
 	if (result != VK_SUCCESS)
@@ -144,6 +146,7 @@ void vlk_swapchain::end_frame(const vlk_frame& frame)
 	present_info.pResults = NULL; // Optional
 
 	result = vkQueuePresentKHR(dev.get_present_queue(), &present_info);
+	queue_lock.unlock();
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR
 		|| result == VK_SUBOPTIMAL_KHR)
@@ -727,7 +730,10 @@ void vlk_swapchain::resize(VkExtent2D extent)
 	_extent = extent;
 
 	/* wait until device is idle before recreation */
-	vkDeviceWaitIdle(dev.get_handle());
+	{
+		std::lock_guard<std::mutex> lock(dev.get_queue_mutex());
+		vkDeviceWaitIdle(dev.get_handle());
+	}
 
 	/* destroy things that need recreated */
 	destroy_framebuffers();
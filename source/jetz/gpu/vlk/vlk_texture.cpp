@@ -6,8 +6,16 @@ vlk_texture.cpp
 INCLUDES
 =============================================================================*/
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "jetz/gpu/gpu.h"
 #include "jetz/gpu/vlk/vlk_buffer.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
 #include "jetz/gpu/vlk/vlk_texture.h"
+#include "jetz/gpu/vlk/vlk_texture_streamer.h"
+#include "jetz/gpu/vlk/descriptors/vlk_bindless_textures.h"
 #include "jetz/main/log.h"
 
 /*=============================================================================
@@ -16,6 +24,29 @@ NAMESPACE
 
 namespace jetz {
 
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Bytes per pixel - textures are RGBA8 */
+static const uint32_t texel_size = 4;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Checks if mip levels of a format can be generated with linear blits.
+*/
+static bool can_blit_mips(vlk_device& dev, VkFormat format)
+{
+	VkFormatProperties format_props;
+	vkGetPhysicalDeviceFormatProperties(dev.get_gpu().get_handle(), format, &format_props);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (format_props.optimalTilingFeatures & required) == required;
+}
+
 /*=============================================================================
 CONSTRUCTORS
 =============================================================================*/
@@ -25,17 +56,108 @@ vlk_texture::vlk_texture
 	vlk_device&						device,
 	const vlk_texture_create_info&	create_info
 	)
-	: dev(device)
+	:
+	dev(device),
+	image(VK_NULL_HANDLE),
+	image_allocation(VK_NULL_HANDLE),
+	image_view(VK_NULL_HANDLE),
+	pending_image(VK_NULL_HANDLE),
+	pending_allocation(VK_NULL_HANDLE),
+	pending_value(0),
+	bindless_index(vlk_bindless_textures::invalid_index),
+	requested_level(0),
+	resident_level(0),
+	stream_min_level(0),
+	streamed(false),
+	readback_level(0),
+	readback_count(0),
+	readback_value(0),
+	upload_value(0),
+	version(0)
 {
-	create_image(create_info);
-	create_image_view();
-	init_image_info();
+	// TODO : assuming the format for now
+	format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	create_mip_extents(create_info.width, create_info.height);
+
+	/* Streamed textures start with only the smallest mips resident */
+	uint32_t mip_count = get_mip_count();
+	if (gpu::stream_textures)
+	{
+		while (stream_min_level + 1 < mip_count
+			&& (mip_extents[stream_min_level].width > gpu::texture_stream_min_size
+			|| mip_extents[stream_min_level].height > gpu::texture_stream_min_size))
+		{
+			stream_min_level++;
+		}
+
+		streamed = stream_min_level > 0;
+	}
+
+	resident_level = stream_min_level;
+	requested_level = mip_count;
+
+	/*
+	Streamed textures upload levels that aren't resident yet from the CPU mip
+	chain, so it's built for them up front. Otherwise the GPU generates the
+	chain from level 0 when the format can be blitted, and the CPU box filter
+	is the fallback.
+	*/
+	bool gpu_mips = !streamed && can_blit_mips(dev, format);
+	create_mips(create_info, gpu_mips ? 1 : mip_count);
+
+	/* Drawn with the default texture until the upload is ready */
+	create_image(resident_level, pending_image, pending_allocation);
+	pending_value = upload_levels(pending_image, resident_level, (uint32_t)mips.size() - resident_level, NULL);
+
+	if (!finish_upload())
+	{
+		dev.get_texture_streamer().add_pending(this);
+	}
+
+	if (streamed)
+	{
+		dev.get_texture_streamer().add(this);
+	}
+	else
+	{
+		/* Staged by upload_levels and never uploaded again */
+		mips.clear();
+		mips.shrink_to_fit();
+	}
 }
 
 vlk_texture::~vlk_texture()
 {
-	destroy_image_view();
-	destroy_image();
+	/* First, so the streamer can't change the texture's image or slot while it's destroyed */
+	dev.get_texture_streamer().remove(this);
+
+	if (dev.has_bindless_textures())
+	{
+		dev.get_bindless_textures().remove(bindless_index);
+	}
+
+	/* The images and readback buffer may still be used by copies on the GPU, or by batches not submitted yet */
+	auto& streamer = dev.get_texture_streamer();
+	if (image != VK_NULL_HANDLE)
+	{
+		streamer.retire(image, image_allocation, image_view, upload_value);
+	}
+
+	if (pending_image != VK_NULL_HANDLE)
+	{
+		streamer.retire(pending_image, pending_allocation, VK_NULL_HANDLE, pending_value);
+	}
+
+	if (readback)
+	{
+		streamer.retire(std::move(readback), readback_value);
+	}
+}
+
+uint32_t vlk_texture::get_bindless_index() const
+{
+	return bindless_index;
 }
 
 VkImage vlk_texture::get_image() const
@@ -48,70 +170,291 @@ VkDescriptorImageInfo* vlk_texture::get_image_info()
 	return &image_info;
 }
 
+uint64_t vlk_texture::get_memory_size() const
+{
+	uint64_t size = 0;
+	VmaAllocation allocations[] = { image_allocation, pending_allocation };
+	for (auto allocation : allocations)
+	{
+		if (allocation != VK_NULL_HANDLE)
+		{
+			VmaAllocationInfo info;
+			vmaGetAllocationInfo(dev.get_allocator(), allocation, &info);
+			size += info.size;
+		}
+	}
+
+	return size;
+}
+
 /*=============================================================================
 PUBLIC METHODS
 =============================================================================*/
 
+uint32_t vlk_texture::get_mip_count() const
+{
+	return (uint32_t)mip_extents.size();
+}
+
+uint64_t vlk_texture::get_mip_chain_size(uint32_t level) const
+{
+	uint64_t size = 0;
+	for (uint32_t i = level; i < mip_extents.size(); ++i)
+	{
+		size += (uint64_t)mip_extents[i].width * mip_extents[i].height * texel_size;
+	}
+
+	return size;
+}
+
+uint32_t vlk_texture::get_requested_level() const
+{
+	return requested_level;
+}
+
+uint32_t vlk_texture::get_resident_level() const
+{
+	return resident_level;
+}
+
+uint32_t vlk_texture::get_stream_min_level() const
+{
+	return stream_min_level;
+}
+
+uint32_t vlk_texture::get_version() const
+{
+	return version;
+}
+
+bool vlk_texture::has_image() const
+{
+	return image != VK_NULL_HANDLE;
+}
+
+void vlk_texture::wait_upload()
+{
+	if (pending_image == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	dev.get_staging_ring().wait(pending_value);
+	finish_upload();
+}
+
+void vlk_texture::request_mip(float uv_per_pixel)
+{
+	/* Texels per pixel along the larger dimension picks the mip */
+	float texels_per_pixel = uv_per_pixel * (float)(max(mip_extents[0].width, mip_extents[0].height));
+	uint32_t level = 0;
+	if (texels_per_pixel > 1.0f)
+	{
+		level = (uint32_t)log2f(texels_per_pixel);
+	}
+
+	if (level < requested_level)
+	{
+		requested_level = level < get_mip_count() ? level : get_mip_count() - 1;
+	}
+}
+
+void vlk_texture::finish_readback()
+{
+	if (!readback || !dev.get_staging_ring().is_complete(readback_value))
+	{
+		return;
+	}
+
+	uint64_t size = get_mip_chain_size(readback_level) - get_mip_chain_size(readback_level + readback_count);
+	readback->invalidate(0, size);
+
+	const uint8_t* src = (const uint8_t*)readback->get_mapped();
+	for (uint32_t i = readback_level; i < readback_level + readback_count; ++i)
+	{
+		size_t level_size = (size_t)mip_extents[i].width * mip_extents[i].height * texel_size;
+		mips[i].assign(src, src + level_size);
+		src += level_size;
+	}
+
+	readback.reset();
+}
+
+bool vlk_texture::finish_upload()
+{
+	if (pending_image == VK_NULL_HANDLE)
+	{
+		return true;
+	}
+
+	if (!dev.get_staging_ring().is_ready(pending_value))
+	{
+		return false;
+	}
+
+	/* Keep the old image alive until frames using it and copies from it are done */
+	if (image != VK_NULL_HANDLE)
+	{
+		dev.get_texture_streamer().retire(image, image_allocation, image_view, upload_value);
+	}
+
+	image = pending_image;
+	image_allocation = pending_allocation;
+	upload_value = pending_value;
+	pending_image = VK_NULL_HANDLE;
+	pending_allocation = VK_NULL_HANDLE;
+
+	create_image_view();
+	init_image_info();
+	update_bindless_index();
+
+	version++;
+	return true;
+}
+
+void vlk_texture::reset_request()
+{
+	requested_level = get_mip_count();
+}
+
+void vlk_texture::set_resident_level(uint32_t level)
+{
+	/* Only streamed textures keep the CPU mip chain */
+	if (!streamed || level >= get_mip_count() || level == resident_level)
+	{
+		return;
+	}
+
+	/* The last change is still uploading or being copied back - the streamer tries again next frame */
+	if (pending_image != VK_NULL_HANDLE || readback)
+	{
+		return;
+	}
+
+	vlk_image_source old = {};
+	old.image = image;
+
+	create_image(level, pending_image, pending_allocation);
+
+	if (level < resident_level)
+	{
+		/* Only the new levels are uploaded, the rest are copied from the current image */
+		old.level = 0;
+		old.width = mip_extents[resident_level].width;
+		old.height = mip_extents[resident_level].height;
+		pending_value = upload_levels(pending_image, level, resident_level - level, &old);
+		upload_value = pending_value;
+	}
+	else
+	{
+		/* Every level is in the current image. The dropped ones are copied back so they can be uploaded again. */
+		old.level = level - resident_level;
+		old.width = mip_extents[level].width;
+		old.height = mip_extents[level].height;
+		pending_value = upload_levels(pending_image, level, 0, &old);
+		read_back(old.image, resident_level, level - resident_level);
+		upload_value = readback_value;
+	}
+
+	/* Drawing keeps using the current image until the streamer swaps in the new one */
+	resident_level = level;
+}
+
 /*=============================================================================
 PRIVATE METHODS
 =============================================================================*/
 
-void vlk_texture::create_image(const vlk_texture_create_info& create_info)
+void vlk_texture::create_mip_extents(uint32_t width, uint32_t height)
 {
-	/*
-	Create staging buffer with texture data
-	*/
-	vlk_buffer staging_buffer(
-		dev,
-		create_info.size,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY);
+	mip_extents.clear();
+	mip_extents.push_back({ width, height });
+
+	/* Down to 1x1 */
+	while (width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		mip_extents.push_back({ width, height });
+	}
+}
 
-	staging_buffer.update(create_info.data, 0, create_info.size);
+void vlk_texture::create_mips(const vlk_texture_create_info& create_info, uint32_t level_count)
+{
+	mips.clear();
+	mips.emplace_back((const uint8_t*)create_info.data, (const uint8_t*)create_info.data + create_info.size);
+
+	/* Box filter each level from the one before it */
+	while (mips.size() < level_count)
+	{
+		uint32_t width = mip_extents[mips.size() - 1].width;
+		uint32_t height = mip_extents[mips.size() - 1].height;
+		uint32_t mip_width = mip_extents[mips.size()].width;
+		uint32_t mip_height = mip_extents[mips.size()].height;
+
+		const std::vector<uint8_t>& src = mips.back();
+		std::vector<uint8_t> dst((size_t)mip_width * mip_height * texel_size);
+
+		for (uint32_t y = 0; y < mip_height; ++y)
+		{
+			uint32_t y0 = min(y * 2, height - 1);
+			uint32_t y1 = min(y * 2 + 1, height - 1);
+
+			for (uint32_t x = 0; x < mip_width; ++x)
+			{
+				uint32_t x0 = min(x * 2, width - 1);
+				uint32_t x1 = min(x * 2 + 1, width - 1);
+
+				for (uint32_t c = 0; c < texel_size; ++c)
+				{
+					uint32_t sum = src[((size_t)y0 * width + x0) * texel_size + c]
+						+ src[((size_t)y0 * width + x1) * texel_size + c]
+						+ src[((size_t)y1 * width + x0) * texel_size + c]
+						+ src[((size_t)y1 * width + x1) * texel_size + c];
+
+					dst[((size_t)y * mip_width + x) * texel_size + c] = (uint8_t)((sum + 2) / 4);
+				}
+			}
+		}
+
+		mips.push_back(std::move(dst));
+	}
+}
+
+void vlk_texture::create_image(uint32_t level, VkImage& out_image, VmaAllocation& out_allocation)
+{
+	uint32_t level_count = get_mip_count() - level;
 
-	/*
-	Create the image
-	*/
 	VkImageCreateInfo image_info = {};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	image_info.imageType = VK_IMAGE_TYPE_2D;
-	image_info.extent.width = create_info.width;
-	image_info.extent.height = create_info.height;
+	image_info.extent.width = mip_extents[level].width;
+	image_info.extent.height = mip_extents[level].height;
 	image_info.extent.depth = 1;
-	image_info.mipLevels = 1;
+	image_info.mipLevels = level_count;
 	image_info.arrayLayers = 1;
-
-	// TODO : assuming the format for now
-	format = VK_FORMAT_R8G8B8A8_UNORM;
-
 	image_info.format = format;
 	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
 	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	if (streamed || mips.size() < get_mip_count())
+	{
+		/* Mip generation blits from the image to itself, and streaming copies levels to the next image */
+		image_info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
 	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
 	image_info.flags = 0;
 
+	/* Sub-allocated - streaming recreates images often, and most are small */
 	VmaAllocationCreateInfo alloc_info = {};
 	alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	alloc_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 
-	VkResult result = vmaCreateImage(dev.get_allocator(), &image_info, &alloc_info, &image, &image_allocation, NULL);
-	if (result != VK_SUCCESS) 
+	VkResult result = vmaCreateImage(dev.get_allocator(), &image_info, &alloc_info, &out_image, &out_allocation, NULL);
+	if (result != VK_SUCCESS)
 	{
 		LOG_FATAL("Failed to create texture image.");
 	}
-
-	/*
-	Copy texture from staging buffer to GPU
-	*/
-	dev.transition_image_layout(image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	dev.copy_buffer_to_img_now(staging_buffer.get_handle(), image, create_info.width, create_info.height);
-	dev.transition_image_layout(image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-	/*
-	Cleanup staging buffer - desctructor called for stack variable
-	*/
 }
 
 void vlk_texture::create_image_view()
@@ -123,7 +466,7 @@ void vlk_texture::create_image_view()
 	view_info.format = format;
 	view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	view_info.subresourceRange.baseMipLevel = 0;
-	view_info.subresourceRange.levelCount = 1;
+	view_info.subresourceRange.levelCount = get_mip_count() - resident_level;
 	view_info.subresourceRange.baseArrayLayer = 0;
 	view_info.subresourceRange.layerCount = 1;
 
@@ -133,6 +476,55 @@ void vlk_texture::create_image_view()
 	}
 }
 
+uint64_t vlk_texture::upload_levels(VkImage dst, uint32_t level, uint32_t upload_count, const vlk_image_source* src)
+{
+	/*
+	Record the copy into the staging ring's current batch. Textures created
+	together (e.g. a model's) are submitted together with the frame's other
+	uploads.
+	*/
+	std::vector<vlk_image_level> levels;
+	for (uint32_t i = 0; i < upload_count; ++i)
+	{
+		vlk_image_level data = {};
+		data.data = mips[level + i].data();
+		data.width = mip_extents[level + i].width;
+		data.height = mip_extents[level + i].height;
+		levels.push_back(data);
+	}
+
+	uint64_t value = dev.get_staging_ring().copy_to_image(dst, levels, texel_size, get_mip_count() - level, src);
+
+	if (!streamed)
+	{
+		return value;
+	}
+
+	/* The pixels are staged, so resident levels don't need a CPU copy */
+	for (uint32_t i = 0; i < upload_count; ++i)
+	{
+		std::vector<uint8_t>().swap(mips[level + i]);
+	}
+
+	return value;
+}
+
+void vlk_texture::read_back(VkImage src_image, uint32_t level, uint32_t level_count)
+{
+	VkDeviceSize size = get_mip_chain_size(level) - get_mip_chain_size(level + level_count);
+	readback = uptr<vlk_buffer>(new vlk_buffer(dev, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU));
+	readback_level = level;
+	readback_count = level_count;
+
+	vlk_image_source src = {};
+	src.image = src_image;
+	src.level = 0;
+	src.width = mip_extents[level].width;
+	src.height = mip_extents[level].height;
+
+	readback_value = dev.get_staging_ring().copy_from_image(src, level_count, texel_size, readback->get_handle());
+}
+
 void vlk_texture::init_image_info()
 {
 	image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -140,14 +532,17 @@ void vlk_texture::init_image_info()
 	image_info.sampler = dev.get_texture_sampler();
 }
 
-void vlk_texture::destroy_image()
+void vlk_texture::update_bindless_index()
 {
-	vmaDestroyImage(dev.get_allocator(), image, image_allocation);
-}
+	if (!dev.has_bindless_textures())
+	{
+		return;
+	}
 
-void vlk_texture::destroy_image_view()
-{
-	vkDestroyImageView(dev.get_handle(), image_view, NULL);
+	/* The old slot still points at the retired view, so it's only reused once frames using it are done */
+	auto& bindless = dev.get_bindless_textures();
+	bindless.remove(bindless_index);
+	bindless_index = bindless.add(image_view);
 }
 
 }   /* namespace jetz */
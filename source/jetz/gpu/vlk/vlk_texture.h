@@ -8,16 +8,22 @@ vlk_texture.h
 INCLUDES
 =============================================================================*/
 
+#include <cstdint>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 #include "jetz/gpu/gpu_texture.h"
 #include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/main/common.h"
 
 /*=============================================================================
 NAMESPACE
 =============================================================================*/
 
 namespace jetz {
+
+class vlk_buffer;
+struct vlk_image_source;
 	
 /*=============================================================================
 TYPES
@@ -47,9 +53,95 @@ public:
 	Public Methods
 	-----------------------------------------------------*/
 
+	/**
+	Stores the levels copied back from the GPU when levels were last dropped,
+	once the copy has finished. Called by the texture streamer each frame.
+	*/
+	void finish_readback();
+
+	/**
+	Swaps in the pending image once its upload can be used by the graphics
+	queue, and retires the previous image. Until then the texture keeps
+	drawing with its previous image. Never blocks. Called by the texture
+	streamer at the start of a frame, so descriptors don't change while
+	frames are recorded.
+
+	@returns True if no image is pending any more.
+	*/
+	bool finish_upload();
+
+	/**
+	Gets the texture's slot in the device's bindless texture array. Changes
+	whenever the image view changes. vlk_bindless_textures::invalid_index if
+	bindless textures aren't used or the array is full.
+	*/
+	uint32_t get_bindless_index() const;
+
 	VkImage get_image() const;
 	VkDescriptorImageInfo* get_image_info();
 
+	/** Gets the number of mip levels in the full mip chain. */
+	uint32_t get_mip_count() const;
+
+	/** Gets the size in bytes of mip levels [level, mip count). */
+	uint64_t get_mip_chain_size(uint32_t level) const;
+
+	/** Gets the finest mip level requested since the last reset, or the mip count if none. */
+	uint32_t get_requested_level() const;
+
+	/** Gets the finest mip level in the image. */
+	uint32_t get_resident_level() const;
+
+	/** Gets the coarsest level streaming may drop the texture to. */
+	uint32_t get_stream_min_level() const;
+
+	/** Gets a counter that changes whenever the image view changes. */
+	uint32_t get_version() const;
+
+	/**
+	Checks if the texture has an image that can be drawn with. New textures
+	don't until their first upload is ready; draw with the default texture
+	instead.
+	*/
+	bool has_image() const;
+
+	/**
+	Requests the mip level needed to sample the texture at a given density.
+	The finest level requested in a frame wins.
+
+	@param uv_per_pixel Texture coordinate units covered by one screen pixel.
+	*/
+	void request_mip(float uv_per_pixel);
+
+	/** Clears the requested mip level. */
+	void reset_request();
+
+	/**
+	Changes which mip levels are resident. Creates a pending image with levels
+	[level, mip count). Only levels that weren't resident are uploaded; the
+	rest are copied from the current image on the GPU. Dropped levels are
+	copied back to the CPU so they can be uploaded again later. The current
+	image is drawn with until finish_upload swaps in the pending one.
+
+	Does nothing while a previous change is still uploading or dropped levels
+	are still being copied back.
+	*/
+	void set_resident_level(uint32_t level);
+
+	/**
+	Waits until the pending image's upload can be used by the graphics queue
+	and swaps it in. Blocks when uploads go through the transfer queue, so
+	only use it for textures that must be usable right away (e.g. the default
+	texture) - never while recording commands.
+	*/
+	void wait_upload();
+
+	/*-----------------------------------------------------
+	jetz::gpu_texture Methods
+	-----------------------------------------------------*/
+
+	virtual uint64_t get_memory_size() const override;
+
 protected:
 
 	/*-----------------------------------------------------
@@ -62,20 +154,36 @@ private:
 	Private methods
 	-----------------------------------------------------*/
 
-	/** Creates the texture image. */
-	void create_image(const vlk_texture_create_info& create_info);
+	/** Computes the extent of each level in the full mip chain. */
+	void create_mip_extents(uint32_t width, uint32_t height);
+
+	/** Builds the first level_count levels of the CPU mip chain from the source pixels. */
+	void create_mips(const vlk_texture_create_info& create_info, uint32_t level_count);
+
+	/** Creates an image with mip levels [level, mip count). */
+	void create_image(uint32_t level, VkImage& out_image, VmaAllocation& out_allocation);
+
+	/**
+	Records a copy of levels [level, level + upload_count) from the CPU mip
+	chain into an image. The image's remaining levels are copied from src if
+	given, otherwise generated on the GPU. Streamed textures free the CPU
+	copy of the uploaded levels.
+
+	@returns The upload's staging ring value.
+	*/
+	uint64_t upload_levels(VkImage dst, uint32_t level, uint32_t upload_count, const vlk_image_source* src);
+
+	/** Records a copy of levels [level, level + level_count) from an image with mip 0 at level back to the CPU. */
+	void read_back(VkImage src_image, uint32_t level, uint32_t level_count);
 
-	/** Creates the texture image view. */
+	/** Creates the view of the current image. */
 	void create_image_view();
 
 	/** Initializes the image info data for the texture. */
 	void init_image_info();
 
-	/** Destroys the texture image. */
-	void destroy_image();
-
-	/** Destroys the texture image view. */
-	void destroy_image_view();
+	/** Writes the image view to a new slot in the bindless texture array, freeing the old slot. */
+	void update_bindless_index();
 
 	/*-----------------------------------------------------
 	Private variables
@@ -88,16 +196,44 @@ private:
 	VkFormat					format;
 
 	/*
-	Create/destroy
+	Create/destroy - the image being drawn with, VK_NULL_HANDLE until the first upload is ready
 	*/
 	VkImage						image;
 	VmaAllocation				image_allocation;
 	VkImageView					image_view;
 
+	/*
+	Pending image - replaces the current one once its upload is ready
+	*/
+	VkImage						pending_image;		/* VK_NULL_HANDLE if nothing is pending */
+	VmaAllocation				pending_allocation;
+	uint64_t					pending_value;		/* staging ring value of the pending image's upload */
+
+	/*
+	Mips
+	*/
+	std::vector<std::vector<uint8_t>>	mips;			/* RGBA8 pixels of each mip level, finest first. Streamed textures only keep levels that aren't resident. */
+	std::vector<VkExtent2D>		mip_extents;
+	uint32_t					requested_level;	/* finest level requested since the last reset */
+	uint32_t					resident_level;		/* finest level in the newest image (the pending one, if any) */
+	uint32_t					stream_min_level;	/* coarsest level streaming may drop to */
+	bool						streamed;			/* registered with the texture streamer */
+
+	/*
+	Readback of dropped levels
+	*/
+	uptr<vlk_buffer>			readback;			/* NULL if no readback is pending */
+	uint32_t					readback_level;
+	uint32_t					readback_count;
+	uint64_t					readback_value;		/* staging ring value of the copy */
+
 	/*
 	Other
 	*/
+	uint32_t					bindless_index;
 	VkDescriptorImageInfo		image_info;
+	uint64_t					upload_value;		/* staging ring value of the last copy to or from the current image */
+	uint32_t					version;
 };
 
 }   /* namespace jetz */
@@ -0,0 +1,265 @@
+/*=============================================================================
+vlk_texture_streamer.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+
+#include "jetz/gpu/gpu.h"
+#include "jetz/gpu/vlk/vlk_buffer.h"
+#include "jetz/gpu/vlk/vlk_device.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
+#include "jetz/gpu/vlk/vlk_texture.h"
+#include "jetz/gpu/vlk/vlk_texture_streamer.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+vlk_texture_streamer::vlk_texture_streamer(vlk_device& device)
+	:
+	_device(device),
+	_frame_num(0)
+{
+}
+
+vlk_texture_streamer::~vlk_texture_streamer()
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	free_retired(true);
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+void vlk_texture_streamer::add(vlk_texture* texture)
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	stream_state state = {};
+	state.texture = texture;
+	state.last_request_frame = _frame_num;
+	state.target_level = texture->get_resident_level();
+
+	_textures.push_back(state);
+}
+
+void vlk_texture_streamer::add_pending(vlk_texture* texture)
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_pending.push_back(texture);
+}
+
+void vlk_texture_streamer::remove(vlk_texture* texture)
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	for (size_t i = 0; i < _pending.size(); ++i)
+	{
+		if (_pending[i] == texture)
+		{
+			_pending[i] = _pending.back();
+			_pending.pop_back();
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < _textures.size(); ++i)
+	{
+		if (_textures[i].texture == texture)
+		{
+			_textures[i] = _textures.back();
+			_textures.pop_back();
+			return;
+		}
+	}
+}
+
+void vlk_texture_streamer::retire
+	(
+	VkImage					image,
+	VmaAllocation			allocation,
+	VkImageView				view,
+	uint64_t				copy_value
+	)
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	retired_image r = {};
+	r.image = image;
+	r.allocation = allocation;
+	r.view = view;
+	r.frame = _frame_num;
+	r.copy_value = copy_value;
+
+	_retired.push_back(r);
+}
+
+void vlk_texture_streamer::retire(uptr<vlk_buffer> buffer, uint64_t copy_value)
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	retired_buffer r;
+	r.buffer = std::move(buffer);
+	r.copy_value = copy_value;
+
+	_retired_buffers.push_back(std::move(r));
+}
+
+void vlk_texture_streamer::update()
+{
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	_frame_num++;
+	free_retired(false);
+
+	/* New textures draw with the default texture until their upload is ready */
+	size_t kept = 0;
+	for (size_t i = 0; i < _pending.size(); ++i)
+	{
+		if (!_pending[i]->finish_upload())
+		{
+			_pending[kept++] = _pending[i];
+		}
+	}
+
+	_pending.resize(kept);
+
+	if (_textures.empty())
+	{
+		return;
+	}
+
+	/*
+	Pick a target level for each texture from last frame's requests. Finer
+	requests apply right away; coarser ones (including no request) only once
+	the texture hasn't needed its current level for a while, so residency
+	doesn't flip back and forth.
+	*/
+	for (auto& state : _textures)
+	{
+		vlk_texture& tex = *state.texture;
+		tex.finish_upload();
+		tex.finish_readback();
+
+		uint32_t requested = min(tex.get_requested_level(), tex.get_stream_min_level());
+		tex.reset_request();
+
+		if (requested <= state.target_level)
+		{
+			state.target_level = requested;
+			state.last_request_frame = _frame_num;
+		}
+		else if (_frame_num - state.last_request_frame > idle_frames)
+		{
+			state.target_level = requested;
+			state.last_request_frame = _frame_num;
+		}
+	}
+
+	/*
+	Fit the targets into the budget by dropping every texture's finest levels
+	until the total fits (a global mip bias).
+	*/
+	uint32_t bias = 0;
+	for (;;)
+	{
+		uint64_t total = 0;
+		bool can_drop = false;
+
+		for (const auto& state : _textures)
+		{
+			uint32_t level = min(state.target_level + bias, state.texture->get_stream_min_level());
+			total += state.texture->get_mip_chain_size(level);
+			can_drop |= level < state.texture->get_stream_min_level();
+		}
+
+		if (total <= gpu::texture_stream_budget || !can_drop)
+		{
+			break;
+		}
+
+		bias++;
+	}
+
+	/*
+	Apply changes. Dropping levels frees memory so those go first, then the
+	textures missing the most detail.
+	*/
+	std::vector<stream_change> changes;
+	for (auto& state : _textures)
+	{
+		uint32_t level = min(state.target_level + bias, state.texture->get_stream_min_level());
+		int delta = (int)state.texture->get_resident_level() - (int)level;
+
+		if (delta != 0)
+		{
+			/* Drops sort first */
+			stream_change change = {};
+			change.priority = delta < 0 ? INT32_MAX : delta;
+			change.texture = state.texture;
+			change.level = level;
+			changes.push_back(change);
+		}
+	}
+
+	std::sort(changes.begin(), changes.end(), [](const stream_change& a, const stream_change& b) {
+		return a.priority > b.priority;
+	});
+
+	for (size_t i = 0; i < changes.size() && i < max_changes_per_frame; ++i)
+	{
+		changes[i].texture->set_resident_level(changes[i].level);
+	}
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void vlk_texture_streamer::free_retired(bool force)
+{
+	auto& staging_ring = _device.get_staging_ring();
+
+	/* Frames that could still be using an image have finished after num_frame_buf frames */
+	size_t kept = 0;
+	for (size_t i = 0; i < _retired.size(); ++i)
+	{
+		auto& r = _retired[i];
+		if (!force && (r.frame + gpu::num_frame_buf > _frame_num || !staging_ring.is_complete(r.copy_value)))
+		{
+			_retired[kept++] = r;
+			continue;
+		}
+
+		vkDestroyImageView(_device.get_handle(), r.view, NULL);
+		vmaDestroyImage(_device.get_allocator(), r.image, r.allocation);
+	}
+
+	_retired.resize(kept);
+
+	kept = 0;
+	for (size_t i = 0; i < _retired_buffers.size(); ++i)
+	{
+		auto& r = _retired_buffers[i];
+		if (!force && !staging_ring.is_complete(r.copy_value))
+		{
+			_retired_buffers[kept++] = std::move(r);
+		}
+	}
+
+	_retired_buffers.resize(kept);
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,160 @@
+/*=============================================================================
+vlk_texture_streamer.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "jetz/main/common.h"
+#include "thirdparty/vma/vma.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class vlk_buffer;
+class vlk_device;
+class vlk_texture;
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Adjusts which mip levels of streamed textures are resident. Textures request
+the mip level they need while rendering; once per frame the streamer fits the
+requests into the texture stream budget and recreates textures whose
+residency changed. Until a finer level arrives the texture's view only covers
+the resident levels, so sampling clamps to the best available mip.
+
+New textures' images are swapped in here too, once their uploads are ready,
+so descriptors only change between frames.
+
+Textures may be added, removed, and retired from any thread. The lock is
+held through update(), which retires images of the textures it changes, so
+it's recursive.
+*/
+class vlk_texture_streamer {
+
+public:
+
+	/** Max number of textures whose residency changes per frame. */
+	static const uint32_t max_changes_per_frame = 4;
+
+	/** Textures not requested for this many frames drop back to their min level. */
+	static const uint32_t idle_frames = 120;
+
+	vlk_texture_streamer(vlk_device& device);
+	~vlk_texture_streamer();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/** Starts streaming a texture. */
+	void add(vlk_texture* texture);
+
+	/**
+	Swaps in a texture's pending image at the start of the first frame its
+	upload is ready. Streamed textures are checked every frame anyway.
+	*/
+	void add_pending(vlk_texture* texture);
+
+	/** Stops streaming a texture and drops it from the pending list. */
+	void remove(vlk_texture* texture);
+
+	/**
+	Queues an image to be destroyed once frames that may use it are done and
+	the staging ring has finished copying from it.
+
+	@param copy_value Staging ring value of the last copy from or to the image.
+	*/
+	void retire
+		(
+		VkImage					image,
+		VmaAllocation			allocation,
+		VkImageView				view,
+		uint64_t				copy_value
+		);
+
+	/**
+	Queues a readback buffer to be destroyed once the staging ring has
+	finished copying into it.
+	*/
+	void retire(uptr<vlk_buffer> buffer, uint64_t copy_value);
+
+	/**
+	Updates texture residency from the requests made during the last frame,
+	swaps in images whose uploads are ready, finishes readbacks of dropped
+	levels, and frees retired images. Call at the start of a frame, after the
+	frame's fence has been waited on.
+	*/
+	void update();
+
+private:
+
+	/*-----------------------------------------------------
+	Private types
+	-----------------------------------------------------*/
+
+	struct stream_state
+	{
+		vlk_texture*			texture;
+		uint64_t				last_request_frame;
+		uint32_t				target_level;
+	};
+
+	struct stream_change
+	{
+		int						priority;
+		vlk_texture*			texture;
+		uint32_t				level;
+	};
+
+	struct retired_image
+	{
+		VkImage					image;
+		VmaAllocation			allocation;
+		VkImageView				view;
+		uint64_t				frame;			/* frame the image was retired */
+		uint64_t				copy_value;		/* staging ring value of the last copy from or to the image */
+	};
+
+	struct retired_buffer
+	{
+		uptr<vlk_buffer>		buffer;
+		uint64_t				copy_value;		/* staging ring value of the copy into the buffer */
+	};
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Destroys retired images and buffers, or all of them if force is set. */
+	void free_retired(bool force);
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	vlk_device&						_device;
+
+	std::recursive_mutex			_mutex;
+	uint64_t						_frame_num;
+	std::vector<retired_image>		_retired;
+	std::vector<retired_buffer>		_retired_buffers;
+	std::vector<stream_state>		_textures;
+	std::vector<vlk_texture*>		_pending;		/* textures waiting for their first upload */
+};
+
+}   /* namespace jetz */
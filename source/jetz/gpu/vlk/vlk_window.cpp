@@ -11,7 +11,13 @@ INCLUDES
 #include "jetz/gpu/gpu_window.h"
 #include "jetz/gpu/vlk/vlk_frame.h"
 #include "jetz/gpu/vlk/vlk_window.h"
+#include "jetz/gpu/vlk/vlk_material_buffer.h"
+#include "jetz/gpu/vlk/vlk_mesh_arena.h"
+#include "jetz/gpu/vlk/vlk_scratch_allocator.h"
+#include "jetz/gpu/vlk/vlk_staging_ring.h"
+#include "jetz/gpu/vlk/vlk_texture_streamer.h"
 #include "jetz/gpu/vlk/vlk_util.h"
+#include "jetz/gpu/vlk/descriptors/vlk_bindless_textures.h"
 #include "jetz/gpu/vlk/pipelines/vlk_imgui_pipeline.h"
 #include "jetz/gpu/vlk/pipelines/vlk_pipeline_cache.h"
 #include "jetz/main/common.h"
@@ -113,11 +119,35 @@ gpu_frame& vlk_window::do_begin_frame(camera& cam)
 
 	/* Setup render pass, command buffer, etc. */
 	swapchain->begin_frame(frame);
+	frame.reset_bindings();
+
+	/* The frame's fence has signaled, so its transient data is no longer in use */
+	dev.get_scratch_allocator().reset(frame.get_frame_idx());
+
+	/* Apply texture mip residency changes requested last frame now that the frame's resources are free */
+	dev.get_texture_streamer().update();
+
+	/* Reuse mesh arena ranges, material entries and descriptor sets freed by resources that no frame in flight uses anymore */
+	dev.get_mesh_arena().update();
+	dev.get_material_buffer().update();
+	dev.get_material_layout().get_allocator().update();
+	dev.get_per_view_layout().get_allocator().update();
+
+	if (dev.has_bindless_textures())
+	{
+		dev.get_bindless_textures().update();
+	}
 
 	/* Setup per-view descriptor set data */
 	per_view_set->update(frame, cam, swapchain->get_extent());
 	dev.get_pipeline_cache()->bind_per_view_set(frame.cmd_buf, frame, per_view_set);
 
+	/* Materials index the global texture array, so it's bound once for the frame */
+	if (dev.has_bindless_textures())
+	{
+		dev.get_pipeline_cache()->bind_bindless_textures(frame.cmd_buf);
+	}
+
 	return frame.get_gpu_frame();
 }
 
@@ -125,6 +155,10 @@ void vlk_window::do_end_frame(const gpu_frame& frame)
 {
 	auto& vlk_frame = get_frame(frame);
 
+	/* Submit this frame's uploads ahead of the frame's command buffers */
+	dev.get_staging_ring().flush();
+	dev.get_scratch_allocator().flush(vlk_frame.get_frame_idx());
+
 	/* End render pass, submit command buffer, preset swapchain */
 	swapchain->end_frame(vlk_frame);
 }
@@ -135,6 +169,9 @@ void vlk_window::do_render_imgui(const gpu_frame& frame, ImDrawData* draw_data)
 
 	/* Draw imgui */
 	dev.get_pipeline_cache()->get_imgui_pipeline().render(vlk_frame, draw_data);
+
+	/* Imgui binds its own vertex and index buffers */
+	vlk_frame.reset_bindings();
 }
 
 void vlk_window::do_resize()
@@ -109,6 +109,7 @@ void app::run_frame()
 
 	/* End frame */
 	gpu_window->end_frame(frame);
+	_gpu.end_frame();
 }
 
 bool app::should_exit()
@@ -0,0 +1,57 @@
+/*=============================================================================
+asset_id.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "jetz/main/asset_id.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+VARIABLES
+=============================================================================*/
+
+/* Interned paths, indexed by ID - a deque so references stay valid as it grows */
+static std::deque<std::string>						s_paths(1);
+static std::unordered_map<std::string, asset_id>	s_ids;
+static std::mutex									s_mutex;
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+const std::string& asset_ids::get_path(asset_id id)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return id < s_paths.size() ? s_paths[id] : s_paths[invalid];
+}
+
+asset_id asset_ids::intern(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	auto it = s_ids.find(path);
+	if (it != s_ids.end())
+	{
+		return it->second;
+	}
+
+	asset_id id = (asset_id)s_paths.size();
+	s_paths.push_back(path);
+	s_ids[path] = id;
+
+	return id;
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,64 @@
+/*=============================================================================
+asset_id.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <string>
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+An interned asset path. Equal paths always intern to the same ID, so assets
+can be compared and looked up by integer instead of by string.
+*/
+typedef uint32_t asset_id;
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+The table of interned asset paths. IDs are never released, so the table
+grows with the number of distinct paths seen.
+*/
+class asset_ids {
+
+public:
+
+	/** ID that never refers to an asset. */
+	static constexpr asset_id invalid = 0;
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Gets the path an ID was interned from.
+
+	@returns The path, or an empty string for an invalid ID.
+	*/
+	static const std::string& get_path(asset_id id);
+
+	/**
+	Interns a path.
+
+	@returns The path's ID.
+	*/
+	static asset_id intern(const std::string& path);
+};
+
+}   /* namespace jetz */
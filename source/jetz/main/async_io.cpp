@@ -0,0 +1,711 @@
+/*=============================================================================
+async_io.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+
+#ifdef __linux__
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <linux/io_uring.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <sys/uio.h>
+	#include <unistd.h>
+#endif
+
+#include "jetz/main/async_io.h"
+#include "jetz/main/filesystem.h"
+#include "jetz/main/log.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+/* Reads are I/O bound - a few threads keep the device busy */
+static const uint32_t default_thread_count = 4;
+
+/* Size of the io_uring rings. One entry is kept free to stop the completion thread. */
+static const uint32_t uring_entries = 64;
+
+const size_t async_io::chunk_size;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+#ifdef __linux__
+
+/**
+A read of a loose file on io_uring. One chunk is in flight at a time, so
+cancellation is checked between chunks like on the I/O threads.
+*/
+struct uring_file_read
+{
+	sptr<io_request>			request;
+	int							fd;
+	size_t						size;			/* bytes to read */
+	uint8_t*					dst;
+	iovec						iov;			/* the chunk in flight */
+	io_status					status;			/* final status once complete */
+};
+
+/**
+An io_uring instance and its mapped submission and completion rings.
+*/
+struct uring_state
+{
+	int							fd;
+	void*						sq_ring;
+	size_t						sq_ring_size;
+	void*						cq_ring;
+	size_t						cq_ring_size;
+	io_uring_sqe*				sqes;
+	size_t						sqes_size;
+
+	unsigned*					sq_tail;
+	unsigned*					sq_mask;
+	unsigned*					sq_array;
+	unsigned*					cq_head;
+	unsigned*					cq_tail;
+	unsigned*					cq_mask;
+	io_uring_cqe*				cqes;
+
+	std::mutex					mutex;
+	uint32_t					in_flight;		/* chunks submitted and not completed yet */
+	uint32_t					unsubmitted;	/* entries the kernel hasn't accepted yet */
+	std::deque<uring_file_read*>	waiting;	/* reads waiting for room in the ring */
+	bool						stop;
+};
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+static int uring_setup(unsigned entries, io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/**
+Unmaps the rings and closes an io_uring instance.
+*/
+static void destroy_uring(uring_state* uring)
+{
+	if (uring->sqes != MAP_FAILED)
+	{
+		munmap(uring->sqes, uring->sqes_size);
+	}
+
+	if (uring->cq_ring != MAP_FAILED && uring->cq_ring != uring->sq_ring)
+	{
+		munmap(uring->cq_ring, uring->cq_ring_size);
+	}
+
+	if (uring->sq_ring != MAP_FAILED)
+	{
+		munmap(uring->sq_ring, uring->sq_ring_size);
+	}
+
+	close(uring->fd);
+	delete uring;
+}
+
+/**
+Creates an io_uring instance and maps its rings.
+
+@returns NULL if io_uring isn't available (e.g. an old kernel, or disabled).
+*/
+static uring_state* create_uring()
+{
+	io_uring_params params = {};
+	int fd = uring_setup(uring_entries, &params);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	uring_state* uring = new uring_state();
+	uring->fd = fd;
+	uring->in_flight = 0;
+	uring->unsubmitted = 0;
+	uring->stop = false;
+
+	uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	uring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+	/* Newer kernels map both rings with one mapping */
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap)
+	{
+		uring->sq_ring_size = (std::max)(uring->sq_ring_size, uring->cq_ring_size);
+		uring->cq_ring_size = uring->sq_ring_size;
+	}
+
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_SHARED | MAP_POPULATE;
+	uring->sq_ring = mmap(NULL, uring->sq_ring_size, prot, flags, fd, IORING_OFF_SQ_RING);
+	uring->cq_ring = single_mmap ? uring->sq_ring : mmap(NULL, uring->cq_ring_size, prot, flags, fd, IORING_OFF_CQ_RING);
+	uring->sqes = (io_uring_sqe*)mmap(NULL, uring->sqes_size, prot, flags, fd, IORING_OFF_SQES);
+
+	if (uring->sq_ring == MAP_FAILED || uring->cq_ring == MAP_FAILED || uring->sqes == MAP_FAILED)
+	{
+		destroy_uring(uring);
+		return NULL;
+	}
+
+	uint8_t* sq = (uint8_t*)uring->sq_ring;
+	uring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	uring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	uring->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+	uint8_t* cq = (uint8_t*)uring->cq_ring;
+	uring->cq_head = (unsigned*)(cq + params.cq_off.head);
+	uring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	uring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	uring->cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return uring;
+}
+
+/**
+Queues an entry and submits it, along with any the kernel didn't accept
+before. Requires the uring lock. At most uring_entries entries are in
+flight, so there's always room.
+*/
+static void submit_uring_entry(uring_state& uring, const io_uring_sqe& entry)
+{
+	/* Only submitters write the tail, and they hold the lock */
+	unsigned tail = *uring.sq_tail;
+	unsigned index = tail & *uring.sq_mask;
+	uring.sqes[index] = entry;
+	uring.sq_array[index] = index;
+	__atomic_store_n(uring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	uring.unsubmitted++;
+	int submitted = uring_enter(uring.fd, uring.unsubmitted, 0, 0);
+	if (submitted > 0)
+	{
+		uring.unsubmitted -= (uint32_t)submitted;
+	}
+}
+
+#endif
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+io_request::io_request(const io_read& read, io_callback callback)
+	:
+	_read(read),
+	_callback(callback),
+	_bytes_read(0),
+	_cancel(false),
+	_status(io_status::PENDING)
+{
+}
+
+io_request::~io_request()
+{
+}
+
+async_io::async_io(uint32_t thread_count)
+	:
+	_stop(false),
+	_uring(NULL)
+{
+	if (thread_count == 0)
+	{
+		thread_count = default_thread_count;
+	}
+
+	for (uint32_t i = 0; i < thread_count; ++i)
+	{
+		_threads.emplace_back(&async_io::thread_main, this);
+	}
+
+#ifdef __linux__
+	_uring = create_uring();
+	if (_uring)
+	{
+		_uring_thread = std::thread(&async_io::uring_main, this);
+	}
+	else
+	{
+		LOG_INFO("io_uring isn't available - loose files are read on the I/O threads.");
+	}
+#endif
+}
+
+async_io::~async_io()
+{
+	cancel_all();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+
+	_queue_cv.notify_all();
+
+	for (auto& thread : _threads)
+	{
+		thread.join();
+	}
+
+#ifdef __linux__
+	if (_uring)
+	{
+		/* Wakes the completion thread, which stops once the reads in flight finish */
+		{
+			std::lock_guard<std::mutex> lock(_uring->mutex);
+			_uring->stop = true;
+
+			io_uring_sqe entry = {};
+			entry.opcode = IORING_OP_NOP;
+			submit_uring_entry(*_uring, entry);
+		}
+
+		_uring_thread.join();
+		destroy_uring(_uring);
+	}
+#endif
+}
+
+/*=============================================================================
+PUBLIC METHODS - io_request
+=============================================================================*/
+
+void io_request::cancel()
+{
+	_cancel = true;
+}
+
+size_t io_request::get_bytes_read() const
+{
+	return _bytes_read;
+}
+
+const std::vector<uint8_t>& io_request::get_data() const
+{
+	return _data;
+}
+
+const io_read& io_request::get_read() const
+{
+	return _read;
+}
+
+io_status io_request::get_status() const
+{
+	return _status;
+}
+
+bool io_request::is_complete() const
+{
+	return _status != io_status::PENDING;
+}
+
+bool io_request::is_cancel_requested() const
+{
+	return _cancel;
+}
+
+io_status io_request::wait() const
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_complete_cv.wait(lock, [this] { return is_complete(); });
+	return _status;
+}
+
+/*=============================================================================
+PUBLIC METHODS - async_io
+=============================================================================*/
+
+sptr<io_request> async_io::read(const io_read& read, io_callback callback)
+{
+	auto request = std::make_shared<io_request>(read, callback);
+	if (uring_read(request))
+	{
+		return request;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(request);
+	}
+
+	_queue_cv.notify_one();
+	return request;
+}
+
+std::vector<sptr<io_request>> async_io::read_batch
+	(
+	const std::vector<io_read>&		reads,
+	io_callback						callback
+	)
+{
+	std::vector<sptr<io_request>> requests;
+	requests.reserve(reads.size());
+	for (const auto& read : reads)
+	{
+		requests.push_back(std::make_shared<io_request>(read, callback));
+	}
+
+	/* Queue in file and offset order, returned in the caller's order */
+	std::vector<sptr<io_request>> sorted = requests;
+	std::stable_sort(sorted.begin(), sorted.end(), [](const sptr<io_request>& a, const sptr<io_request>& b) {
+		const io_read& ra = a->get_read();
+		const io_read& rb = b->get_read();
+		return ra.filename != rb.filename ? ra.filename < rb.filename : ra.offset < rb.offset;
+	});
+
+	std::vector<sptr<io_request>> queued;
+	for (const auto& request : sorted)
+	{
+		if (!uring_read(request))
+		{
+			queued.push_back(request);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.insert(_queue.end(), queued.begin(), queued.end());
+	}
+
+	_queue_cv.notify_all();
+	return requests;
+}
+
+void async_io::cancel_all()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (auto& request : _queue)
+	{
+		request->cancel();
+	}
+
+	for (auto& request : _active)
+	{
+		request->cancel();
+	}
+}
+
+/*=============================================================================
+PRIVATE METHODS - io_request
+=============================================================================*/
+
+void io_request::complete(io_status status)
+{
+	/* Callback runs before waiters wake so its work is visible after wait() */
+	_status = status;
+	if (_callback)
+	{
+		_callback(*this);
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_complete_cv.notify_all();
+}
+
+/*=============================================================================
+PRIVATE METHODS - async_io
+=============================================================================*/
+
+void async_io::process(io_request& request)
+{
+	if (request.is_cancel_requested())
+	{
+		request.complete(io_status::CANCELLED);
+		return;
+	}
+
+	const io_read& read = request._read;
+
+	/* Resolve the size for reads to the end or into the request's own buffer */
+	size_t size = read.size;
+	if (size == io_read::to_end || !read.buffer)
+	{
+		uint64_t file_size;
+		if (!filesystem::get_size(read.filename, file_size) || read.offset > file_size)
+		{
+			LOG_ERROR_FMT("Failed to read {0}.", read.filename);
+			request.complete(io_status::FAILED);
+			return;
+		}
+
+		uint64_t remaining = file_size - read.offset;
+		size = (uint64_t)size > remaining ? (size_t)remaining : size;
+	}
+
+	void* dst = read.buffer;
+	if (!dst)
+	{
+		request._data.resize(size);
+		dst = request._data.data();
+	}
+
+	bool success = filesystem::read_range(read.filename, read.offset, size, dst, request._bytes_read, &request._cancel);
+	if (success)
+	{
+		request.complete(io_status::DONE);
+	}
+	else if (request.is_cancel_requested())
+	{
+		request.complete(io_status::CANCELLED);
+	}
+	else
+	{
+		LOG_ERROR_FMT("Failed to read {0}.", read.filename);
+		request.complete(io_status::FAILED);
+	}
+}
+
+void async_io::thread_main()
+{
+	for (;;)
+	{
+		sptr<io_request> request;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_queue_cv.wait(lock, [this] { return _stop || !_queue.empty(); });
+
+			/* Drain the queue before stopping so every request completes */
+			if (_queue.empty())
+			{
+				return;
+			}
+
+			request = _queue.front();
+			_queue.pop_front();
+			_active.push_back(request);
+		}
+
+		process(*request);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_active.erase(std::find(_active.begin(), _active.end(), request));
+		}
+	}
+}
+
+bool async_io::uring_read(const sptr<io_request>& request)
+{
+#ifdef __linux__
+	const io_read& read = request->_read;
+	if (!_uring || request->is_cancel_requested() || filesystem::is_packed(read.filename))
+	{
+		return false;
+	}
+
+	/* Reads that fail to start go to the I/O threads, so failures are reported the same way */
+	int fd = open(read.filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || read.offset > (uint64_t)st.st_size)
+	{
+		close(fd);
+		return false;
+	}
+
+	/* Resolve the size for reads to the end or into the request's own buffer */
+	size_t size = read.size;
+	if (size == io_read::to_end || !read.buffer)
+	{
+		uint64_t remaining = (uint64_t)st.st_size - read.offset;
+		size = (uint64_t)size > remaining ? (size_t)remaining : size;
+	}
+
+	if (size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	uint8_t* dst = (uint8_t*)read.buffer;
+	if (!dst)
+	{
+		request->_data.resize(size);
+		dst = request->_data.data();
+	}
+
+	uring_file_read* file_read = new uring_file_read();
+	file_read->request = request;
+	file_read->fd = fd;
+	file_read->size = size;
+	file_read->dst = dst;
+	file_read->status = io_status::PENDING;
+
+	/* Tracked with the I/O threads' requests so cancel_all reaches it */
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_active.push_back(request);
+	}
+
+	std::lock_guard<std::mutex> lock(_uring->mutex);
+	uring_submit(*file_read);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void async_io::uring_main()
+{
+#ifdef __linux__
+	uring_state& uring = *_uring;
+	std::vector<uring_file_read*> finished;
+
+	for (;;)
+	{
+		/* Sleeps until an entry completes */
+		uring_enter(uring.fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+		{
+			std::lock_guard<std::mutex> lock(uring.mutex);
+
+			unsigned head = *uring.cq_head;
+			unsigned tail = __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE);
+			for (; head != tail; ++head)
+			{
+				const io_uring_cqe& cqe = uring.cqes[head & *uring.cq_mask];
+
+				/* The stop entry has no read */
+				uring_file_read* file_read = (uring_file_read*)(uintptr_t)cqe.user_data;
+				if (!file_read)
+				{
+					continue;
+				}
+
+				uring.in_flight--;
+				io_request& request = *file_read->request;
+
+				if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+				{
+					uring_submit(*file_read);
+					continue;
+				}
+
+				if (cqe.res > 0)
+				{
+					request._bytes_read += (size_t)cqe.res;
+				}
+
+				/* A read of 0 bytes means the file ended early */
+				if (request._bytes_read == file_read->size)
+				{
+					file_read->status = io_status::DONE;
+				}
+				else if (cqe.res <= 0)
+				{
+					file_read->status = io_status::FAILED;
+				}
+				else if (request.is_cancel_requested())
+				{
+					file_read->status = io_status::CANCELLED;
+				}
+				else
+				{
+					uring_submit(*file_read);
+					continue;
+				}
+
+				finished.push_back(file_read);
+			}
+
+			__atomic_store_n(uring.cq_head, head, __ATOMIC_RELEASE);
+
+			/* Start reads that were waiting for room */
+			while (!uring.waiting.empty() && uring.in_flight < uring_entries - 1)
+			{
+				uring_file_read* file_read = uring.waiting.front();
+				uring.waiting.pop_front();
+				uring_submit(*file_read);
+			}
+		}
+
+		/* Callbacks run without the lock - they may queue more reads */
+		for (auto file_read : finished)
+		{
+			close(file_read->fd);
+
+			if (file_read->status == io_status::FAILED)
+			{
+				LOG_ERROR_FMT("Failed to read {0}.", file_read->request->_read.filename);
+			}
+
+			file_read->request->complete(file_read->status);
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_active.erase(std::find(_active.begin(), _active.end(), file_read->request));
+			}
+
+			delete file_read;
+		}
+
+		finished.clear();
+
+		std::lock_guard<std::mutex> lock(uring.mutex);
+		if (uring.stop && uring.in_flight == 0 && uring.waiting.empty())
+		{
+			return;
+		}
+	}
+#endif
+}
+
+void async_io::uring_submit(uring_file_read& file_read)
+{
+#ifdef __linux__
+	if (_uring->in_flight >= uring_entries - 1)
+	{
+		_uring->waiting.push_back(&file_read);
+		return;
+	}
+
+	size_t done = file_read.request->_bytes_read;
+	file_read.iov.iov_base = file_read.dst + done;
+	file_read.iov.iov_len = (std::min)(file_read.size - done, chunk_size);
+
+	/* READV rather than READ, which needs a 5.6 kernel */
+	io_uring_sqe entry = {};
+	entry.opcode = IORING_OP_READV;
+	entry.fd = file_read.fd;
+	entry.off = file_read.request->_read.offset + done;
+	entry.addr = (uint64_t)(uintptr_t)&file_read.iov;
+	entry.len = 1;
+	entry.user_data = (uint64_t)(uintptr_t)&file_read;
+
+	_uring->in_flight++;
+	submit_uring_entry(*_uring, entry);
+#endif
+}
+
+}   /* namespace jetz */
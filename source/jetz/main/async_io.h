@@ -0,0 +1,246 @@
+/*=============================================================================
+async_io.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "jetz/main/common.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+class io_request;
+
+/* io_uring backend, defined in async_io.cpp */
+struct uring_file_read;
+struct uring_state;
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+enum class io_status
+{
+	PENDING,		/* queued or in progress */
+	DONE,
+	FAILED,
+	CANCELLED
+};
+
+/**
+Called on an I/O thread when a request finishes, fails, or is cancelled.
+*/
+typedef std::function<void(io_request&)> io_callback;
+
+/**
+Describes a read.
+*/
+struct io_read
+{
+	/** Size value that reads to the end of the file. */
+	static const size_t to_end = SIZE_MAX;
+
+	std::string		filename;
+	uint64_t		offset = 0;
+	size_t			size = to_end;
+
+	/**
+	Buffer to read into, at least size bytes (e.g. mapped staging memory).
+	If NULL the data is read into the request.
+	*/
+	void*			buffer = NULL;
+};
+
+/**
+An asynchronous read. Requests are shared between the caller and the I/O
+threads; the caller can wait on, poll, or cancel them.
+*/
+class io_request {
+
+	friend class async_io;
+
+public:
+
+	io_request(const io_read& read, io_callback callback);
+	~io_request();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Requests cancellation. A queued read is dropped; a read in progress stops
+	at its next chunk. A finished request is unaffected.
+	*/
+	void cancel();
+
+	/**
+	Gets the number of bytes read.
+	*/
+	size_t get_bytes_read() const;
+
+	/**
+	Gets the data read. Only filled when the read didn't have a caller buffer.
+	*/
+	const std::vector<uint8_t>& get_data() const;
+
+	/**
+	Gets the read being performed.
+	*/
+	const io_read& get_read() const;
+
+	io_status get_status() const;
+
+	/**
+	Whether the request has finished, failed, or been cancelled.
+	*/
+	bool is_complete() const;
+
+	/**
+	Whether cancellation was requested.
+	*/
+	bool is_cancel_requested() const;
+
+	/**
+	Blocks until the request is complete.
+
+	@returns The final status.
+	*/
+	io_status wait() const;
+
+private:
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Sets the final status, runs the callback, and wakes waiters. */
+	void complete(io_status status);
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	io_read								_read;
+	io_callback							_callback;
+	std::vector<uint8_t>				_data;
+	size_t								_bytes_read;
+	std::atomic<bool>					_cancel;
+	std::atomic<io_status>				_status;
+
+	mutable std::mutex					_mutex;
+	mutable std::condition_variable		_complete_cv;
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+Runs file reads on a pool of I/O threads so many reads can be in flight at
+once. Reads resolve through the virtual filesystem, so pack entries and loose
+files are both supported.
+
+On Linux, reads of loose files go through io_uring instead, so many reads are
+in flight without a thread each. The thread pool handles pack entries (copied
+out of the pack mapping) and everything else when io_uring isn't available.
+*/
+class async_io {
+
+public:
+
+	/** Reads are done in chunks of this size so cancellation is responsive. */
+	static const size_t chunk_size = 1024 * 1024;
+
+	/**
+	@param thread_count Number of I/O threads. 0 picks a default.
+	*/
+	async_io(uint32_t thread_count = 0);
+
+	/**
+	Cancels outstanding requests and stops the I/O threads.
+	*/
+	~async_io();
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Queues a read.
+	*/
+	sptr<io_request> read(const io_read& read, io_callback callback = nullptr);
+
+	/**
+	Queues a batch of reads together. Reads are ordered by file and offset
+	so reads of the same file are issued sequentially.
+	*/
+	std::vector<sptr<io_request>> read_batch
+		(
+		const std::vector<io_read>&		reads,
+		io_callback						callback = nullptr
+		);
+
+	/**
+	Cancels all queued and in progress requests.
+	*/
+	void cancel_all();
+
+private:
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Performs a request on the calling I/O thread. */
+	void process(io_request& request);
+
+	/** I/O thread main loop. */
+	void thread_main();
+
+	/**
+	Starts a read of a loose file on io_uring.
+
+	@returns False if the read should go to the thread pool instead.
+	*/
+	bool uring_read(const sptr<io_request>& request);
+
+	/** io_uring completion thread main loop. */
+	void uring_main();
+
+	/** Submits the next chunk of a read on io_uring. Requires the uring lock. */
+	void uring_submit(uring_file_read& read);
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	std::vector<std::thread>			_threads;
+	std::deque<sptr<io_request>>		_queue;
+	std::vector<sptr<io_request>>		_active;
+	std::mutex							_mutex;
+	std::condition_variable				_queue_cv;
+	bool								_stop;
+
+	uring_state*						_uring;			/* NULL if io_uring isn't available */
+	std::thread							_uring_thread;
+};
+
+}   /* namespace jetz */
@@ -9,6 +9,7 @@ INCLUDES
 =========================================================*/
 
 #include <memory>
+#include <type_traits>
 
 /*=========================================================
 CONSTANTS
@@ -45,10 +46,16 @@ known at compile time.
 */
 #define cnt_of_array(arr)	( sizeof(arr) / sizeof((arr)[0]) )
 
+/*
+Functions rather than macros, so standard library members named min and max
+still compile (GCC). windows.h defines its own macros, which are kept.
+*/
 #ifndef max
-#define max( a, b ) ( ((a)>(b))?(a):(b) )
+template <class A, class B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
 #endif
 
 #ifndef min
-#define min( a, b ) ( ((a)<(b))?(a):(b) )
+template <class A, class B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
 #endif
@@ -6,10 +6,14 @@ filesystem.cpp
 INCLUDES
 =============================================================================*/
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <mutex>
 
 #include "jetz/main/filesystem.h"
 #include "jetz/main/log.h"
+#include "jetz/main/pack_file.h"
 
 /*=============================================================================
 NAMESPACE
@@ -17,29 +21,383 @@ NAMESPACE
 
 namespace jetz {
 
+/*=============================================================================
+VARIABLES
+=============================================================================*/
+
+/* Mounted packs, most recently mounted last */
+static std::vector<uptr<pack_file>>		s_packs;
+
+/* I/O threads for asynchronous reads, created on first use */
+static uptr<async_io>					s_async_io;
+static std::mutex						s_async_io_mutex;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+/**
+Finds a file in the mounted packs.
+*/
+static const pack_entry* find_in_packs(const std::string& path, const pack_file** pack)
+{
+	for (auto it = s_packs.rbegin(); it != s_packs.rend(); ++it)
+	{
+		const pack_entry* entry = (*it)->find(path);
+		if (entry)
+		{
+			*pack = it->get();
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+Gets the I/O threads, starting them if needed.
+*/
+static async_io& get_async_io()
+{
+	std::lock_guard<std::mutex> lock(s_async_io_mutex);
+	if (!s_async_io)
+	{
+		s_async_io = uptr<async_io>(new async_io());
+	}
+
+	return *s_async_io;
+}
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+file_view::file_view()
+	:
+	_data(NULL),
+	_size(0)
+{
+}
+
+file_view::~file_view()
+{
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+const uint8_t* file_view::get_data() const
+{
+	return _data;
+}
+
+size_t file_view::get_size() const
+{
+	return _size;
+}
+
 /*=============================================================================
 PUBLIC STATIC METHODS
 =============================================================================*/
 
+bool filesystem::exists(const std::string& filename)
+{
+	const pack_file* pack;
+	if (find_in_packs(normalize(filename), &pack))
+	{
+		return true;
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+	return (bool)file;
+}
+
+bool filesystem::get_size(const std::string& filename, uint64_t& size)
+{
+	const pack_file* pack;
+	const pack_entry* entry = find_in_packs(normalize(filename), &pack);
+	if (entry)
+	{
+		size = entry->size;
+		return true;
+	}
+
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	size = (uint64_t)file.tellg();
+	return true;
+}
+
+bool filesystem::is_packed(const std::string& filename)
+{
+	const pack_file* pack;
+	return find_in_packs(normalize(filename), &pack) != NULL;
+}
+
+bool filesystem::mount(const std::string& pack_filename)
+{
+	auto pack = uptr<pack_file>(new pack_file(pack_filename));
+	if (!pack->is_open())
+	{
+		LOG_ERROR_FMT("Failed to mount pack {0}.", pack_filename);
+		return false;
+	}
+
+	LOG_INFO_FMT("Mounted pack {0} ({1} files).", pack_filename, pack->get_entry_count());
+	s_packs.push_back(std::move(pack));
+	return true;
+}
+
+std::string filesystem::normalize(const std::string& path)
+{
+	std::vector<std::string> segments;
+	size_t leading_up = 0;
+
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", start);
+		if (end == std::string::npos)
+		{
+			end = path.size();
+		}
+
+		std::string seg = path.substr(start, end - start);
+		if (seg == "..")
+		{
+			if (!segments.empty())
+			{
+				segments.pop_back();
+			}
+			else
+			{
+				/* Can't resolve above the start of the path - keep it */
+				leading_up++;
+			}
+		}
+		else if (!seg.empty() && seg != ".")
+		{
+			segments.push_back(seg);
+		}
+
+		start = end + 1;
+	}
+
+	std::string result;
+	if (!path.empty() && (path[0] == '/' || path[0] == '\\'))
+	{
+		result = "/";
+	}
+
+	for (size_t i = 0; i < leading_up; ++i)
+	{
+		result += "../";
+	}
+
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		result += segments[i];
+		if (i + 1 < segments.size())
+		{
+			result += "/";
+		}
+	}
+
+	return result;
+}
+
+uptr<file_view> filesystem::open(const std::string& filename)
+{
+	auto view = uptr<file_view>(new file_view());
+
+	/* Pack entries - read uncompressed entries in place */
+	const pack_file* pack;
+	const pack_entry* entry = find_in_packs(normalize(filename), &pack);
+	if (entry)
+	{
+		if (entry->flags & pack_file::flag_lz4)
+		{
+			if (!pack->read(*entry, view->_buffer))
+			{
+				return nullptr;
+			}
+
+			view->_data = view->_buffer.data();
+		}
+		else
+		{
+			view->_data = pack->get_data(*entry);
+		}
+
+		view->_size = (size_t)entry->size;
+		return view;
+	}
+
+	/* Loose files - map the file */
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	size_t file_size = (size_t)file.tellg();
+	if (file_size > 0)
+	{
+		file.close();
+
+		view->_file = uptr<mapped_file>(new mapped_file(filename));
+		if (!view->_file->is_open())
+		{
+			return nullptr;
+		}
+
+		view->_data = view->_file->get_data();
+		view->_size = view->_file->get_size();
+	}
+
+	return view;
+}
+
+bool filesystem::read(const std::string& filename, std::vector<char>& data)
+{
+	auto view = open(filename);
+	if (!view)
+	{
+		return false;
+	}
+
+	data.assign((const char*)view->get_data(), (const char*)view->get_data() + view->get_size());
+	return true;
+}
+
 std::vector<char> filesystem::read_all
     (
     const std::string&              filename
     )
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file || !file.is_open()) 
+    std::vector<char> buffer;
+    if (!read(filename, buffer))
     {
-        LOG_FATA_FMT("Failed to open file %s.", filename);
+        LOG_FATA_FMT("Failed to open file {0}.", filename);
     }
 
-    size_t file_size = (size_t)file.tellg();
-    std::vector<char> buffer(file_size);
-    file.seekg(0);
-    file.read(buffer.data(), file_size);
-    file.close();
-
     return buffer;
 }
 
+sptr<io_request> filesystem::read_async(const io_read& read, io_callback callback)
+{
+	return get_async_io().read(read, callback);
+}
+
+std::vector<sptr<io_request>> filesystem::read_batch
+	(
+	const std::vector<io_read>&		reads,
+	io_callback						callback
+	)
+{
+	return get_async_io().read_batch(reads, callback);
+}
+
+bool filesystem::read_range
+	(
+	const std::string&				filename,
+	uint64_t						offset,
+	size_t							size,
+	void*							dst,
+	size_t&							bytes_read,
+	const std::atomic<bool>*		cancel
+	)
+{
+	bytes_read = 0;
+	uint8_t* out = (uint8_t*)dst;
+
+	/* Pack entries - copy out of the mapping, decompressing first if needed */
+	const pack_file* pack;
+	const pack_entry* entry = find_in_packs(normalize(filename), &pack);
+	if (entry)
+	{
+		if (offset > entry->size || size > entry->size - offset)
+		{
+			return false;
+		}
+
+		const uint8_t* src;
+		std::vector<uint8_t> decompressed;
+		if (entry->flags & pack_file::flag_lz4)
+		{
+			if (!pack->read(*entry, decompressed))
+			{
+				return false;
+			}
+
+			src = decompressed.data();
+		}
+		else
+		{
+			src = pack->get_data(*entry);
+		}
+
+		while (bytes_read < size)
+		{
+			if (cancel && *cancel)
+			{
+				return false;
+			}
+
+			size_t chunk = (std::min)(size - bytes_read, async_io::chunk_size);
+			memcpy(out + bytes_read, src + offset + bytes_read, chunk);
+			bytes_read += chunk;
+		}
+
+		return true;
+	}
+
+	/* Loose files */
+	std::ifstream file(filename, std::ios::binary);
+	if (!file || !file.seekg((std::streamoff)offset))
+	{
+		return false;
+	}
+
+	while (bytes_read < size)
+	{
+		if (cancel && *cancel)
+		{
+			return false;
+		}
+
+		size_t chunk = (std::min)(size - bytes_read, async_io::chunk_size);
+		file.read((char*)out + bytes_read, (std::streamsize)chunk);
+		bytes_read += (size_t)file.gcount();
+
+		if ((size_t)file.gcount() != chunk)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void filesystem::shutdown()
+{
+	/* Stop reads before the packs they may be reading go away */
+	{
+		std::lock_guard<std::mutex> lock(s_async_io_mutex);
+		s_async_io.reset();
+	}
+
+	unmount_all();
+}
+
+void filesystem::unmount_all()
+{
+	s_packs.clear();
+}
+
 }   /* namespace jetz */
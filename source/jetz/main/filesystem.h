@@ -8,9 +8,15 @@ filesystem.h
 INCLUDES
 =============================================================================*/
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "jetz/main/async_io.h"
+#include "jetz/main/common.h"
+#include "jetz/main/mapped_file.h"
+
 /*=============================================================================
 NAMESPACE
 =============================================================================*/
@@ -21,6 +27,50 @@ namespace jetz {
 TYPES
 =============================================================================*/
 
+/**
+Read-only contents of a file opened through the filesystem. Uncompressed pack
+entries point into the mounted pack and loose files are memory mapped, so
+neither is copied. Compressed pack entries are decompressed into memory.
+*/
+class file_view {
+
+	friend class filesystem;
+
+public:
+
+	file_view();
+	~file_view();
+
+	file_view(const file_view&) = delete;
+	file_view& operator=(const file_view&) = delete;
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	const uint8_t* get_data() const;
+	size_t get_size() const;
+
+private:
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	const uint8_t*			_data;
+	size_t					_size;
+	uptr<mapped_file>		_file;			/* loose file mapping */
+	std::vector<uint8_t>	_buffer;		/* decompressed or read data */
+};
+
+/**
+Virtual filesystem. Paths resolve to entries in mounted pack files first, most
+recently mounted pack first, then to loose files on disk. Mount packs before
+loading starts - lookups aren't synchronized with mounting.
+
+Reads can also be issued asynchronously on the filesystem's I/O threads (or
+io_uring on Linux), which start on the first asynchronous read.
+*/
 class filesystem {
 
 public:
@@ -29,10 +79,99 @@ public:
 	Public static methods
 	-----------------------------------------------------*/
 
+	/**
+	Checks whether a file exists in a mounted pack or on disk.
+	*/
+	static bool exists(const std::string& filename);
+
+	/**
+	Gets the size of a file.
+
+	@returns True if the file exists.
+	*/
+	static bool get_size(const std::string& filename, uint64_t& size);
+
+	/**
+	Checks whether a file resolves to an entry in a mounted pack rather than
+	a loose file.
+	*/
+	static bool is_packed(const std::string& filename);
+
+	/**
+	Mounts a pack file. Its entries take priority over loose files and packs
+	mounted earlier.
+
+	@returns True if the pack was mounted.
+	*/
+	static bool mount(const std::string& pack_filename);
+
+	/**
+	Normalizes a path for lookup: forward slashes, no empty or "." segments,
+	and ".." segments resolved where possible.
+	*/
+	static std::string normalize(const std::string& path);
+
+	/**
+	Opens a file for reading.
+
+	@returns The file contents, or nullptr if the file can't be read. Views of
+		pack entries are valid until the pack is unmounted.
+	*/
+	static uptr<file_view> open(const std::string& filename);
+
+	/**
+	Reads a file into memory.
+
+	@returns True if the file was read.
+	*/
+	static bool read(const std::string& filename, std::vector<char>& data);
+
 	/**
 	Reads the entire contents of the sepcified file into memory.
 	*/
 	static std::vector<char> read_all(const std::string& filename);
+
+	/**
+	Queues an asynchronous read.
+	*/
+	static sptr<io_request> read_async(const io_read& read, io_callback callback = nullptr);
+
+	/**
+	Queues a batch of asynchronous reads. See async_io::read_batch.
+	*/
+	static std::vector<sptr<io_request>> read_batch
+		(
+		const std::vector<io_read>&		reads,
+		io_callback						callback = nullptr
+		);
+
+	/**
+	Reads part of a file into a buffer. Large reads are done in chunks and
+	stop early if cancel is set.
+
+	@param bytes_read Receives the number of bytes read.
+	@returns True if size bytes were read.
+	*/
+	static bool read_range
+		(
+		const std::string&				filename,
+		uint64_t						offset,
+		size_t							size,
+		void*							dst,
+		size_t&							bytes_read,
+		const std::atomic<bool>*		cancel = NULL
+		);
+
+	/**
+	Cancels outstanding asynchronous reads, stops the I/O threads, and
+	unmounts all pack files.
+	*/
+	static void shutdown();
+
+	/**
+	Unmounts all pack files.
+	*/
+	static void unmount_all();
 };
 
 }   /* namespace jetz */
@@ -6,6 +6,9 @@ lua.cpp
 INCLUDES
 =============================================================================*/
 
+#include <vector>
+
+#include "jetz/main/filesystem.h"
 #include "jetz/main/lua.h"
 
 /*=============================================================================
@@ -254,8 +257,17 @@ lua_result<std::string> lua::GetString(const std::string &variable)
 
 bool lua::ExecuteFile(const std::string &filePath)
 {
-	/* Load and execute script file */
-	if (luaL_dofile(_state, filePath.c_str()))
+	/* Read through the virtual filesystem so scripts can come from packs */
+	std::vector<char> script;
+	if (!filesystem::read(filePath, script))
+	{
+		LOG_ERROR("Failed to read script '" + filePath + "'.");
+		return false;
+	}
+
+	/* Load and execute script - chunk name "@file" so errors report the file */
+	std::string chunk_name = "@" + filePath;
+	if (luaL_loadbuffer(_state, script.data(), script.size(), chunk_name.c_str()) || lua_pcall(_state, 0, LUA_MULTRET, 0))
 	{
 		LOG_ERROR("Failed to execute script '" + filePath + "'.");
 		return false;
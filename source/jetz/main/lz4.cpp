@@ -0,0 +1,293 @@
+/*=============================================================================
+lz4.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstring>
+#include <vector>
+
+#include "jetz/main/lz4.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTANTS
+=============================================================================*/
+
+static const size_t min_match = 4;
+static const size_t last_literals = 5;		/* last bytes of a block are always literals */
+static const size_t match_limit = 12;		/* no match may start this close to the end */
+static const size_t max_offset = 65535;
+static const uint32_t hash_bits = 12;
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+static uint32_t read_u32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t hash_u32(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+/**
+Writes a length in the LZ4 extended form (runs of 255) after the 15 stored in
+the token. Returns the new output position, or NULL if out of space.
+*/
+static uint8_t* write_length(uint8_t* op, const uint8_t* op_end, size_t len)
+{
+	for (; len >= 255; len -= 255)
+	{
+		if (op >= op_end)
+		{
+			return NULL;
+		}
+
+		*op++ = 255;
+	}
+
+	if (op >= op_end)
+	{
+		return NULL;
+	}
+
+	*op++ = (uint8_t)len;
+	return op;
+}
+
+/**
+Reads an extended length. Returns false if the input runs out.
+*/
+static bool read_length(const uint8_t*& ip, const uint8_t* ip_end, size_t& len)
+{
+	uint8_t b;
+	do
+	{
+		if (ip >= ip_end)
+		{
+			return false;
+		}
+
+		b = *ip++;
+		len += b;
+	} while (b == 255);
+
+	return true;
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+size_t lz4::compress_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t lz4::compress
+	(
+	const void*			src,
+	size_t				src_size,
+	void*				dst,
+	size_t				dst_capacity
+	)
+{
+	const uint8_t* in = (const uint8_t*)src;
+	const uint8_t* ip = in;
+	const uint8_t* anchor = in;
+	const uint8_t* in_end = in + src_size;
+	uint8_t* op = (uint8_t*)dst;
+	uint8_t* op_end = op + dst_capacity;
+
+	/* Last position of each hashed 4 byte sequence, as an offset from in */
+	std::vector<uint32_t> table((size_t)1 << hash_bits, UINT32_MAX);
+
+	if (src_size >= match_limit + 1)
+	{
+		const uint8_t* match_end = in_end - match_limit;
+
+		while (ip < match_end)
+		{
+			/* Look for a match */
+			uint32_t seq = read_u32(ip);
+			uint32_t h = hash_u32(seq);
+			uint32_t candidate = table[h];
+			table[h] = (uint32_t)(ip - in);
+
+			if (candidate == UINT32_MAX
+				|| (size_t)(ip - in) - candidate > max_offset
+				|| read_u32(in + candidate) != seq)
+			{
+				ip++;
+				continue;
+			}
+
+			/* Extend the match, leaving the last literals alone */
+			const uint8_t* match = in + candidate;
+			const uint8_t* limit = in_end - last_literals;
+			size_t match_len = min_match;
+			while (ip + match_len < limit && ip[match_len] == match[match_len])
+			{
+				match_len++;
+			}
+
+			/* Token, literals, offset, match length */
+			size_t literal_len = (size_t)(ip - anchor);
+			if (op + 1 + literal_len + 2 > op_end)
+			{
+				return 0;
+			}
+
+			uint8_t* token = op++;
+			*token = (uint8_t)((literal_len >= 15 ? 15 : literal_len) << 4);
+			if (literal_len >= 15)
+			{
+				op = write_length(op, op_end, literal_len - 15);
+				if (!op || op + literal_len + 2 > op_end)
+				{
+					return 0;
+				}
+			}
+
+			memcpy(op, anchor, literal_len);
+			op += literal_len;
+
+			uint16_t offset = (uint16_t)(ip - match);
+			*op++ = (uint8_t)(offset & 0xFF);
+			*op++ = (uint8_t)(offset >> 8);
+
+			size_t ml = match_len - min_match;
+			*token |= (uint8_t)(ml >= 15 ? 15 : ml);
+			if (ml >= 15)
+			{
+				op = write_length(op, op_end, ml - 15);
+				if (!op)
+				{
+					return 0;
+				}
+			}
+
+			ip += match_len;
+			anchor = ip;
+		}
+	}
+
+	/* Remaining bytes are literals */
+	size_t literal_len = (size_t)(in_end - anchor);
+	if (op + 1 + literal_len > op_end)
+	{
+		return 0;
+	}
+
+	uint8_t* token = op++;
+	*token = (uint8_t)((literal_len >= 15 ? 15 : literal_len) << 4);
+	if (literal_len >= 15)
+	{
+		op = write_length(op, op_end, literal_len - 15);
+		if (!op || op + literal_len > op_end)
+		{
+			return 0;
+		}
+	}
+
+	if (literal_len > 0)
+	{
+		memcpy(op, anchor, literal_len);
+		op += literal_len;
+	}
+
+	return (size_t)(op - (uint8_t*)dst);
+}
+
+bool lz4::decompress
+	(
+	const void*			src,
+	size_t				src_size,
+	void*				dst,
+	size_t				dst_size
+	)
+{
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* ip_end = ip + src_size;
+	uint8_t* out = (uint8_t*)dst;
+	uint8_t* op = out;
+	uint8_t* op_end = out + dst_size;
+
+	while (ip < ip_end)
+	{
+		uint8_t token = *ip++;
+
+		/* Literals */
+		size_t literal_len = token >> 4;
+		if (literal_len == 15 && !read_length(ip, ip_end, literal_len))
+		{
+			return false;
+		}
+
+		if (literal_len > (size_t)(ip_end - ip) || literal_len > (size_t)(op_end - op))
+		{
+			return false;
+		}
+
+		if (literal_len > 0)
+		{
+			memcpy(op, ip, literal_len);
+			ip += literal_len;
+			op += literal_len;
+		}
+
+		/* The last sequence has no match */
+		if (ip == ip_end)
+		{
+			break;
+		}
+
+		/* Match */
+		if (ip_end - ip < 2)
+		{
+			return false;
+		}
+
+		size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+
+		size_t match_len = token & 0x0F;
+		if (match_len == 15 && !read_length(ip, ip_end, match_len))
+		{
+			return false;
+		}
+
+		match_len += min_match;
+
+		if (offset == 0 || offset > (size_t)(op - out) || match_len > (size_t)(op_end - op))
+		{
+			return false;
+		}
+
+		/* Byte copy - the match may overlap the output */
+		const uint8_t* match = op - offset;
+		for (size_t i = 0; i < match_len; ++i)
+		{
+			op[i] = match[i];
+		}
+
+		op += match_len;
+	}
+
+	return op == op_end;
+}
+
+}   /* namespace jetz */
@@ -0,0 +1,77 @@
+/*=============================================================================
+lz4.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstddef>
+#include <cstdint>
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+LZ4 block format compression. Compression is a simple greedy single pass;
+decompression is bounds checked so corrupt data fails instead of overrunning.
+Output is compatible with the reference LZ4 block format.
+*/
+class lz4 {
+
+public:
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Gets the max compressed size of an input.
+	*/
+	static size_t compress_bound(size_t size);
+
+	/**
+	Compresses a block.
+
+	@param src The data to compress.
+	@param src_size The size of the data.
+	@param dst Output - the compressed data.
+	@param dst_capacity Size of dst. At least compress_bound(src_size) always fits.
+	@returns The compressed size, or 0 if dst is too small.
+	*/
+	static size_t compress
+		(
+		const void*			src,
+		size_t				src_size,
+		void*				dst,
+		size_t				dst_capacity
+		);
+
+	/**
+	Decompresses a block.
+
+	@param src The compressed data.
+	@param src_size The size of the compressed data.
+	@param dst Output - the decompressed data.
+	@param dst_size The exact decompressed size.
+	@returns True if the block decompressed to exactly dst_size bytes.
+	*/
+	static bool decompress
+		(
+		const void*			src,
+		size_t				src_size,
+		void*				dst,
+		size_t				dst_size
+		);
+};
+
+}   /* namespace jetz */
@@ -15,8 +15,12 @@ INCLUDES
 #include "jetz/main/app.h"
 #include "jetz/gpu/gpu.h"
 #include "jetz/gpu/vlk/vlk.h"
+#include "jetz/main/filesystem.h"
 #include "jetz/main/log.h"
+#include "jetz/main/pack_file.h"
 #include "jetz/main/window.h"
+#include "thirdparty/dirent/dirent.h"
+#undef ERROR // Was causing conflicts with log_level::ERROR for some reason (dirent.h)
 #include "thirdparty/glfw/glfw.h"
 #include "thirdparty/imgui/imgui.h"
 
@@ -24,6 +28,9 @@ INCLUDES
 MACROS / CONSTANTS
 =============================================================================*/
 
+/* Pack mounted at startup if present */
+static const char*			DEFAULT_PACK = "data.pak";
+
 /*=============================================================================
 TYPES
 =============================================================================*/
@@ -38,6 +45,10 @@ static jetz::window*		s_window;
 
 static ImGuiContext*		s_imgui_ctx;
 
+static std::vector<std::string>	s_packs;			/* packs to mount, from the command line */
+static std::string			s_build_pack;		/* pack to build instead of running */
+static std::string			s_build_pack_dir;
+
 /*=============================================================================
 METHODS
 =============================================================================*/
@@ -45,16 +56,102 @@ METHODS
 /**
 Parses command line arguments.
 
+	-pack <file>					Mounts a pack file.
+	-build-pack <file> <dir>		Builds a pack from the files in a directory and exits.
+
 args: list of arguments, excluding the name of the executable.
 */
 static void parse_cmd_line(const std::vector<std::string>& args)
 {
-	// TODO
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		if (args[i] == "-pack" && i + 1 < args.size())
+		{
+			s_packs.push_back(args[++i]);
+		}
+		else if (args[i] == "-build-pack" && i + 2 < args.size())
+		{
+			s_build_pack = args[++i];
+			s_build_pack_dir = args[++i];
+		}
+		else
+		{
+			LOG_WARN_FMT("Unknown command line argument {0}.", args[i]);
+		}
+	}
+}
+
+/**
+Adds the files in a directory, and its subdirectories, to a pack build list.
+Paths are relative to the root directory.
+*/
+static void list_pack_files(const std::string& root, const std::string& rel_dir, std::vector<jetz::pack_build_item>& items)
+{
+	std::string dir_path = rel_dir.empty() ? root : root + "/" + rel_dir;
 
-	for (auto arg : args)
+	DIR* dir = opendir(dir_path.c_str());
+	if (!dir)
 	{
+		LOG_ERROR_FMT("Failed to open directory {0}.", dir_path);
+		return;
+	}
 
+	struct dirent* ent;
+	while ((ent = readdir(dir)) != NULL)
+	{
+		std::string name(ent->d_name);
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		std::string rel_path = rel_dir.empty() ? name : rel_dir + "/" + name;
+		if (ent->d_type == DT_DIR)
+		{
+			list_pack_files(root, rel_path, items);
+		}
+		else if (ent->d_type == DT_REG)
+		{
+			jetz::pack_build_item item;
+			item.path = rel_path;
+			item.source = root + "/" + rel_path;
+			items.push_back(item);
+		}
 	}
+
+	closedir(dir);
+}
+
+/**
+Builds the pack requested on the command line.
+*/
+static bool build_pack()
+{
+	std::vector<jetz::pack_build_item> items;
+	list_pack_files(s_build_pack_dir, "", items);
+
+	/* Don't pack the output if it's inside the directory */
+	std::string out_path = jetz::filesystem::normalize(s_build_pack);
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		if (jetz::filesystem::normalize(items[i].source) == out_path)
+		{
+			items.erase(items.begin() + i);
+			break;
+		}
+	}
+
+	return jetz::pack_file::build(s_build_pack, items, true);
+}
+
+static void setup_logging()
+{
+	/* Add simple logging target */
+	jetz::log::logger.register_target([](const std::string& msg) {
+		std::cout << msg;
+	});
+
+	LOG_INFO("Logger initialized.");
 }
 
 static void shutdown()
@@ -68,20 +165,25 @@ static void shutdown()
 	delete s_gpu;
 	delete s_window;
 	glfwTerminate();
+
+	/* Views into packs are released with the resources above */
+	jetz::filesystem::shutdown();
 }
 
 static void startup()
 {
 	/*
-	Seutp logging
+	Setup filesystem - packs mounted later take priority
 	*/
+	if (jetz::filesystem::exists(DEFAULT_PACK))
+	{
+		jetz::filesystem::mount(DEFAULT_PACK);
+	}
 
-	/* Add simple logging target */
-	jetz::log::logger.register_target([](const std::string& msg) {
-		std::cout << msg;
-	});
-
-	LOG_INFO("Logger initialized.");
+	for (const auto& pack : s_packs)
+	{
+		jetz::filesystem::mount(pack);
+	}
 
 	/*
 	Setup GLFW
@@ -150,10 +252,19 @@ argv: array of the arguments
 */
 int main(int argc, char* argv[])
 {
+	/* Setup logging */
+	setup_logging();
+
 	/* Parse command line args */
 	std::vector<std::string> args(argv + 1, argv + argc);
 	parse_cmd_line(args);
 
+	/* Pack building runs instead of the game */
+	if (!s_build_pack.empty())
+	{
+		return build_pack() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	/* Startup */
 	startup();
 
@@ -0,0 +1,161 @@
+/*=============================================================================
+mapped_file.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "jetz/main/log.h"
+#include "jetz/main/mapped_file.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+mapped_file::mapped_file(const std::string& filename)
+	:
+	_data(NULL),
+	_size(0),
+	_file(NULL),
+	_mapping(NULL)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR_FMT("Failed to open file {0}.", filename);
+		return;
+	}
+
+	_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		LOG_ERROR_FMT("Failed to get size of file {0}.", filename);
+		close();
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		LOG_ERROR_FMT("Failed to map file {0}.", filename);
+		close();
+		return;
+	}
+
+	_mapping = mapping;
+	_data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	_size = (size_t)size.QuadPart;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		LOG_ERROR_FMT("Failed to open file {0}.", filename);
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		LOG_ERROR_FMT("Failed to get size of file {0}.", filename);
+		::close(fd);
+		return;
+	}
+
+	/* The mapping keeps its own reference to the file */
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (data != MAP_FAILED)
+	{
+		_data = (const uint8_t*)data;
+		_size = (size_t)st.st_size;
+	}
+#endif
+
+	if (_data == NULL)
+	{
+		LOG_ERROR_FMT("Failed to map file {0}.", filename);
+		close();
+	}
+}
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+const uint8_t* mapped_file::get_data() const
+{
+	return _data;
+}
+
+size_t mapped_file::get_size() const
+{
+	return _size;
+}
+
+bool mapped_file::is_open() const
+{
+	return _data != NULL;
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+void mapped_file::close()
+{
+#ifdef _WIN32
+	if (_data)
+	{
+		UnmapViewOfFile(_data);
+	}
+
+	if (_mapping)
+	{
+		CloseHandle((HANDLE)_mapping);
+	}
+
+	if (_file)
+	{
+		CloseHandle((HANDLE)_file);
+	}
+#else
+	if (_data)
+	{
+		munmap((void*)_data, _size);
+	}
+#endif
+
+	_data = NULL;
+	_size = 0;
+	_file = NULL;
+	_mapping = NULL;
+}
+
+}   /* namespace jetz */
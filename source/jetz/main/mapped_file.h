@@ -0,0 +1,81 @@
+/*=============================================================================
+mapped_file.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+A read-only memory mapping of a whole file. Pages are read on first access, so
+mapping a large file doesn't copy it into the heap.
+*/
+class mapped_file {
+
+public:
+
+	/**
+	Maps a file. Check is_open() for success.
+	*/
+	mapped_file(const std::string& filename);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Gets the mapped file contents, or NULL if the file isn't mapped.
+	*/
+	const uint8_t* get_data() const;
+
+	/**
+	Gets the size of the file in bytes.
+	*/
+	size_t get_size() const;
+
+	/**
+	Whether the file was mapped.
+	*/
+	bool is_open() const;
+
+private:
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	void close();
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	const uint8_t*		_data;
+	size_t				_size;
+
+	/* Platform handles */
+	void*				_file;
+	void*				_mapping;
+};
+
+}   /* namespace jetz */
@@ -0,0 +1,354 @@
+/*=============================================================================
+pack_file.cpp
+=============================================================================*/
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "jetz/main/filesystem.h"
+#include "jetz/main/log.h"
+#include "jetz/main/lz4.h"
+#include "jetz/main/pack_file.h"
+#include "jetz/main/utl.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+STATIC FUNCTIONS
+=============================================================================*/
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+Reads a loose file to add to a pack.
+*/
+static bool read_source(const std::string& filename, std::vector<char>& data)
+{
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	data.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read(data.data(), (std::streamsize)data.size());
+	return (bool)file;
+}
+
+/**
+Orders entries by hash, then by name so colliding paths have a stable order.
+*/
+static bool entry_less(const pack_entry& a, const pack_entry& b, const char* names)
+{
+	if (a.hash != b.hash)
+	{
+		return a.hash < b.hash;
+	}
+
+	std::string name_a(names + a.name_offset, a.name_length);
+	std::string name_b(names + b.name_offset, b.name_length);
+	return name_a < name_b;
+}
+
+/*=============================================================================
+CONSTRUCTORS
+=============================================================================*/
+
+pack_file::pack_file(const std::string& filename)
+	:
+	_filename(filename),
+	_file(filename),
+	_header(NULL),
+	_entries(NULL),
+	_names(NULL)
+{
+	if (!_file.is_open())
+	{
+		return;
+	}
+
+	if (!validate())
+	{
+		LOG_ERROR_FMT("Invalid pack file {0}.", filename);
+		return;
+	}
+
+	const uint8_t* data = _file.get_data();
+	_header = (const pack_header*)data;
+	_entries = (const pack_entry*)(data + _header->index_offset);
+	_names = (const char*)(data + _header->names_offset);
+}
+
+pack_file::~pack_file()
+{
+}
+
+/*=============================================================================
+PUBLIC STATIC METHODS
+=============================================================================*/
+
+bool pack_file::build
+	(
+	const std::string&						filename,
+	const std::vector<pack_build_item>&		items,
+	bool									compress,
+	uint32_t								alignment
+	)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment < 8)
+	{
+		LOG_ERROR_FMT("Pack alignment {0} must be a power of two of at least 8.", alignment);
+		return false;
+	}
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		LOG_ERROR_FMT("Failed to create pack file {0}.", filename);
+		return false;
+	}
+
+	std::vector<pack_entry> entries;
+	std::string names;
+	uint64_t offset = align_up(sizeof(pack_header), alignment);
+	uint64_t total_size = 0;
+	uint64_t total_stored = 0;
+
+	/*
+	Write entry data
+	*/
+	for (const auto& item : items)
+	{
+		std::string path = filesystem::normalize(item.path);
+
+		/* Name lengths and offsets are stored in 16 and 32 bits */
+		if (path.size() > UINT16_MAX)
+		{
+			LOG_ERROR_FMT("Path {0} is too long for a pack ({1} bytes, max {2}).", item.path, path.size(), UINT16_MAX);
+			return false;
+		}
+
+		if (names.size() + path.size() > UINT32_MAX)
+		{
+			LOG_ERROR("Pack name table is too large.");
+			return false;
+		}
+
+		std::vector<char> data;
+		if (!read_source(item.source, data))
+		{
+			LOG_ERROR_FMT("Failed to read {0} for pack.", item.source);
+			return false;
+		}
+
+		pack_entry entry = {};
+		entry.hash = utl::hash_bytes(path.data(), path.size());
+		entry.offset = offset;
+		entry.size = data.size();
+		entry.stored_size = data.size();
+		entry.name_offset = (uint32_t)names.size();
+		entry.name_length = (uint16_t)path.size();
+		names += path;
+
+		/* Keep compressed data only if it saves enough to be worth decompressing */
+		std::vector<char> compressed;
+		if (compress && !data.empty())
+		{
+			compressed.resize(lz4::compress_bound(data.size()));
+			size_t size = lz4::compress(data.data(), data.size(), compressed.data(), compressed.size());
+			if (size > 0 && size <= data.size() * (1.0f - min_compression_saving))
+			{
+				compressed.resize(size);
+				entry.stored_size = size;
+				entry.flags |= flag_lz4;
+			}
+		}
+
+		const std::vector<char>& stored = (entry.flags & flag_lz4) ? compressed : data;
+
+		out.seekp((std::streamoff)offset);
+		out.write(stored.data(), (std::streamsize)stored.size());
+
+		entries.push_back(entry);
+		offset = align_up(offset + entry.stored_size, alignment);
+		total_size += entry.size;
+		total_stored += entry.stored_size;
+	}
+
+	/*
+	Write the sorted index and name table
+	*/
+	const char* name_data = names.data();
+	std::sort(entries.begin(), entries.end(), [name_data](const pack_entry& a, const pack_entry& b) {
+		return entry_less(a, b, name_data);
+	});
+
+	for (size_t i = 1; i < entries.size(); ++i)
+	{
+		if (!entry_less(entries[i - 1], entries[i], name_data))
+		{
+			LOG_ERROR_FMT("Duplicate path {0} in pack.", std::string(name_data + entries[i].name_offset, entries[i].name_length));
+			return false;
+		}
+	}
+
+	pack_header header = {};
+	header.magic = magic;
+	header.version = version;
+	header.entry_count = (uint32_t)entries.size();
+	header.alignment = alignment;
+	header.index_offset = align_up(offset, 8);
+	header.names_offset = header.index_offset + entries.size() * sizeof(pack_entry);
+	header.names_size = names.size();
+
+	out.seekp((std::streamoff)header.index_offset);
+	out.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(pack_entry)));
+	out.write(names.data(), (std::streamsize)names.size());
+
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+
+	if (!out)
+	{
+		LOG_ERROR_FMT("Failed to write pack file {0}.", filename);
+		return false;
+	}
+
+	LOG_INFO_FMT("Built pack {0}: {1} files, {2} bytes stored as {3}.", filename, entries.size(), total_size, total_stored);
+	return true;
+}
+
+/*=============================================================================
+PUBLIC METHODS
+=============================================================================*/
+
+const pack_entry* pack_file::find(const std::string& path) const
+{
+	if (!is_open())
+	{
+		return NULL;
+	}
+
+	uint64_t hash = utl::hash_bytes(path.data(), path.size());
+
+	const pack_entry* begin = _entries;
+	const pack_entry* end = _entries + _header->entry_count;
+	const pack_entry* it = std::lower_bound(begin, end, hash, [](const pack_entry& e, uint64_t h) {
+		return e.hash < h;
+	});
+
+	/* Compare names in case of hash collisions */
+	for (; it != end && it->hash == hash; ++it)
+	{
+		if (it->name_length == path.size() && memcmp(_names + it->name_offset, path.data(), path.size()) == 0)
+		{
+			return it;
+		}
+	}
+
+	return NULL;
+}
+
+const uint8_t* pack_file::get_data(const pack_entry& entry) const
+{
+	return _file.get_data() + entry.offset;
+}
+
+uint32_t pack_file::get_entry_count() const
+{
+	return is_open() ? _header->entry_count : 0;
+}
+
+const std::string& pack_file::get_filename() const
+{
+	return _filename;
+}
+
+bool pack_file::is_open() const
+{
+	return _header != NULL;
+}
+
+bool pack_file::read(const pack_entry& entry, std::vector<uint8_t>& data) const
+{
+	const uint8_t* src = get_data(entry);
+	data.resize((size_t)entry.size);
+
+	if (!(entry.flags & flag_lz4))
+	{
+		memcpy(data.data(), src, data.size());
+		return true;
+	}
+
+	if (!lz4::decompress(src, (size_t)entry.stored_size, data.data(), data.size()))
+	{
+		LOG_ERROR_FMT("Corrupt entry {0} in pack {1}.", std::string(_names + entry.name_offset, entry.name_length), _filename);
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/*=============================================================================
+PRIVATE METHODS
+=============================================================================*/
+
+bool pack_file::validate() const
+{
+	size_t size = _file.get_size();
+	if (size < sizeof(pack_header))
+	{
+		return false;
+	}
+
+	const uint8_t* data = _file.get_data();
+	const pack_header* header = (const pack_header*)data;
+	if (header->magic != magic || header->version != version)
+	{
+		return false;
+	}
+
+	/* Index and names within the file. Compared against the space left so the sums can't wrap. */
+	uint64_t index_size = (uint64_t)header->entry_count * sizeof(pack_entry);
+	if (header->index_offset % 8 != 0
+		|| header->index_offset > size
+		|| index_size > size - header->index_offset
+		|| header->names_offset != header->index_offset + index_size
+		|| header->names_size > size - header->names_offset)
+	{
+		return false;
+	}
+
+	/* Entries within the file and sorted */
+	const pack_entry* entries = (const pack_entry*)(data + header->index_offset);
+	for (uint32_t i = 0; i < header->entry_count; ++i)
+	{
+		const pack_entry& e = entries[i];
+		if (e.offset > header->index_offset
+			|| e.stored_size > header->index_offset - e.offset
+			|| (uint64_t)e.name_offset + e.name_length > header->names_size
+			|| (!(e.flags & flag_lz4) && e.stored_size != e.size)
+			|| (i > 0 && entries[i - 1].hash > e.hash))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}   /* namespace jetz */
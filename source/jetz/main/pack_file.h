@@ -0,0 +1,184 @@
+/*=============================================================================
+pack_file.h
+=============================================================================*/
+
+#pragma once
+
+/*=============================================================================
+INCLUDES
+=============================================================================*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jetz/main/common.h"
+#include "jetz/main/mapped_file.h"
+
+/*=============================================================================
+NAMESPACE
+=============================================================================*/
+
+namespace jetz {
+
+/*=============================================================================
+TYPES
+=============================================================================*/
+
+/**
+Pack file header. All values are little endian.
+
+Layout:
+	header
+	entry data, each entry aligned to header.alignment
+	index - header.entry_count entries sorted by hash
+	name table - the normalized path of each entry
+*/
+struct pack_header
+{
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		entry_count;
+	uint32_t		alignment;
+	uint64_t		index_offset;
+	uint64_t		names_offset;
+	uint64_t		names_size;
+};
+
+/**
+An entry in the pack index.
+*/
+struct pack_entry
+{
+	uint64_t		hash;			/* hash of the normalized path */
+	uint64_t		offset;			/* offset of the data in the pack */
+	uint64_t		stored_size;	/* size in the pack (compressed size if compressed) */
+	uint64_t		size;			/* uncompressed size */
+	uint32_t		name_offset;	/* offset of the path in the name table */
+	uint16_t		name_length;
+	uint16_t		flags;
+};
+
+/**
+A file to add to a pack.
+*/
+struct pack_build_item
+{
+	std::string		path;			/* path the file is looked up by */
+	std::string		source;			/* file to read the data from */
+};
+
+/*=============================================================================
+CLASS
+=============================================================================*/
+
+/**
+A read-only archive of asset files. The pack is memory mapped; lookups binary
+search a sorted hash index, and uncompressed entries are read in place.
+Entries may be LZ4 compressed.
+*/
+class pack_file {
+
+public:
+
+	static const uint32_t magic = 0x4B41504A;		/* "JPAK" */
+	static const uint32_t version = 1;
+
+	/** Default entry alignment - a page, so entries can be mapped independently. */
+	static const uint32_t default_alignment = 4096;
+
+	/** Entry flag - the data is LZ4 compressed. */
+	static const uint16_t flag_lz4 = 0x0001;
+
+	/** Entries are only stored compressed if that saves at least this fraction. */
+	static constexpr float min_compression_saving = 0.1f;
+
+	/**
+	Opens a pack. Check is_open() for success.
+	*/
+	pack_file(const std::string& filename);
+	~pack_file();
+
+	/*-----------------------------------------------------
+	Public static methods
+	-----------------------------------------------------*/
+
+	/**
+	Builds a pack file.
+
+	@param filename The pack to write.
+	@param items The files to add. Paths are normalized.
+	@param compress Whether to LZ4 compress entries that shrink enough.
+	@param alignment Alignment of each entry's data.
+	@returns True if the pack was written.
+	*/
+	static bool build
+		(
+		const std::string&						filename,
+		const std::vector<pack_build_item>&		items,
+		bool									compress,
+		uint32_t								alignment = default_alignment
+		);
+
+	/*-----------------------------------------------------
+	Public methods
+	-----------------------------------------------------*/
+
+	/**
+	Finds an entry by normalized path.
+
+	@returns The entry, or NULL if the pack doesn't contain the path.
+	*/
+	const pack_entry* find(const std::string& path) const;
+
+	/**
+	Gets the stored data of an entry. This is the file contents unless the
+	entry is compressed. Valid while the pack is open.
+	*/
+	const uint8_t* get_data(const pack_entry& entry) const;
+
+	/**
+	Gets the number of entries.
+	*/
+	uint32_t get_entry_count() const;
+
+	/**
+	Gets the pack's filename.
+	*/
+	const std::string& get_filename() const;
+
+	/**
+	Whether the pack was opened and its index is valid.
+	*/
+	bool is_open() const;
+
+	/**
+	Reads an entry, decompressing it if needed.
+
+	@param entry The entry.
+	@param data Output - the file contents.
+	@returns True if the entry was read.
+	*/
+	bool read(const pack_entry& entry, std::vector<uint8_t>& data) const;
+
+private:
+
+	/*-----------------------------------------------------
+	Private methods
+	-----------------------------------------------------*/
+
+	/** Validates the header and index. */
+	bool validate() const;
+
+	/*-----------------------------------------------------
+	Private variables
+	-----------------------------------------------------*/
+
+	std::string				_filename;
+	mapped_file				_file;
+	const pack_header*		_header;
+	const pack_entry*		_entries;
+	const char*				_names;
+};
+
+}   /* namespace jetz */
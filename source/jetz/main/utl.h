@@ -8,6 +8,8 @@ utl.h
 INCLUDES
 =============================================================================*/
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 /*=============================================================================
@@ -95,6 +97,54 @@ inline bool ends_with(const std::string &str, const std::string &endsWith)
 	return std::equal(endsWith.rbegin(), endsWith.rend(), str.rbegin());
 }
 
+/**
+Hashes a block of memory (64-bit MurmurHash2). Used to identify resources by
+content.
+
+@param data The data to hash.
+@param size The size of the data in bytes.
+@param seed Hash seed.
+*/
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ull;
+	const int r = 47;
+
+	uint64_t h = seed ^ (size * m);
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	const uint8_t* end = bytes + (size & ~(size_t)7);
+
+	for (; bytes != end; bytes += 8)
+	{
+		uint64_t k;
+		memcpy(&k, bytes, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	/* Remaining bytes */
+	size_t rem = size & 7;
+	if (rem > 0)
+	{
+		uint64_t k = 0;
+		memcpy(&k, bytes, rem);
+		h ^= k;
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
+
 /**
 Combines two hash values.
 */
@@ -2,20 +2,36 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 /*---------------------------------------------------------
-Uniforms - Material properties
+Storage buffers - Material properties
+
+Must match vlk_material_data.
 ---------------------------------------------------------*/
-layout(set = 1, binding = 0) uniform MaterialUbo {
+const uint HAS_BASE_COLOR_TEXTURE = 1;
+
+struct Material {
 	vec4 baseColorFactor;
 	vec3 emissiveFactor;
 	float metallicFactor;
 	float roughnessFactor;
-	bool hasBaseColorTexture;
-	bool hasMetallicRoughnessTexture;
-	bool hasNormalTexture;
-	bool hasOcclusionTexture;
-	bool hasEmissiveTexture;
-} materialUbo;
+	uint textureFlags;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer Materials {
+	Material materials[];
+};
 
+/*---------------------------------------------------------
+Push constants
+
+The vertex shader's push constants use the first 64 bytes.
+---------------------------------------------------------*/
+layout(push_constant) uniform PushConstants {
+	layout(offset = 64) uint materialIndex;
+} pc;
+
+/*---------------------------------------------------------
+Uniforms - Material textures
+---------------------------------------------------------*/
 layout(set = 1, binding = 1) uniform sampler2D baseColorTexture;
 layout(set = 1, binding = 2) uniform sampler2D metallicRoughnessTexture;
 layout(set = 1, binding = 3) uniform sampler2D normalTexture;
@@ -41,19 +57,23 @@ Functions
 vec4 blinnPhong();
 vec4 lambertian();
 
+Material material;
+
 void main() {
+	material = materials[pc.materialIndex];
+
 	//outColor = vec4(1.0, 0.0, 1.0, 1.0);
-	//outColor = materialUbo.baseColorFactor * texture(baseColorTexture, fragTexCoord);
+	//outColor = material.baseColorFactor * texture(baseColorTexture, fragTexCoord);
 	//outColor = lambertian();
 	//outColor = blinnPhong();
 
-	if (materialUbo.hasBaseColorTexture)
+	if ((material.textureFlags & HAS_BASE_COLOR_TEXTURE) != 0)
 	{
-		outColor = materialUbo.baseColorFactor * texture(baseColorTexture, fragTexCoord);
+		outColor = material.baseColorFactor * texture(baseColorTexture, fragTexCoord);
 	}
 	else
 	{
-		outColor = materialUbo.baseColorFactor;
+		outColor = material.baseColorFactor;
 	}
 }
 
@@ -69,7 +89,7 @@ vec4 lambertian()
 	*/
 
 	/* Base diffuse color */
-	vec4 Kd = materialUbo.baseColorFactor * texture(baseColorTexture, fragTexCoord);
+	vec4 Kd = material.baseColorFactor * texture(baseColorTexture, fragTexCoord);
 
 	/* Light intensity */
 	vec4 I = vec4(1.0, 1.0, 1.0, 1.0);
@@ -105,7 +125,7 @@ vec4 blinnPhong()
 	*/
 
 	/* Base diffuse color */
-	vec4 Kd = materialUbo.baseColorFactor * texture(baseColorTexture, fragTexCoord);
+	vec4 Kd = material.baseColorFactor * texture(baseColorTexture, fragTexCoord);
 
 	/* Normal - combination of surface normal and sampled normal texture */
 	vec3 n = fragNormal * texture(normalTexture, fragTexCoord).xyz;
@@ -1,6 +1,12 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+/*---------------------------------------------------------
+Specialization constants
+---------------------------------------------------------*/
+/* Normals are octahedral encoded in xy (quantized vertices) */
+layout(constant_id = 0) const bool octNormals = false;
+
 /*---------------------------------------------------------
 Uniforms - per view
 ---------------------------------------------------------*/
@@ -40,6 +46,15 @@ out gl_PerVertex {
 /*---------------------------------------------------------
 Functions
 ---------------------------------------------------------*/
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main() {
 	vec4 worldPos = constants.model_matrix * vec4(inPosition, 1.0);
 
@@ -51,6 +66,6 @@ void main() {
 	eyeDirNorm = normalize(eyeDir).xyz;
 
     gl_Position = viewUbo.proj * viewUbo.view * worldPos;
-    fragNormal = inNormal;
+    fragNormal = octNormals ? octDecode(inNormal.xy) : inNormal;
 	fragTexCoord = inTexCoord;
 }
\ No newline at end of file
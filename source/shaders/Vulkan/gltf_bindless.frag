@@ -0,0 +1,83 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+/*---------------------------------------------------------
+Storage buffers - Material properties
+
+Must match vlk_material_data.
+---------------------------------------------------------*/
+struct Material {
+	vec4 baseColorFactor;
+	vec3 emissiveFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	uint textureFlags;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer Materials {
+	Material materials[];
+};
+
+/*---------------------------------------------------------
+Push constants - Material index and texture indices
+
+Must match vlk_gltf_push_constant_fragment. The vertex
+shader's push constants use the first 64 bytes.
+---------------------------------------------------------*/
+const uint NO_TEXTURE = 0xFFFFFFFF;
+
+layout(push_constant) uniform PushConstants {
+	layout(offset = 64) uint materialIndex;
+	uint baseColorTexture;
+	uint metallicRoughnessTexture;
+	uint normalTexture;
+	uint occlusionTexture;
+	uint emissiveTexture;
+} pc;
+
+/*---------------------------------------------------------
+Uniforms - Global texture array
+---------------------------------------------------------*/
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler textureSampler;
+
+/*---------------------------------------------------------
+Inputs
+---------------------------------------------------------*/
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 lightDirNorm;
+layout(location = 3) in vec3 eyeDirNorm;
+
+/*---------------------------------------------------------
+Outputs
+---------------------------------------------------------*/
+layout(location = 0) out vec4 outColor;
+
+/*---------------------------------------------------------
+Functions
+---------------------------------------------------------*/
+vec4 sampleTexture(uint index);
+
+void main() {
+	Material material = materials[pc.materialIndex];
+
+	if (pc.baseColorTexture != NO_TEXTURE)
+	{
+		outColor = material.baseColorFactor * sampleTexture(pc.baseColorTexture);
+	}
+	else
+	{
+		outColor = material.baseColorFactor;
+	}
+}
+
+/**
+Samples a texture from the global array. The index comes from push
+constants, so it's uniform across the draw.
+*/
+vec4 sampleTexture(uint index)
+{
+	return texture(sampler2D(textures[index], textureSampler), fragTexCoord);
+}
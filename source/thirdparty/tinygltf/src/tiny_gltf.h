@@ -1383,6 +1383,16 @@ class TinyGLTF {
     return store_original_json_for_extras_and_extensions_;
   }
 
+  ///
+  /// Don't copy the GLB BIN chunk into `Buffer::data` in
+  /// LoadBinaryFromMemory. The buffer backed by the BIN chunk is left empty
+  /// and the caller reads it in place from the memory it passed in, which
+  /// must stay valid for as long as that data is used. (jetz)
+  ///
+  void SetCopyBinaryChunk(const bool enabled) { copy_bin_chunk_ = enabled; }
+
+  bool GetCopyBinaryChunk() const { return copy_bin_chunk_; }
+
  private:
   ///
   /// Loads glTF asset from string(memory).
@@ -1397,6 +1407,7 @@ class TinyGLTF {
   const unsigned char *bin_data_ = nullptr;
   size_t bin_size_ = 0;
   bool is_binary_ = false;
+  bool copy_bin_chunk_ = true;
 
   bool serialize_default_values_ = false;  ///< Serialize default values?
 
@@ -3960,7 +3971,7 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
                         FsCallbacks *fs, const std::string &basedir,
                         bool is_binary = false,
                         const unsigned char *bin_data = nullptr,
-                        size_t bin_size = 0) {
+                        size_t bin_size = 0, bool copy_bin = true) {
   size_t byteLength;
   if (!ParseUnsignedProperty(&byteLength, err, o, "byteLength", true,
                              "Buffer")) {
@@ -4033,8 +4044,11 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
       }
 
       // Read buffer data
-      buffer->data.resize(static_cast<size_t>(byteLength));
-      memcpy(&(buffer->data.at(0)), bin_data, static_cast<size_t>(byteLength));
+      if (copy_bin) {
+        buffer->data.resize(static_cast<size_t>(byteLength));
+        memcpy(&(buffer->data.at(0)), bin_data,
+               static_cast<size_t>(byteLength));
+      }
     }
 
   } else {
@@ -5585,7 +5599,8 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
       Buffer buffer;
       if (!ParseBuffer(&buffer, err, o,
                        store_original_json_for_extras_and_extensions_, &fs,
-                       base_dir, is_binary_, bin_data_, bin_size_)) {
+                       base_dir, is_binary_, bin_data_, bin_size_,
+                       copy_bin_chunk_)) {
         return false;
       }
 
@@ -5872,9 +5887,13 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           }
           return false;
         }
+        // The BIN chunk buffer is empty if it wasn't copied.
+        const unsigned char *data =
+            (is_binary_ && buffer.uri.empty() && buffer.data.empty())
+                ? bin_data_ + bufferView.byteOffset
+                : &buffer.data[bufferView.byteOffset];
         bool ret = LoadImageData(
-            &image, idx, err, warn, image.width, image.height,
-            &buffer.data[bufferView.byteOffset],
+            &image, idx, err, warn, image.width, image.height, data,
             static_cast<int>(bufferView.byteLength), load_image_user_data_);
         if (!ret) {
           return false;